@@ -0,0 +1,427 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <array>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <type_traits>
+#include <valarray>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+
+// Compares the operations of vec<N,T> with equivalent code based on
+// std::valarray<T>, std::array<T,N> and raw arrays for a range of dimensions
+// N and data types T. Each benchmark iteration processes a batch of vectors
+// held in cache; timings are per iteration, items_per_second counts vector
+// operations.
+
+using namespace Vec;
+
+const size_t batch = 64;
+
+template <typename T> struct type_name;
+template <> struct type_name<int> { static std::string get() { return "int"; } };
+template <> struct type_name<float> { static std::string get() { return "float"; } };
+template <> struct type_name<double> { static std::string get() { return "double"; } };
+template <> struct type_name<std::complex<float>> {
+    static std::string get() { return "complex<float>"; }
+};
+template <> struct type_name<std::complex<double>> {
+    static std::string get() { return "complex<double>"; }
+};
+
+// deterministic, nonzero test data
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+value(size_t k, size_t i, size_t seed)
+{
+    return T(1 + (k * 7 + i * 3 + seed * 5) % 11);
+}
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, T>::type
+value(size_t k, size_t i, size_t seed)
+{
+    typedef typename T::value_type R;
+    return T(value<R>(k, i, seed), value<R>(k, i + 1, seed) / R(2));
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+conj_if(const T& x) { return x; }
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, T>::type
+conj_if(const T& x) { return std::conj(x); }
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+abs_sq_of(const T& x) { return x * x; }
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, typename T::value_type>::type
+abs_sq_of(const T& x) { return x.real() * x.real() + x.imag() * x.imag(); }
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type
+mod_of(const T& x, const T& y) { return x % y; }
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, T>::type
+mod_of(const T& x, const T& y) { return std::fmod(x, y); }
+
+template <typename T>
+using real_of = decltype(abs_sq_of(T()));
+
+
+// implementations under comparison
+
+template <size_t N, typename T>
+struct vec_impl {
+    typedef std::vector<vec<N,T>> storage;
+    static std::string name() { return "vec"; }
+
+    static storage make(size_t seed)
+    {
+        storage s(batch);
+        for (size_t k = 0; k < batch; ++k)
+            for (size_t i = 0; i < N; ++i)
+                s[k][i] = value<T>(k, i, seed);
+        return s;
+    }
+
+    static void construct(storage& o, size_t k, const T& x) { o[k] = vec<N,T>(x); }
+    static void add(storage& a, const storage& b, size_t k) { a[k] += b[k]; }
+    static void scale(storage& o, const T& s, const storage& a, size_t k) { o[k] = s * a[k]; }
+    static T dot(const storage& a, const storage& b, size_t k) { return a[k] * b[k]; }
+    static void cross(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        o[k] = Vec::cross(a[k], b[k]);
+    }
+    static double norm(const storage& a, size_t k) { return a[k].norm(); }
+    static real_of<T> norm2_sq(const storage& a, size_t k) { return a[k].norm2_sq(); }
+    static void mod(storage& o, const storage& a, const storage& b, size_t k) { o[k] = a[k] % b[k]; }
+    static void conj(storage& o, const storage& a, size_t k) { o[k] = Vec::conj(a[k]); }
+};
+
+template <size_t N, typename T>
+struct valarray_impl {
+    typedef std::vector<std::valarray<T>> storage;
+    static std::string name() { return "valarray"; }
+
+    static storage make(size_t seed)
+    {
+        storage s(batch, std::valarray<T>(N));
+        for (size_t k = 0; k < batch; ++k)
+            for (size_t i = 0; i < N; ++i)
+                s[k][i] = value<T>(k, i, seed);
+        return s;
+    }
+
+    static void construct(storage& o, size_t k, const T& x) { o[k] = std::valarray<T>(x, N); }
+    static void add(storage& a, const storage& b, size_t k) { a[k] += b[k]; }
+    static void scale(storage& o, const T& s, const storage& a, size_t k) { o[k] = s * a[k]; }
+    static T dot(const storage& a, const storage& b, size_t k)
+    {
+        return (a[k].apply(conj_if<T>) * b[k]).sum();
+    }
+    static void cross(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        const std::valarray<T>& l = a[k];
+        const std::valarray<T>& r = b[k];
+        o[k] = std::valarray<T>({conj_if(l[1] * r[2] - l[2] * r[1]),
+                                 conj_if(l[2] * r[0] - l[0] * r[2]),
+                                 conj_if(l[0] * r[1] - l[1] * r[0])});
+    }
+    static double norm(const storage& a, size_t k) { return std::sqrt(double(norm2_sq(a, k))); }
+    static real_of<T> norm2_sq(const storage& a, size_t k)
+    {
+        real_of<T> sum = 0;
+        for (size_t i = 0; i < N; ++i)
+            sum += abs_sq_of(a[k][i]);
+        return sum;
+    }
+    static void mod(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        for (size_t i = 0; i < N; ++i)
+            o[k][i] = mod_of(a[k][i], b[k][i]);
+    }
+    static void conj(storage& o, const storage& a, size_t k) { o[k] = a[k].apply(conj_if<T>); }
+};
+
+template <size_t N, typename T>
+struct array_impl {
+    typedef std::vector<std::array<T,N>> storage;
+    static std::string name() { return "std::array"; }
+
+    static storage make(size_t seed)
+    {
+        storage s(batch);
+        for (size_t k = 0; k < batch; ++k)
+            for (size_t i = 0; i < N; ++i)
+                s[k][i] = value<T>(k, i, seed);
+        return s;
+    }
+
+    static void construct(storage& o, size_t k, const T& x) { o[k].fill(x); }
+    static void add(storage& a, const storage& b, size_t k)
+    {
+        for (size_t i = 0; i < N; ++i)
+            a[k][i] += b[k][i];
+    }
+    static void scale(storage& o, const T& s, const storage& a, size_t k)
+    {
+        for (size_t i = 0; i < N; ++i)
+            o[k][i] = s * a[k][i];
+    }
+    static T dot(const storage& a, const storage& b, size_t k)
+    {
+        T sum = T();
+        for (size_t i = 0; i < N; ++i)
+            sum += conj_if(a[k][i]) * b[k][i];
+        return sum;
+    }
+    static void cross(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        const std::array<T,N>& l = a[k];
+        const std::array<T,N>& r = b[k];
+        o[k][0] = conj_if(l[1] * r[2] - l[2] * r[1]);
+        o[k][1] = conj_if(l[2] * r[0] - l[0] * r[2]);
+        o[k][2] = conj_if(l[0] * r[1] - l[1] * r[0]);
+    }
+    static double norm(const storage& a, size_t k) { return std::sqrt(double(norm2_sq(a, k))); }
+    static real_of<T> norm2_sq(const storage& a, size_t k)
+    {
+        real_of<T> sum = 0;
+        for (size_t i = 0; i < N; ++i)
+            sum += abs_sq_of(a[k][i]);
+        return sum;
+    }
+    static void mod(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        for (size_t i = 0; i < N; ++i)
+            o[k][i] = mod_of(a[k][i], b[k][i]);
+    }
+    static void conj(storage& o, const storage& a, size_t k)
+    {
+        for (size_t i = 0; i < N; ++i)
+            o[k][i] = conj_if(a[k][i]);
+    }
+};
+
+template <size_t N, typename T>
+struct raw_impl {
+    typedef std::vector<T> storage;
+    static std::string name() { return "raw"; }
+
+    static storage make(size_t seed)
+    {
+        storage s(batch * N);
+        for (size_t k = 0; k < batch; ++k)
+            for (size_t i = 0; i < N; ++i)
+                s[k*N+i] = value<T>(k, i, seed);
+        return s;
+    }
+
+    static void construct(storage& o, size_t k, const T& x)
+    {
+        T* p = &o[k*N];
+        for (size_t i = 0; i < N; ++i)
+            p[i] = x;
+    }
+    static void add(storage& a, const storage& b, size_t k)
+    {
+        T* p = &a[k*N];
+        const T* q = &b[k*N];
+        for (size_t i = 0; i < N; ++i)
+            p[i] += q[i];
+    }
+    static void scale(storage& o, const T& s, const storage& a, size_t k)
+    {
+        T* p = &o[k*N];
+        const T* q = &a[k*N];
+        for (size_t i = 0; i < N; ++i)
+            p[i] = s * q[i];
+    }
+    static T dot(const storage& a, const storage& b, size_t k)
+    {
+        const T* p = &a[k*N];
+        const T* q = &b[k*N];
+        T sum = T();
+        for (size_t i = 0; i < N; ++i)
+            sum += conj_if(p[i]) * q[i];
+        return sum;
+    }
+    static void cross(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        const T* l = &a[k*N];
+        const T* r = &b[k*N];
+        T* p = &o[k*N];
+        p[0] = conj_if(l[1] * r[2] - l[2] * r[1]);
+        p[1] = conj_if(l[2] * r[0] - l[0] * r[2]);
+        p[2] = conj_if(l[0] * r[1] - l[1] * r[0]);
+    }
+    static double norm(const storage& a, size_t k) { return std::sqrt(double(norm2_sq(a, k))); }
+    static real_of<T> norm2_sq(const storage& a, size_t k)
+    {
+        const T* p = &a[k*N];
+        real_of<T> sum = 0;
+        for (size_t i = 0; i < N; ++i)
+            sum += abs_sq_of(p[i]);
+        return sum;
+    }
+    static void mod(storage& o, const storage& a, const storage& b, size_t k)
+    {
+        T* p = &o[k*N];
+        const T* l = &a[k*N];
+        const T* r = &b[k*N];
+        for (size_t i = 0; i < N; ++i)
+            p[i] = mod_of(l[i], r[i]);
+    }
+    static void conj(storage& o, const storage& a, size_t k)
+    {
+        T* p = &o[k*N];
+        const T* q = &a[k*N];
+        for (size_t i = 0; i < N; ++i)
+            p[i] = conj_if(q[i]);
+    }
+};
+
+
+// registration
+
+template <typename I, typename T, size_t N, typename Body>
+void add_benchmark(const std::string& op, Body body, size_t ops_per_item = 1)
+{
+    typedef typename I::storage S;
+    std::string type = type_name<T>::get();
+    std::string name = op + "/" + I::name() + "/" + type + "/"
+        + std::to_string(N);
+    bench::register_benchmark(name, [body, ops_per_item](bench::state& st) {
+        S a = I::make(0), b = I::make(1), nb = I::make(1), out = I::make(2);
+        for (size_t k = 0; k < batch; ++k)
+            I::scale(nb, T(-1), b, k);
+        while (st.keep_running()) {
+            for (size_t k = 0; k < batch; ++k)
+                body(a, b, nb, out, k);
+            bench::clobber_memory();
+        }
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(out);
+        st.set_items_processed(st.iterations() * batch * ops_per_item);
+    }, {{"op", op}, {"impl", I::name()}, {"type", type},
+        {"N", std::to_string(N)}});
+}
+
+template <typename I, typename T, size_t N>
+void add_cross(std::false_type) {}
+
+template <typename I, typename T, size_t N>
+void add_cross(std::true_type)
+{
+    typedef typename I::storage S;
+    add_benchmark<I,T,N>("cross", [](S& a, S& b, S&, S& out, size_t k) {
+        I::cross(out, a, b, k);
+    });
+}
+
+template <typename I, typename T, size_t N>
+void add_mod(std::false_type) {}
+
+template <typename I, typename T, size_t N>
+void add_mod(std::true_type)
+{
+    typedef typename I::storage S;
+    add_benchmark<I,T,N>("mod", [](S& a, S& b, S&, S& out, size_t k) {
+        I::mod(out, a, b, k);
+    });
+}
+
+template <typename I, typename T, size_t N>
+void add_conj(std::false_type) {}
+
+template <typename I, typename T, size_t N>
+void add_conj(std::true_type)
+{
+    typedef typename I::storage S;
+    add_benchmark<I,T,N>("conj", [](S& a, S&, S&, S& out, size_t k) {
+        I::conj(out, a, k);
+    });
+}
+
+template <template <size_t, typename> class Impl, size_t N, typename T>
+void add_impl()
+{
+    typedef Impl<N,T> I;
+    typedef typename I::storage S;
+    const T x = value<T>(1, 2, 3);
+    add_benchmark<I,T,N>("construct", [x](S&, S&, S&, S& out, size_t k) {
+        I::construct(out, k, x);
+    });
+    // add and subtract again to keep integers from overflowing
+    add_benchmark<I,T,N>("add", [](S& a, S& b, S& nb, S&, size_t k) {
+        I::add(a, b, k);
+        I::add(a, nb, k);
+    }, 2);
+    add_benchmark<I,T,N>("scale", [x](S& a, S&, S&, S& out, size_t k) {
+        I::scale(out, x, a, k);
+    });
+    add_benchmark<I,T,N>("dot", [](S& a, S& b, S&, S&, size_t k) {
+        bench::do_not_optimize(I::dot(a, b, k));
+    });
+    add_cross<I,T,N>(std::integral_constant<bool, N == 3>());
+    add_benchmark<I,T,N>("norm", [](S& a, S&, S&, S&, size_t k) {
+        bench::do_not_optimize(I::norm(a, k));
+    });
+    add_benchmark<I,T,N>("norm2_sq", [](S& a, S&, S&, S&, size_t k) {
+        bench::do_not_optimize(I::norm2_sq(a, k));
+    });
+    add_mod<I,T,N>(std::integral_constant<bool, !is_complex<T>::value>());
+    add_conj<I,T,N>(is_complex<T>());
+}
+
+template <size_t N, typename T>
+void add_type()
+{
+    add_impl<vec_impl, N, T>();
+    add_impl<valarray_impl, N, T>();
+    add_impl<array_impl, N, T>();
+    add_impl<raw_impl, N, T>();
+}
+
+template <size_t N>
+void add_dim()
+{
+    add_type<N, int>();
+    add_type<N, float>();
+    add_type<N, double>();
+    add_type<N, std::complex<float>>();
+    add_type<N, std::complex<double>>();
+}
+
+int main(int argc, char *argv[])
+{
+    add_dim<2>();
+    add_dim<3>();
+    add_dim<4>();
+    add_dim<8>();
+    add_dim<16>();
+    add_dim<32>();
+    add_dim<64>();
+    return bench::run(argc, argv);
+}
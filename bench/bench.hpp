@@ -0,0 +1,301 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A minimal micro benchmark harness in the spirit of Google Benchmark. Its
+// command line flags and JSON output follow the conventions of the latter,
+// so that existing tooling for tracking results can be used.
+namespace bench {
+    template <typename T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+
+    // Like in Google Benchmark, only the loop over keep_running() is timed;
+    // setup before and teardown after it are not.
+    class state {
+    private:
+	typedef std::chrono::steady_clock clock;
+
+	size_t max_iter;
+	size_t iter;
+	size_t items;
+	clock::time_point t0, t1;
+	std::clock_t c0, c1;
+    public:
+	state(size_t n) : max_iter(n), iter(0), items(0), c0(0), c1(0) {}
+
+	bool keep_running()
+	{
+	    if (iter == 0) {
+		c0 = std::clock();
+		t0 = clock::now();
+	    }
+	    if (iter++ < max_iter)
+		return true;
+	    t1 = clock::now();
+	    c1 = std::clock();
+	    return false;
+	}
+
+	// whether the loop ran to completion, so that it has been timed
+	bool timed() const
+	{
+	    return iter > max_iter;
+	}
+
+	double real_time() const
+	{
+	    return std::chrono::duration<double>(t1 - t0).count();
+	}
+
+	double cpu_time() const
+	{
+	    return double(c1 - c0) / CLOCKS_PER_SEC;
+	}
+
+	size_t iterations() const
+	{
+	    return max_iter;
+	}
+
+	void set_items_processed(size_t n)
+	{
+	    items = n;
+	}
+
+	size_t items_processed() const
+	{
+	    return items;
+	}
+    };
+
+    struct benchmark {
+	std::string name;
+	// additional key/value pairs reported in the JSON output
+	std::vector<std::pair<std::string, std::string>> labels;
+	std::function<void(state&)> fn;
+    };
+
+    struct result {
+	const benchmark* bm;
+	size_t iterations;
+	double real_time;   // ns per iteration
+	double cpu_time;    // ns per iteration
+	double items_per_second;
+    };
+
+    inline std::vector<benchmark>& registry()
+    {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    inline void register_benchmark(
+            const std::string& name,
+            std::function<void(state&)> fn,
+            std::vector<std::pair<std::string, std::string>> labels = {})
+    {
+        registry().push_back({name, std::move(labels), std::move(fn)});
+    }
+
+    // run with increasing iteration counts until min_time is exceeded
+    inline result measure(const benchmark& bm, double min_time)
+    {
+        typedef std::chrono::steady_clock clock;
+        size_t n = 1;
+        for (;;) {
+            state st(n);
+            std::clock_t c0 = std::clock();
+            clock::time_point t0 = clock::now();
+            bm.fn(st);
+            clock::time_point t1 = clock::now();
+            std::clock_t c1 = std::clock();
+            double real = std::chrono::duration<double>(t1 - t0).count();
+            double cpu = double(c1 - c0) / CLOCKS_PER_SEC;
+            if (st.timed()) {
+                real = st.real_time();
+                cpu = st.cpu_time();
+            }
+            if (real >= min_time || n >= size_t(1) << 40) {
+                double items = double(st.items_processed());
+                return {&bm, n, 1e9 * real / n, 1e9 * cpu / n,
+                        real > 0 ? items / real : 0.};
+            }
+            // aim for 1.4 times the minimum time, growing at most tenfold
+            double factor = real > 0 ? 1.4 * min_time / real : 10.;
+            n = std::max(n + 1, size_t(n * std::min(factor, 10.)));
+        }
+    }
+
+    inline std::string json_escape(const std::string& s)
+    {
+        std::string res;
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                res += '\\';
+            res += c;
+        }
+        return res;
+    }
+
+    inline void write_json(std::ostream& os, const std::vector<result>& results)
+    {
+        std::time_t now = std::time(nullptr);
+        char date[64];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+                      std::localtime(&now));
+        os << "{\n  \"context\": {\n"
+           << "    \"date\": \"" << date << "\",\n"
+           << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+           << ",\n"
+#ifdef __VERSION__
+           << "    \"compiler\": \"" << json_escape(__VERSION__) << "\",\n"
+#endif
+#ifdef NDEBUG
+           << "    \"library_build_type\": \"release\"\n"
+#else
+           << "    \"library_build_type\": \"debug\"\n"
+#endif
+           << "  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const result& r = results[i];
+            os << (i ? ",\n" : "\n") << "    {\n"
+               << "      \"name\": \"" << json_escape(r.bm->name) << "\",\n"
+               << "      \"run_type\": \"iteration\",\n";
+            for (const auto& l : r.bm->labels)
+                os << "      \"" << json_escape(l.first) << "\": \""
+                   << json_escape(l.second) << "\",\n";
+            os << std::setprecision(10)
+               << "      \"iterations\": " << r.iterations << ",\n"
+               << "      \"real_time\": " << r.real_time << ",\n"
+               << "      \"cpu_time\": " << r.cpu_time << ",\n"
+               << "      \"time_unit\": \"ns\",\n"
+               << "      \"items_per_second\": " << r.items_per_second
+               << "\n    }";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    inline void write_console_header(std::ostream& os)
+    {
+        os << std::left << std::setw(48) << "Benchmark" << std::right
+           << std::setw(14) << "Time" << std::setw(14) << "CPU"
+           << std::setw(14) << "Iterations" << std::setw(16) << "items/s"
+           << "\n" << std::string(106, '-') << std::endl;
+    }
+
+    inline void write_console(std::ostream& os, const result& r)
+    {
+        os << std::left << std::setw(48) << r.bm->name << std::right
+           << std::fixed << std::setprecision(2)
+           << std::setw(11) << r.real_time << " ns"
+           << std::setw(11) << r.cpu_time << " ns"
+           << std::setw(14) << r.iterations
+           << std::scientific << std::setprecision(3)
+           << std::setw(16) << r.items_per_second
+           << std::defaultfloat << std::endl;
+    }
+
+    // Supported flags:
+    //   --benchmark_filter=<regex>       run matching benchmarks only
+    //   --benchmark_min_time=<seconds>   minimum time per benchmark
+    //   --benchmark_format=console|json  format of standard output
+    //   --benchmark_out=<file>           additionally write JSON to file
+    //   --benchmark_list_tests           list benchmarks without running
+    inline int run(int argc, char** argv)
+    {
+        std::string filter = ".", format = "console", out;
+        double min_time = 0.05;
+        bool list = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&](const std::string& flag, std::string& v) {
+                if (arg.compare(0, flag.size() + 1, flag + "=") != 0)
+                    return false;
+                v = arg.substr(flag.size() + 1);
+                return true;
+            };
+            std::string v;
+            if (value("--benchmark_filter", filter) ||
+                value("--benchmark_format", format) ||
+                value("--benchmark_out", out))
+                continue;
+            if (value("--benchmark_min_time", v)) {
+                min_time = std::atof(v.c_str());
+            } else if (arg == "--benchmark_list_tests") {
+                list = true;
+            } else {
+                std::cerr << "unknown argument: " << arg << std::endl;
+                return 1;
+            }
+        }
+        if (format != "console" && format != "json") {
+            std::cerr << "unknown format: " << format << std::endl;
+            return 1;
+        }
+
+        std::regex re(filter);
+        std::vector<result> results;
+        if (format == "console" && !list)
+            write_console_header(std::cout);
+        for (const benchmark& bm : registry()) {
+            if (!std::regex_search(bm.name, re))
+                continue;
+            if (list) {
+                std::cout << bm.name << std::endl;
+                continue;
+            }
+            results.push_back(measure(bm, min_time));
+            if (format == "console")
+                write_console(std::cout, results.back());
+        }
+        if (list)
+            return 0;
+        if (format == "json")
+            write_json(std::cout, results);
+        if (!out.empty()) {
+            std::ofstream ofs(out);
+            write_json(ofs, results);
+            if (!ofs) {
+                std::cerr << "could not write " << out << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,122 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_array.hpp"
+#include "../vec_compare.hpp"
+#include "../vec_simd.hpp"
+
+// Approximate comparison of 2^12 cache-resident pairs vec<3,double> which
+// differ by a relative 1e-14: a per-component loop like the CLOSE macro of
+// the tests, which returns at the first mismatch, against
+// count_approx_equal on std::vector and vec_array for each instruction
+// set, once with a relative tolerance and once with the ULP criterion
+// added. items_per_second counts pairs of vectors.
+
+using namespace Vec;
+
+typedef vec<3,double> V;
+
+const size_t n = 1 << 12;
+
+std::vector<V> random_vecs(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> gauss;
+    std::vector<V> x(n);
+    for (V& a : x)
+        a = {gauss(rng), gauss(rng), gauss(rng)};
+    return x;
+}
+
+template <typename Body>
+void add_benchmark(const std::string& op, const std::string& impl, Body body)
+{
+    bench::register_benchmark(op + "/" + impl, [body](bench::state& st) {
+        const std::vector<V> x = random_vecs(1);
+        std::vector<V> y = x;
+        for (V& a : y)
+            a *= 1 + 1e-14;
+        body(st, x, y);
+        st.set_items_processed(st.iterations() * n);
+    }, {{"op", op}, {"impl", impl}});
+}
+
+bool close_loop(const V& a, const V& b, double eps)
+{
+    for (size_t i = 0; i < 3; ++i)
+        if (std::abs(a[i] - b[i]) > eps * std::max(std::abs(a[i]),
+                                                   std::abs(b[i])))
+            return false;
+    return true;
+}
+
+void add_isa(const std::string& op, const tolerance& tol, simd_isa isa,
+             const std::string& isa_name)
+{
+    if (isa > simd_detect())
+        return;
+    add_benchmark(op, "vector_" + isa_name,
+        [tol, isa](bench::state& st, const std::vector<V>& x,
+                   const std::vector<V>& y) {
+            simd_select(isa);
+            while (st.keep_running())
+                bench::do_not_optimize(count_approx_equal(x, y, tol));
+            simd_select(simd_detect());
+        });
+    add_benchmark(op, "array_" + isa_name,
+        [tol, isa](bench::state& st, const std::vector<V>& x,
+                   const std::vector<V>& y) {
+            const vec_array<3,double> a(x.begin(), x.end());
+            const vec_array<3,double> b(y.begin(), y.end());
+            simd_select(isa);
+            while (st.keep_running())
+                bench::do_not_optimize(count_approx_equal(a, b, tol));
+            simd_select(simd_detect());
+        });
+}
+
+int main(int argc, char *argv[])
+{
+    add_benchmark("relative", "close_loop",
+        [](bench::state& st, const std::vector<V>& x,
+           const std::vector<V>& y) {
+            while (st.keep_running()) {
+                size_t count = 0;
+                for (size_t k = 0; k < n; ++k)
+                    count += close_loop(x[k], y[k], 1e-12);
+                bench::do_not_optimize(count);
+            }
+        });
+
+    const simd_isa isas[] = {simd_isa::scalar, simd_isa::sse2,
+                             simd_isa::avx2, simd_isa::avx512};
+    const char* isa_names[] = {"scalar", "sse2", "avx2", "avx512"};
+    for (size_t i = 0; i < 4; ++i)
+        add_isa("relative", tolerance::relative(1e-12), isas[i],
+                isa_names[i]);
+    for (size_t i = 0; i < 4; ++i)
+        add_isa("relative_ulp", tolerance::relative(1e-12).or_ulp(4),
+                isas[i], isa_names[i]);
+
+    return bench::run(argc, argv);
+}
@@ -0,0 +1,180 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_hash.hpp"
+
+// Hash maps keyed on the sites of an L x L x L lattice, vec<3,int>:
+// flat_hash_map and std::unordered_map with std::hash<vec>, compared with
+// std::unordered_map on coordinates packed by hand into a 64 bit integer.
+// Each benchmark iteration inserts or looks up every site, in random
+// order; items_per_second counts sites.
+
+using namespace Vec;
+
+typedef vec<3,int> site;
+
+const int pack_bits = 21;
+
+uint64_t pack(const site& a)
+{
+    const uint64_t m = (uint64_t(1) << pack_bits) - 1;
+    return (uint64_t(a[0]) & m) << (2 * pack_bits)
+        | (uint64_t(a[1]) & m) << pack_bits | (uint64_t(a[2]) & m);
+}
+
+struct flat_impl {
+    typedef flat_hash_map<site, int> map;
+    static std::string name() { return "flat_hash_map"; }
+    static void insert(map& m, const site& a, int v) { m.try_emplace(a, v); }
+    static int find(const map& m, const site& a)
+    {
+        auto it = m.find(a);
+        return it == m.end() ? -1 : it->second;
+    }
+};
+
+struct unordered_impl {
+    typedef std::unordered_map<site, int> map;
+    static std::string name() { return "unordered_map"; }
+    static void insert(map& m, const site& a, int v) { m.emplace(a, v); }
+    static int find(const map& m, const site& a)
+    {
+        auto it = m.find(a);
+        return it == m.end() ? -1 : it->second;
+    }
+};
+
+struct packed_impl {
+    typedef std::unordered_map<uint64_t, int> map;
+    static std::string name() { return "unordered_map_packed"; }
+    static void insert(map& m, const site& a, int v) { m.emplace(pack(a), v); }
+    static int find(const map& m, const site& a)
+    {
+        auto it = m.find(pack(a));
+        return it == m.end() ? -1 : it->second;
+    }
+};
+
+// all sites of the lattice centred at the origin, shuffled
+std::vector<site> lattice(int L, unsigned seed)
+{
+    std::vector<site> x;
+    x.reserve(size_t(L) * L * L);
+    for (int i = 0; i < L; ++i)
+        for (int j = 0; j < L; ++j)
+            for (int k = 0; k < L; ++k)
+                x.push_back({i - L / 2, j - L / 2, k - L / 2});
+    std::shuffle(x.begin(), x.end(), std::mt19937(seed));
+    return x;
+}
+
+template <typename Body>
+void add_benchmark(const std::string& op, const std::string& impl, int L,
+                   Body body)
+{
+    const std::string n = std::to_string(size_t(L) * L * L);
+    bench::register_benchmark(op + "/" + impl + "/" + n,
+        [L, body](bench::state& st) {
+            const std::vector<site> x = lattice(L, 1);
+            body(st, x);
+            st.set_items_processed(st.iterations() * x.size());
+        }, {{"op", op}, {"impl", impl}, {"N", n}});
+}
+
+template <typename I>
+void add_impl(int L)
+{
+    typedef typename I::map map;
+    add_benchmark("insert", I::name(), L,
+        [](bench::state& st, const std::vector<site>& x) {
+            while (st.keep_running()) {
+                map m;
+                for (size_t k = 0; k < x.size(); ++k)
+                    I::insert(m, x[k], int(k));
+                bench::do_not_optimize(m);
+                bench::clobber_memory();
+            }
+        });
+    add_benchmark("find", I::name(), L,
+        [L](bench::state& st, const std::vector<site>& x) {
+            map m;
+            for (size_t k = 0; k < x.size(); ++k)
+                I::insert(m, x[k], int(k));
+            const std::vector<site> y = lattice(L, 2);
+            while (st.keep_running()) {
+                int sum = 0;
+                for (const site& a : y)
+                    sum += I::find(m, a);
+                bench::do_not_optimize(sum);
+            }
+        });
+    add_benchmark("miss", I::name(), L,
+        [L](bench::state& st, const std::vector<site>& x) {
+            map m;
+            for (size_t k = 0; k < x.size(); ++k)
+                I::insert(m, x[k], int(k));
+            std::vector<site> y = lattice(L, 2);
+            for (site& a : y)
+                a[2] += L;
+            while (st.keep_running()) {
+                int sum = 0;
+                for (const site& a : y)
+                    sum += I::find(m, a);
+                bench::do_not_optimize(sum);
+            }
+        });
+}
+
+void add_hash(int L)
+{
+    add_benchmark("hash", "hash64", L,
+        [](bench::state& st, const std::vector<site>& x) {
+            while (st.keep_running()) {
+                uint64_t h = 0;
+                for (const site& a : x)
+                    h ^= hash64(a);
+                bench::do_not_optimize(h);
+            }
+        });
+    add_benchmark("hash", "packed", L,
+        [](bench::state& st, const std::vector<site>& x) {
+            while (st.keep_running()) {
+                uint64_t h = 0;
+                for (const site& a : x)
+                    h ^= std::hash<uint64_t>()(pack(a));
+                bench::do_not_optimize(h);
+            }
+        });
+}
+
+int main(int argc, char *argv[])
+{
+    for (int L : {32, 128}) {
+        add_hash(L);
+        add_impl<flat_impl>(L);
+        add_impl<unordered_impl>(L);
+        add_impl<packed_impl>(L);
+    }
+    return bench::run(argc, argv);
+}
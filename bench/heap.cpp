@@ -0,0 +1,250 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <valarray>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_heap.hpp"
+
+// Compares long vectors: heap_vec<N,T> with vec<N,T> and std::valarray<T>
+// for N beyond the break-even point of vec and valarray. Each benchmark
+// iteration operates on a single vector; items_per_second counts vector
+// operations. The vec operands are allocated on the heap as well, so that
+// large N do not exhaust the stack.
+
+using namespace Vec;
+
+template <typename T> struct type_name;
+template <> struct type_name<double> { static std::string get() { return "double"; } };
+template <> struct type_name<std::complex<double>> {
+    static std::string get() { return "complex<double>"; }
+};
+
+// deterministic, nonzero test data
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+value(size_t i, size_t seed)
+{
+    return T(1 + (i * 3 + seed * 5) % 11);
+}
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, T>::type
+value(size_t i, size_t seed)
+{
+    typedef typename T::value_type R;
+    return T(value<R>(i, seed), value<R>(i + 1, seed) / R(2));
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+conj_if(const T& x) { return x; }
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, T>::type
+conj_if(const T& x) { return std::conj(x); }
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+abs_sq_of(const T& x) { return x * x; }
+
+template <typename T>
+typename std::enable_if<is_complex<T>::value, typename T::value_type>::type
+abs_sq_of(const T& x) { return x.real() * x.real() + x.imag() * x.imag(); }
+
+template <typename T>
+using real_of = decltype(abs_sq_of(T()));
+
+
+// implementations under comparison
+
+template <template <size_t, typename> class V, size_t N, typename T>
+struct vec_like_impl {
+    typedef V<N,T> type;
+    typedef std::unique_ptr<type> storage;
+
+    static storage make(size_t seed)
+    {
+        storage s(new type);
+        for (size_t i = 0; i < N; ++i)
+            (*s)[i] = value<T>(i, seed);
+        return s;
+    }
+
+    static void add(storage& a, const storage& b) { *a += *b; }
+    static void expr(storage& o, const storage& a, const storage& b)
+    {
+        *o = *a + T(2) * *b - *o / T(3);
+    }
+    static void temporary(const storage& a, const storage& b)
+    {
+        type c = *a + *b;
+        bench::do_not_optimize(c[N / 2]);
+    }
+    static void scale(storage& o, const T& s, const storage& a) { *o = s * *a; }
+    static T dot(const storage& a, const storage& b) { return *a * *b; }
+    static real_of<T> norm2_sq(const storage& a) { return a->norm2_sq(); }
+    static void conj(storage& o, const storage& a) { *o = Vec::conj(*a); }
+};
+
+template <size_t N, typename T>
+using heap_vec_n = heap_vec<N,T>;
+
+template <size_t N, typename T>
+struct heap_impl : vec_like_impl<heap_vec_n, N, T> {
+    static std::string name() { return "heap_vec"; }
+};
+
+template <size_t N, typename T>
+struct vec_impl : vec_like_impl<vec, N, T> {
+    static std::string name() { return "vec"; }
+};
+
+template <size_t N, typename T>
+struct valarray_impl {
+    typedef std::valarray<T> storage;
+    static std::string name() { return "valarray"; }
+
+    static storage make(size_t seed)
+    {
+        storage s(N);
+        for (size_t i = 0; i < N; ++i)
+            s[i] = value<T>(i, seed);
+        return s;
+    }
+
+    static void add(storage& a, const storage& b) { a += b; }
+    static void expr(storage& o, const storage& a, const storage& b)
+    {
+        o = a + T(2) * b - o / T(3);
+    }
+    static void temporary(const storage& a, const storage& b)
+    {
+        storage c = a + b;
+        bench::do_not_optimize(c[N / 2]);
+    }
+    static void scale(storage& o, const T& s, const storage& a) { o = s * a; }
+    static T dot(const storage& a, const storage& b)
+    {
+        return (a.apply(conj_if<T>) * b).sum();
+    }
+    static real_of<T> norm2_sq(const storage& a)
+    {
+        real_of<T> sum = 0;
+        for (size_t i = 0; i < N; ++i)
+            sum += abs_sq_of(a[i]);
+        return sum;
+    }
+    static void conj(storage& o, const storage& a) { o = a.apply(conj_if<T>); }
+};
+
+
+// registration
+
+template <typename I, typename T, size_t N, typename Body>
+void add_benchmark(const std::string& op, Body body, size_t ops_per_item = 1)
+{
+    typedef typename I::storage S;
+    std::string type = type_name<T>::get();
+    std::string name = op + "/" + I::name() + "/" + type + "/"
+        + std::to_string(N);
+    bench::register_benchmark(name, [body, ops_per_item](bench::state& st) {
+        S a = I::make(0), b = I::make(1), nb = I::make(1), out = I::make(2);
+        I::scale(nb, T(-1), b);
+        while (st.keep_running()) {
+            body(a, b, nb, out);
+            bench::clobber_memory();
+        }
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(out);
+        st.set_items_processed(st.iterations() * ops_per_item);
+    }, {{"op", op}, {"impl", I::name()}, {"type", type},
+        {"N", std::to_string(N)}});
+}
+
+template <typename I, typename T, size_t N>
+void add_conj(std::false_type) {}
+
+template <typename I, typename T, size_t N>
+void add_conj(std::true_type)
+{
+    typedef typename I::storage S;
+    add_benchmark<I,T,N>("conj", [](S& a, S&, S&, S& out) {
+        I::conj(out, a);
+    });
+}
+
+template <template <size_t, typename> class Impl, size_t N, typename T>
+void add_impl()
+{
+    typedef Impl<N,T> I;
+    typedef typename I::storage S;
+    const T x = value<T>(2, 3);
+    // add and subtract again to keep the values bounded
+    add_benchmark<I,T,N>("add", [](S& a, S& b, S& nb, S&) {
+        I::add(a, b);
+        I::add(a, nb);
+    }, 2);
+    add_benchmark<I,T,N>("expr", [](S& a, S& b, S&, S& out) {
+        I::expr(out, a, b);
+    });
+    add_benchmark<I,T,N>("temporary", [](S& a, S& b, S&, S&) {
+        I::temporary(a, b);
+    });
+    add_benchmark<I,T,N>("scale", [x](S& a, S&, S&, S& out) {
+        I::scale(out, x, a);
+    });
+    add_benchmark<I,T,N>("dot", [](S& a, S& b, S&, S&) {
+        bench::do_not_optimize(I::dot(a, b));
+    });
+    add_benchmark<I,T,N>("norm2_sq", [](S& a, S&, S&, S&) {
+        bench::do_not_optimize(I::norm2_sq(a));
+    });
+    add_conj<I,T,N>(is_complex<T>());
+}
+
+template <size_t N, typename T>
+void add_type()
+{
+    add_impl<heap_impl, N, T>();
+    add_impl<vec_impl, N, T>();
+    add_impl<valarray_impl, N, T>();
+}
+
+template <size_t N>
+void add_dim()
+{
+    add_type<N, double>();
+    add_type<N, std::complex<double>>();
+}
+
+int main(int argc, char *argv[])
+{
+    add_dim<8>();
+    add_dim<16>();
+    add_dim<32>();
+    add_dim<64>();
+    add_dim<256>();
+    add_dim<1024>();
+    add_dim<4096>();
+    add_dim<1 << 16>();
+    return bench::run(argc, argv);
+}
@@ -0,0 +1,91 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <complex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_parallel.hpp"
+
+// Scaling of the batch transforms vec_map and vec_zip with the number of
+// threads. Each benchmark iteration transforms a batch of vectors too large
+// for the caches; items_per_second counts transformed vectors. The thread
+// counts are powers of two up to the number of hardware threads.
+
+using namespace Vec;
+
+const size_t batch = 1 << 20;
+
+template <typename Body>
+void add_scaling(const std::string& op, Body body)
+{
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 1; ; t = std::min(2 * t, hw)) {
+        const std::string name = "parallel/" + op + "/threads:"
+            + std::to_string(t);
+        bench::register_benchmark(name, [body, t](bench::state& st) {
+            thread_pool pool(t);
+            body(st, pool);
+            st.set_items_processed(st.iterations() * batch);
+        }, {{"op", op}, {"threads", std::to_string(t)}});
+        if (t == hw)
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    typedef vec<3,double> V;
+    typedef vec<3,std::complex<double>> C;
+
+    add_scaling("map_normalize", [](bench::state& st, thread_pool& pool) {
+        std::vector<V> x(batch, V{1., 2., 3.}), y(batch);
+        while (st.keep_running()) {
+            vec_map(x, y, [](const V& v) { return V(v / v.norm()); }, pool);
+            bench::clobber_memory();
+        }
+    });
+    add_scaling("map_inplace_scale", [](bench::state& st, thread_pool& pool) {
+        std::vector<V> x(batch, V{1., 2., 3.});
+        while (st.keep_running()) {
+            vec_map(x, [](const V& v) { return V(0.999 * v); }, pool);
+            bench::clobber_memory();
+        }
+    });
+    add_scaling("zip_cross", [](bench::state& st, thread_pool& pool) {
+        std::vector<V> x(batch, V{1., 2., 3.}), b(batch, V{0., 0., 1.}), y;
+        while (st.keep_running()) {
+            vec_zip(x, b, y, [](const V& s, const V& h) {
+                return V(cross(s, h));
+            }, pool);
+            bench::clobber_memory();
+        }
+    });
+    add_scaling("zip_inplace_cdot", [](bench::state& st, thread_pool& pool) {
+        std::vector<C> x(batch, C{{1., 1.}, {2., 0.}, {0., 3.}}), b = x;
+        while (st.keep_running()) {
+            vec_zip(x, b, [](const C& a, const C& c) {
+                return C(a - 1e-3 * (a * c) * c);
+            }, pool);
+            bench::clobber_memory();
+        }
+    });
+
+    return bench::run(argc, argv);
+}
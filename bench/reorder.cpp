@@ -0,0 +1,149 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_cell_list.hpp"
+#include "../vec_reorder.hpp"
+
+// Space-filling curve reordering of 2^20 randomly ordered points
+// vec<3,double> at unit density: computing the keys (portable and BMI2),
+// sorting them (radix sort against std::sort of key/index pairs), the
+// whole sfc_reorder, and the payoff: a loop over the neighbour pairs
+// within a cutoff of 1.2, accumulating a pair force, in random, Morton
+// and Hilbert order. items_per_second counts points, or pairs for the
+// latter.
+
+using namespace Vec;
+
+typedef vec<3,double> V;
+
+const size_t n = 1 << 20;
+
+std::vector<V> random_points(unsigned seed)
+{
+    const double L = std::cbrt(double(n));
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uni(0., L);
+    std::vector<V> x(n);
+    for (V& a : x)
+        a = {uni(rng), uni(rng), uni(rng)};
+    return x;
+}
+
+template <typename Body>
+void add_benchmark(const std::string& op, const std::string& impl, Body body)
+{
+    bench::register_benchmark(op + "/" + impl, [body](bench::state& st) {
+        std::vector<V> x = random_points(1);
+        st.set_items_processed(st.iterations() * body(st, x));
+    }, {{"op", op}, {"impl", impl}});
+}
+
+void add_keys(sfc_curve curve, const std::string& name, bool bmi2)
+{
+    if (bmi2 && !sfc_detect_bmi2())
+        return;
+    add_benchmark("keys", name + (bmi2 ? "_bmi2" : "_portable"),
+        [curve, bmi2](bench::state& st, std::vector<V>& x) {
+            sfc_select_bmi2(bmi2);
+            const sfc_grid<3,double> grid =
+                sfc_grid<3,double>::bounding(x.data(), x.size());
+            std::vector<uint64_t> keys(x.size());
+            while (st.keep_running()) {
+                sfc_keys(x.data(), x.size(), grid, curve, keys.data());
+                bench::clobber_memory();
+            }
+            sfc_select_bmi2(true);
+            return x.size();
+        });
+}
+
+// sum of a pair force over all pairs closer than the cutoff
+size_t add_pairs(bench::state& st, const std::vector<V>& x)
+{
+    cell_list<3,double> cells(1.2);
+    cells.build(x);
+    const std::vector<std::pair<size_t,size_t>> pairs = cells.pairs(x);
+    std::vector<V> f(x.size());
+    while (st.keep_running()) {
+        for (const auto& p : pairs) {
+            V d = x[p.first] - x[p.second];
+            d *= 1. / (d * d);
+            f[p.first] += d;
+            f[p.second] -= d;
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(f[0]);
+    return pairs.size();
+}
+
+int main(int argc, char *argv[])
+{
+    add_keys(sfc_curve::morton, "morton", false);
+    add_keys(sfc_curve::morton, "morton", true);
+    add_keys(sfc_curve::hilbert, "hilbert", false);
+    add_keys(sfc_curve::hilbert, "hilbert", true);
+
+    add_benchmark("sort", "radix", [](bench::state& st, std::vector<V>& x) {
+        const std::vector<uint64_t> keys = sfc_keys(x, sfc_curve::morton);
+        while (st.keep_running()) {
+            std::vector<uint64_t> k = keys;
+            bench::do_not_optimize(radix_sort_permutation(k).data());
+        }
+        return x.size();
+    });
+    add_benchmark("sort", "std_sort", [](bench::state& st, std::vector<V>& x) {
+        const std::vector<uint64_t> keys = sfc_keys(x, sfc_curve::morton);
+        while (st.keep_running()) {
+            std::vector<std::pair<uint64_t,size_t>> k(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i)
+                k[i] = {keys[i], i};
+            std::sort(k.begin(), k.end());
+            bench::do_not_optimize(k.data());
+        }
+        return x.size();
+    });
+
+    add_benchmark("reorder", "hilbert", [](bench::state& st, std::vector<V>& x) {
+        std::vector<V> v(x.size());
+        while (st.keep_running()) {
+            std::vector<V> y = x;
+            bench::do_not_optimize(sfc_reorder(y, sfc_curve::hilbert, v).data());
+        }
+        return x.size();
+    });
+
+    add_benchmark("pairs", "random", add_pairs);
+    add_benchmark("pairs", "morton", [](bench::state& st, std::vector<V>& x) {
+        sfc_reorder(x, sfc_curve::morton);
+        return add_pairs(st, x);
+    });
+    add_benchmark("pairs", "hilbert", [](bench::state& st, std::vector<V>& x) {
+        sfc_reorder(x, sfc_curve::hilbert);
+        return add_pairs(st, x);
+    });
+
+    return bench::run(argc, argv);
+}
@@ -0,0 +1,107 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+#include "../vec_box.hpp"
+#include "../vec_simd.hpp"
+#include "../vec_structure.hpp"
+
+// Density modes rho(q) of 4096 random points vec<3,double> in a cubic box
+// at unit density, at the 2456 wave vectors commensurate with the box with
+// Miller indices |h_i| <= 8 (one of each pair +-h): std::exp of a complex
+// phase per pair, as written by hand, density_modes (a sine and a cosine
+// per pair), and lattice_density_modes with each instruction set.
+// items_per_second counts pairs of wave vectors and points.
+
+using namespace Vec;
+
+typedef vec<3,double> V;
+
+const size_t n = 4096;
+const int hmax = 8;
+
+struct setup {
+    periodic_box<3,double> box;
+    std::vector<V> x;
+    std::vector<vec<3,int>> h;
+    std::vector<V> q;
+
+    setup() : box(V(std::cbrt(double(n)))), x(n), h(lattice_indices<3>(hmax))
+    {
+        std::mt19937_64 rng(1);
+        std::uniform_real_distribution<double> uni(0., box.lengths()[0]);
+        for (V& a : x)
+            a = {uni(rng), uni(rng), uni(rng)};
+        for (const vec<3,int>& k : h)
+            q.push_back(lattice_wave_vector(box, k));
+    }
+};
+
+template <typename Body>
+void add_benchmark(const std::string& impl, Body body)
+{
+    bench::register_benchmark("modes/" + impl, [body](bench::state& st) {
+        const setup s;
+        std::vector<std::complex<double>> rho(s.h.size());
+        while (st.keep_running()) {
+            body(s, rho);
+            bench::clobber_memory();
+        }
+        bench::do_not_optimize(rho[0]);
+        st.set_items_processed(st.iterations() * s.h.size() * n);
+    }, {{"op", "modes"}, {"impl", impl}});
+}
+
+void add_lattice(simd_isa isa, const std::string& name)
+{
+    if (isa > simd_detect())
+        return;
+    add_benchmark("lattice_" + name,
+        [isa](const setup& s, std::vector<std::complex<double>>& rho) {
+            simd_select(isa);
+            lattice_density_modes(s.box, s.h.data(), s.h.size(), s.x.data(),
+                                  n, rho.data());
+            simd_select(simd_detect());
+        });
+}
+
+int main(int argc, char *argv[])
+{
+    add_benchmark("exp", [](const setup& s,
+                            std::vector<std::complex<double>>& rho) {
+        for (size_t k = 0; k < s.q.size(); ++k) {
+            std::complex<double> sum;
+            for (const V& a : s.x)
+                sum += std::exp(std::complex<double>(0., s.q[k] * a));
+            rho[k] = sum;
+        }
+    });
+    add_benchmark("sincos", [](const setup& s,
+                               std::vector<std::complex<double>>& rho) {
+        density_modes(s.q.data(), s.q.size(), s.x.data(), n, rho.data());
+    });
+    add_lattice(simd_isa::scalar, "scalar");
+    add_lattice(simd_isa::sse2, "sse2");
+    add_lattice(simd_isa::avx2, "avx2");
+    add_lattice(simd_isa::avx512, "avx512");
+
+    return bench::run(argc, argv);
+}
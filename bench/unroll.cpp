@@ -0,0 +1,179 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "../vec.hpp"
+
+// The operations of vec<N,double> for N = 2, 3, 4 as unrolled over
+// std::index_sequence. The same source is built a second time with
+// VEC_UNROLL_MAX=0 as the target bench_unroll_loop, which takes the plain
+// loops instead; the impl label tells the two apart. Each benchmark
+// iteration processes a batch held in cache in a noinline kernel, whose
+// instructions can be compared between the two binaries with objdump, e.g.
+// `objdump -d bench_unroll | c++filt | grep -A40 'kernel_dot<3'`.
+// items_per_second counts vectors.
+
+using namespace Vec;
+
+#if VEC_UNROLL_MAX > 0
+const std::string impl = "unrolled";
+#else
+const std::string impl = "loop";
+#endif
+
+const size_t batch = 1024;
+
+template <size_t N>
+using batch_t = std::vector<vec<N,double>>;
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_construct(const double* p, batch_t<N>& x)
+{
+    for (size_t k = 0; k < x.size(); ++k)
+        x[k] = vec<N,double>(p + k % 8);
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_broadcast(batch_t<N>& x)
+{
+    for (size_t k = 0; k < x.size(); ++k)
+        x[k] = vec<N,double>(double(k));
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_init_list(batch_t<N>& x)
+{
+    for (size_t k = 0; k < x.size(); ++k)
+        x[k] = {double(k), 1.};
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_axpy(double dt, const batch_t<N>& v, batch_t<N>& x)
+{
+    for (size_t k = 0; k < x.size(); ++k)
+        x[k] += dt * v[k];
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_scale(double s, batch_t<N>& x)
+{
+    for (size_t k = 0; k < x.size(); ++k)
+        x[k] *= s;
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_dot(const batch_t<N>& a, const batch_t<N>& b, double* out)
+{
+    for (size_t k = 0; k < a.size(); ++k)
+        out[k] = a[k] * b[k];
+}
+
+template <size_t N>
+__attribute__((noinline))
+void kernel_norm2_sq(const batch_t<N>& a, double* out)
+{
+    for (size_t k = 0; k < a.size(); ++k)
+        out[k] = a[k].norm2_sq();
+}
+
+template <size_t N>
+__attribute__((noinline))
+size_t kernel_equal(const batch_t<N>& a, const batch_t<N>& b)
+{
+    size_t n = 0;
+    for (size_t k = 0; k < a.size(); ++k)
+        n += a[k] == b[k];
+    return n;
+}
+
+__attribute__((noinline))
+void kernel_cross(const batch_t<3>& a, const batch_t<3>& b, batch_t<3>& out)
+{
+    for (size_t k = 0; k < a.size(); ++k)
+        out[k] = cross(a[k], b[k]);
+}
+
+template <size_t N, typename Body>
+void add(const std::string& op, Body body)
+{
+    const std::string n = std::to_string(N);
+    bench::register_benchmark(op + "/" + impl + "/" + n,
+        [body](bench::state& st) {
+            batch_t<N> a(batch), b(batch), c(batch);
+            std::vector<double> out(batch);
+            for (size_t k = 0; k < batch; ++k)
+                for (size_t i = 0; i < N; ++i) {
+                    a[k][i] = std::sin(double(k + i));
+                    b[k][i] = k % 3 ? a[k][i] : std::cos(double(k * i));
+                }
+            while (st.keep_running()) {
+                body(a, b, c, out.data());
+                bench::clobber_memory();
+            }
+            st.set_items_processed(st.iterations() * batch);
+        }, {{"op", op}, {"impl", impl}, {"N", n}});
+}
+
+template <size_t N>
+void add_all()
+{
+    static const double p[N + 8] = {};
+    add<N>("construct", [](batch_t<N>&, batch_t<N>&, batch_t<N>& c, double*) {
+            kernel_construct<N>(p, c);
+        });
+    add<N>("broadcast", [](batch_t<N>&, batch_t<N>&, batch_t<N>& c, double*) {
+            kernel_broadcast<N>(c);
+        });
+    add<N>("init_list", [](batch_t<N>&, batch_t<N>&, batch_t<N>& c, double*) {
+            kernel_init_list<N>(c);
+        });
+    add<N>("axpy", [](batch_t<N>& a, batch_t<N>&, batch_t<N>& c, double*) {
+            kernel_axpy<N>(1e-3, a, c);
+        });
+    add<N>("scale", [](batch_t<N>&, batch_t<N>&, batch_t<N>& c, double*) {
+            kernel_scale<N>(0.999, c);
+        });
+    add<N>("dot", [](batch_t<N>& a, batch_t<N>& b, batch_t<N>&, double* out) {
+            kernel_dot<N>(a, b, out);
+        });
+    add<N>("norm2_sq", [](batch_t<N>& a, batch_t<N>&, batch_t<N>&, double* out) {
+            kernel_norm2_sq<N>(a, out);
+        });
+    add<N>("equal", [](batch_t<N>& a, batch_t<N>& b, batch_t<N>&, double* out) {
+            bench::do_not_optimize(*out = double(kernel_equal<N>(a, b)));
+        });
+}
+
+int main(int argc, char *argv[])
+{
+    add_all<2>();
+    add_all<3>();
+    add_all<4>();
+    add<3>("cross", [](batch_t<3>& a, batch_t<3>& b, batch_t<3>& c, double*) {
+            kernel_cross(a, b, c);
+        });
+
+    return bench::run(argc, argv);
+}
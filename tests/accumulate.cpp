@@ -0,0 +1,122 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "close.hpp"
+#include "../vec_accumulate.hpp"
+
+using namespace Vec;
+
+// select the policy for long double per type
+namespace Vec {
+    template <>
+    struct accumulation<long double> {
+        typedef accumulate_compensated type;
+    };
+}
+
+const size_t N = 4096;
+
+int main ()
+{
+    // float storage, double accumulation
+    vec<N,float> a, b;
+    double ref = 0;
+    for (size_t i = 0; i < N; ++i) {
+        a[i] = 1.f + float(i % 10) * 1e-4f;
+        b[i] = float(1 + i % 3);
+        ref += double(a[i]) * double(b[i]);
+    }
+    static_assert(std::is_same<decltype(dot(a, b)), float>::value,
+                  "plain by default");
+    static_assert(std::is_same<decltype(dot<accumulate_wide>(a, b)),
+                               double>::value, "widened");
+    assert(dot(a, b) == a * b);
+    assert(std::abs(dot<accumulate_wide>(a, b) - ref) < 1e-9 * ref);
+    assert(std::abs(double(dot<accumulate_compensated>(a, b)) - ref)
+           <= std::abs(double(a * b) - ref));
+    assert(std::abs(dot<accumulate_in<long double>>(a, b) - ref) < 1e-9 * ref);
+    assert(std::abs(norm2_sq<accumulate_wide>(a) - double(a.norm2_sq()))
+           < 1e-5 * norm2_sq<accumulate_wide>(a));
+
+    // squares which overflow in float
+    vec<2,float> big{3e20f, 4e20f};
+    assert(std::isinf(big.norm()));
+    assert(CLOSE(norm<accumulate_wide>(big), 5e20, 1e-15));
+
+    // int32 storage, int64 accumulation
+    vec<3,int> m{50000, -60000, 70000};
+    static_assert(std::is_same<decltype(dot<accumulate_wide>(m, m)),
+                               int64_t>::value, "widened");
+    assert(dot<accumulate_wide>(m, m) == int64_t(11000000000));
+    assert(norm2_sq<accumulate_wide>(m) == int64_t(11000000000));
+    assert(CLOSE(norm<accumulate_wide>(m), std::sqrt(11e9), 1e-15));
+
+    // complex
+    typedef std::complex<float> C;
+    vec<2,C> z{C(1, 2), C(3, -4)}, w{C(0, 1), C(2, 2)};
+    std::complex<double> zw = dot<accumulate_wide>(z, w);
+    assert(zw == std::complex<double>(z * w));
+    assert(norm2_sq<accumulate_wide>(z) == 30.);
+
+    // compensated summation
+    vec<N,float> tenth(0.1f);
+    float plain = norm2_sq(tenth), comp = norm2_sq<accumulate_compensated>(tenth);
+    double exact = N * double(0.1f * 0.1f);
+    assert(std::abs(comp - exact) < std::abs(plain - exact));
+
+    // per-type selection
+    vec<N,long double> l(0.1L);
+    static_assert(std::is_same<decltype(dot(l, l)), long double>::value, "");
+    assert(std::abs(dot(l, l) - N * (0.1L * 0.1L)) <= 1e-18L);
+
+    // batch versions agree with the single-vector ones
+    std::vector<vec<3,float>> x, y;
+    for (size_t k = 0; k < 100; ++k) {
+        x.push_back({float(k), 0.1f * k, 1.f / (k + 1)});
+        y.push_back({1.f, float(k % 5), -0.5f * k});
+    }
+    vec_array<3,float> xa(x.begin(), x.end()), ya(y.begin(), y.end());
+    std::vector<double> d1 = dot<accumulate_wide>(x, y);
+    std::vector<double> d2 = dot<accumulate_wide>(xa, ya);
+    std::vector<double> n1 = norm2_sq<accumulate_wide>(x);
+    std::vector<double> n2 = norm2_sq<accumulate_wide>(xa);
+    std::vector<double> r1 = norm<accumulate_wide>(x);
+    std::vector<double> r2 = norm<accumulate_wide>(xa);
+    for (size_t k = 0; k < x.size(); ++k) {
+        assert(d1[k] == dot<accumulate_wide>(x[k], y[k]) && d2[k] == d1[k]);
+        assert(n1[k] == norm2_sq<accumulate_wide>(x[k]) && n2[k] == n1[k]);
+        assert(r1[k] == norm<accumulate_wide>(x[k]) && r2[k] == r1[k]);
+    }
+
+    // operands of different sizes are rejected rather than overrun
+    std::vector<vec<3,float>> s(x.begin(), x.begin() + 3);
+    vec_array<3,float> sa(s.begin(), s.end());
+    int thrown = 0;
+    try { dot<accumulate_wide>(x, s); }
+    catch (std::invalid_argument&) { ++thrown; }
+    try { dot<accumulate_wide>(xa, sa); }
+    catch (std::invalid_argument&) { ++thrown; }
+    assert(thrown == 2);
+
+    return 0;
+}
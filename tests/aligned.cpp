@@ -0,0 +1,122 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "../vec_aligned.hpp"
+
+using namespace Vec;
+
+// scribble over the padding lanes
+template <size_t N, typename T, size_t A>
+void poison(aligned_vec<N,T,A>& v)
+{
+    T* p = const_cast<T*>(v.data());
+    for (size_t i = N; i < aligned_vec<N,T,A>::padded_size; ++i)
+        p[i] = std::numeric_limits<double>::quiet_NaN();
+}
+
+template <size_t N, typename T, size_t A>
+bool padding_is_zero(const aligned_vec<N,T,A>& v)
+{
+    for (size_t i = N; i < aligned_vec<N,T,A>::padded_size; ++i)
+        if (!(v.data()[i] == T()))
+            return false;
+    return true;
+}
+
+int main ()
+{
+    // layout
+    static_assert(sizeof(aligned_vec<3,double>) == 32, "size");
+    static_assert(alignof(aligned_vec<3,double>) == 32, "alignment");
+    static_assert(sizeof(aligned_vec<3,float>) == 16, "size");
+    static_assert(alignof(aligned_vec<3,float>) == 16, "alignment");
+    static_assert(sizeof(aligned_vec<3,double,16>) == 32, "size");
+    static_assert(alignof(aligned_vec<3,double,16>) == 16, "alignment");
+    static_assert(sizeof(aligned_vec<5,double,64>) == 64, "size");
+    static_assert(sizeof(aligned_vec<3,std::complex<double>>) == 64, "size");
+    static_assert(aligned_vec<2,double>::padded_size == 2, "no padding");
+
+    // arithmetic leaves the padding at zero
+    aligned_vec<3,double> a{1., 2., 3.};
+    aligned_vec<3,double> b = 2. * a - vec<3,double>{0., 1., 0.};
+    assert((b == vec<3,double>{2., 3., 6.}));
+    a += b;
+    a -= 0.5 * b;
+    a *= std::numeric_limits<double>::infinity();
+    a /= 0.;
+    assert(padding_is_zero(a) && padding_is_zero(b));
+    vec<3,double> c = b;
+    assert(c == b);
+
+    // the padding never leaks into results
+    aligned_vec<3,double> d = b;
+    poison(d);
+    assert(d == b && !(d != b));
+    assert(d * b == c * c);
+    assert(d.norm2_sq() == c.norm2_sq() && d.norm() == c.norm());
+    assert(d.norm<1>() == c.norm<1>() && d.norm_inf() == c.norm_inf());
+    assert((cross(d, b) == vec<3,double>()));
+    std::ostringstream os1, os2;
+    os1 << d;
+    os2 << c;
+    assert(os1.str() == os2.str());
+
+    // complex
+    typedef std::complex<double> C;
+    aligned_vec<3,C> z{C(1, 2), C(0, -1), C(3, 0)};
+    vec<3,C> zv = z;
+    z.conj();
+    assert(z == conj(zv) && padding_is_zero(z));
+    assert(z * z == zv * zv);
+
+    // aligned containers and batch kernels on the padded layout
+    aligned_vec_vector<3,double> x, y;
+    for (size_t k = 0; k < 1001; ++k) {
+        x.push_back({double(k), 1. / (k + 1), -0.5 * k});
+        y.push_back({std::sin(double(k)), 2., double(k % 7)});
+    }
+    for (const auto& v : x)
+        assert(reinterpret_cast<uintptr_t>(&v) % 32 == 0);
+    std::vector<double> dots = dot(x, y), nsq = norm2_sq(x);
+    for (size_t k = 0; k < x.size(); ++k) {
+        assert(dots[k] == x[k] * y[k]);
+        assert(nsq[k] == x[k].norm2_sq());
+    }
+    y.pop_back();
+    bool thrown = false;
+    try {
+        dot(x, y);
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::vector<aligned_vec<4,float,64>,
+                aligned_allocator<aligned_vec<4,float,64>, 64>> w(100);
+    for (const auto& v : w)
+        assert(reinterpret_cast<uintptr_t>(&v) % 16 == 0);
+    assert(reinterpret_cast<uintptr_t>(w.data()) % 64 == 0);
+
+    return 0;
+}
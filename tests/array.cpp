@@ -0,0 +1,120 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "close.hpp"
+#include "../vec_array.hpp"
+
+using namespace Vec;
+
+template <typename T, typename S>
+void array_test(S tol)
+{
+    const size_t n = 100;
+    std::vector<vec<3,T>> aos_a, aos_b;
+    for (size_t k = 0; k < n; ++k) {
+        aos_a.push_back({T(k), T(1) + T(k % 7), T(2) - T(k % 3)});
+        aos_b.push_back({T(k % 5), T(3), T(k) / T(4)});
+    }
+    vec_array<3,T> a(aos_a.begin(), aos_a.end());
+    vec_array<3,T> b(aos_b.begin(), aos_b.end());
+    assert(a.size() == n);
+
+    // proxies behave like the vecs they were built from
+    for (size_t k = 0; k < n; ++k) {
+        assert(a[k] == aos_a[k]);
+        assert(a[k] * b[k] == aos_a[k] * aos_b[k]);
+        assert((cross(a[k], b[k]) == cross(aos_a[k], aos_b[k])));
+        assert(a[k].norm2_sq() == aos_a[k].norm2_sq());
+    }
+
+    // batch kernels agree with the single-vector operators
+    std::vector<T> d = dot(a, b);
+    auto nsq = norm2_sq(a);
+    auto nrm = norm(a);
+    vec_array<3,T> c = cross(a, b);
+    for (size_t k = 0; k < n; ++k) {
+        assert(d[k] == aos_a[k] * aos_b[k]);
+        assert(nsq[k] == aos_a[k].norm2_sq());
+        assert(CLOSE(nrm[k], aos_a[k].norm(), tol) || nrm[k] == 0);
+        assert(c[k] == cross(aos_a[k], aos_b[k]));
+    }
+
+    axpy(T(2), a, b);
+    for (size_t k = 0; k < n; ++k) {
+        vec<3,T> y = aos_b[k] + T(2) * aos_a[k];
+        assert(b[k] == y);
+    }
+
+    // writing through proxies and iterators
+    a[0] = b[1] - a[1];
+    vec<3,T> a0 = b[1] - a[1];
+    assert(a[0] == a0);
+    a[2] += a[3];
+    a[3] *= T(3);
+    size_t count = 0;
+    for (auto x : a) {
+        x = vec<3,T>(T(1));
+        ++count;
+    }
+    assert(count == n);
+    for (size_t k = 0; k < n; ++k)
+        assert((a[k] == vec<3,T>(T(1))));
+}
+
+int main ()
+{
+    array_test<double>(100 * std::numeric_limits<double>::epsilon());
+    array_test<float>(100 * std::numeric_limits<float>::epsilon());
+
+    std::complex<double> I = {0, 1};
+    vec_array<3,std::complex<double>> z(10);
+    for (size_t k = 0; k < z.size(); ++k)
+        z[k] = vec<3,std::complex<double>>{double(k) + I, 2. - I * double(k),
+                                           3. * I};
+    auto nsq = norm2_sq(z);
+    auto d = dot(z, z);
+    for (size_t k = 0; k < z.size(); ++k) {
+        vec<3,std::complex<double>> v = z[k];
+        assert(nsq[k] == v.norm2_sq());
+        assert(d[k] == v * v);
+        z[k].conj();
+        assert(z[k] == conj(v));
+    }
+
+    // operands of different sizes are rejected rather than overrun
+    vec_array<3,double> x(10), y(9);
+    std::vector<vec<3,double>> vx(10), vy(9);
+    int thrown = 0;
+    try { dot(x, y); } catch (std::invalid_argument&) { ++thrown; }
+    try { cross(x, y); } catch (std::invalid_argument&) { ++thrown; }
+    try { axpy(2., x, y); } catch (std::invalid_argument&) { ++thrown; }
+    try { axpby(2., x, 3., y); } catch (std::invalid_argument&) { ++thrown; }
+    try { update(1., x, 2., x, 3., y); }
+    catch (std::invalid_argument&) { ++thrown; }
+    try { lerp(x, y, .5); } catch (std::invalid_argument&) { ++thrown; }
+    try { axpy(2., vx, vy); } catch (std::invalid_argument&) { ++thrown; }
+    try { axpby(2., vx, 3., vy); } catch (std::invalid_argument&) { ++thrown; }
+    try { update(1., vx, 2., vx, 3., vy); }
+    catch (std::invalid_argument&) { ++thrown; }
+    try { lerp(vx, vy, .5); } catch (std::invalid_argument&) { ++thrown; }
+    assert(thrown == 10);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "../vec_box.hpp"
+
+using namespace Vec;
+
+// deterministic pseudo-random numbers in [-a, a)
+double noise(size_t k, double a)
+{
+    double x = std::sin(double(k) * 12.9898) * 43758.5453;
+    return a * 2 * (x - std::floor(x) - 0.5);
+}
+
+int main ()
+{
+    const vec<3,double> L{2., 3.5, 10.};
+    periodic_box<3> box(L);
+    assert(box.volume() == 70.);
+
+    std::vector<vec<3,double>> x;
+    for (size_t k = 0; k < 1000; ++k)
+        x.push_back({noise(3 * k, 50.), noise(3 * k + 1, 50.),
+                     noise(3 * k + 2, 50.)});
+    x.push_back({-1e-17, 0., 2.});
+    x.push_back({-2., 7., -20.});
+    x.push_back({std::nextafter(2., 0.), 3.5, 1e-300});
+
+    // wrapping lands in [0, L) and only shifts by whole box lengths
+    for (const auto& p : x) {
+        vec<3,double> w = box.wrap(p);
+        for (size_t i = 0; i < 3; ++i) {
+            assert(w[i] >= 0 && w[i] < L[i]);
+            double shift = (p[i] - w[i]) / L[i];
+            assert(std::abs(shift - std::round(shift)) < 1e-9);
+            double dr = std::abs(w[i] - std::fmod(p[i], L[i]));
+            assert(dr < 1e-12 || std::abs(dr - L[i]) < 1e-12);
+        }
+    }
+
+    // minimum images are no longer than half the box and agree with a
+    // brute-force search over neighbouring images
+    for (size_t k = 0; k + 1 < x.size(); ++k) {
+        vec<3,double> a = box.wrap(x[k]), b = box.wrap(x[k + 1]);
+        vec<3,double> d = box.displacement(a, b);
+        for (size_t i = 0; i < 3; ++i)
+            assert(std::abs(d[i]) <= L[i] / 2 * (1 + 1e-12));
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = -1; i <= 1; ++i)
+            for (int j = -1; j <= 1; ++j)
+                for (int l = -1; l <= 1; ++l) {
+                    vec<3,double> img = b - a
+                        + vec<3,double>{i * L[0], j * L[1], l * L[2]};
+                    best = std::min(best, img.norm2_sq());
+                }
+        assert(std::abs(box.distance2(a, b) - best) < 1e-9);
+    }
+
+    // batch versions agree with the single-vector ones
+    std::vector<vec<3,double>> y = x;
+    vec_array<3,double> z(x.begin(), x.end());
+    box.wrap(y);
+    box.wrap(z);
+    for (size_t k = 0; k < x.size(); ++k) {
+        assert(y[k] == box.wrap(x[k]));
+        assert(z[k] == box.wrap(x[k]));
+    }
+    y = x;
+    z = vec_array<3,double>(x.begin(), x.end());
+    box.minimum_image(y);
+    box.minimum_image(z);
+    for (size_t k = 0; k < x.size(); ++k) {
+        assert(y[k] == box.minimum_image(x[k]));
+        assert(z[k] == box.minimum_image(x[k]));
+    }
+
+    // a rectangular triclinic cell behaves like the orthorhombic box
+    triclinic_box<3> rect(mat<3,3,double>::diagonal(L));
+    for (const auto& p : x) {
+        vec<3,double> w = rect.wrap(p), v = box.wrap(p);
+        for (size_t i = 0; i < 3; ++i)
+            assert(std::abs(w[i] - v[i]) < 1e-9
+                   || std::abs(std::abs(w[i] - v[i]) - L[i]) < 1e-9);
+    }
+
+    // skewed cell
+    mat<3,3,double> h{{4., 1., -1.5},
+                      {0., 5., 2.},
+                      {0., 0., 6.}};
+    triclinic_box<3> tri(h);
+    for (size_t k = 0; k + 1 < x.size(); ++k) {
+        vec<3,double> s = tri.fractional(tri.wrap(x[k]));
+        for (size_t i = 0; i < 3; ++i)
+            assert(s[i] > -1e-12 && s[i] < 1 + 1e-12);
+
+        // short displacements are reproduced exactly up to a lattice vector
+        vec<3,double> a = tri.wrap(x[k]);
+        vec<3,double> b = tri.wrap(x[k] + 0.1 * x[k + 1] / x[k + 1].norm());
+        vec<3,double> d = tri.displacement(a, b);
+        assert(std::abs(d.norm() - 0.1) < 1e-9);
+    }
+    y = x;
+    tri.wrap(y);
+    for (size_t k = 0; k < x.size(); ++k)
+        assert(y[k] == tri.wrap(x[k]));
+
+    // matrix inverse used by the triclinic box
+    mat<3,3,double> hh = h * inverse(h);
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            assert(std::abs(hh(i, j) - (i == j)) < 1e-12);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+#include "../vec_array.hpp"
+#include "../vec_simd.hpp"
+
+using namespace Vec;
+
+// GCC's vectorizer may fuse the complex products of the operators into FMAs
+// even with -ffp-contract=off, so the kernels are compared with them up to
+// the rounding error of a dot product
+template <size_t N, typename T>
+bool close_dot(const std::complex<T>& x, const std::complex<T>& y,
+               const vec<N,std::complex<T>>& a,
+               const vec<N,std::complex<T>>& b)
+{
+    T bound = T();
+    for (size_t i = 0; i < N; ++i)
+        bound += std::abs(a[i]) * std::abs(b[i]);
+    bound *= 4 * (N + 1) * std::numeric_limits<T>::epsilon();
+    return std::abs(x.real() - y.real()) <= bound
+        && std::abs(x.imag() - y.imag()) <= bound;
+}
+
+template <size_t N, typename T>
+void cdot_test()
+{
+    typedef std::complex<T> C;
+    const size_t n = 29;
+    std::vector<vec<N,C>> a(n), b(n);
+    // split copies of the same data
+    std::vector<T> are(N*n), aim(N*n), bre(N*n), bim(N*n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < N; ++i) {
+            a[k][i] = C(std::sin(T(k + i)), std::cos(T(2 * k - i)));
+            b[k][i] = C(std::cos(T(k * i)) / T(3), std::sin(T(k) / T(5)));
+            are[k*N+i] = a[k][i].real();
+            aim[k*N+i] = a[k][i].imag();
+            bre[k*N+i] = b[k][i].real();
+            bim[k*N+i] = b[k][i].imag();
+        }
+
+    const simd_isa isas[] = {simd_isa::scalar, simd_isa::sse2,
+                             simd_isa::avx2, simd_isa::avx512};
+    for (simd_isa isa : isas) {
+        simd_select(isa);
+        std::vector<C> d = dot(a, b);
+        std::vector<T> nsq = norm2_sq(a);
+        std::vector<T> dre(n), dim(n), nsq_split(n);
+        simd_dot_split<N>(are.data(), aim.data(), bre.data(), bim.data(),
+                          dre.data(), dim.data(), n);
+        simd_norm2_sq_split<N>(are.data(), aim.data(), nsq_split.data(), n);
+        for (size_t k = 0; k < n; ++k) {
+            assert(close_dot(d[k], a[k] * b[k], a[k], b[k]));
+            assert(dre[k] == d[k].real() && dim[k] == d[k].imag());
+            assert(nsq[k] == a[k].norm2_sq());
+            assert(nsq_split[k] == nsq[k]);
+            // the fast path agrees with the real part of the full product
+            assert(close_dot(C(nsq[k]), a[k] * a[k], a[k], a[k]));
+        }
+    }
+    simd_select(simd_detect());
+
+    vec_array<N,C> sa(a.begin(), a.end()), sb(b.begin(), b.end());
+    std::vector<C> d = dot(sa, sb);
+    for (size_t k = 0; k < n; ++k)
+        assert(close_dot(d[k], a[k] * b[k], a[k], b[k]));
+}
+
+int main ()
+{
+    cdot_test<2, float>();
+    cdot_test<3, float>();
+    cdot_test<3, double>();
+    cdot_test<4, double>();
+    cdot_test<10, double>();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../vec_cell_list.hpp"
+
+using namespace Vec;
+
+typedef std::pair<size_t,size_t> pair_type;
+
+// deterministic pseudo-random numbers in [0, a)
+double noise(size_t k, double a)
+{
+    double x = std::sin(double(k) * 12.9898 + 1.) * 43758.5453;
+    return a * (x - std::floor(x));
+}
+
+template <size_t N, typename Dist>
+std::vector<pair_type> brute_force(const std::vector<vec<N,double>>& x,
+                                   double cutoff, Dist dist2)
+{
+    std::vector<pair_type> res;
+    for (size_t i = 0; i < x.size(); ++i)
+        for (size_t j = i + 1; j < x.size(); ++j)
+            if (dist2(x[i], x[j]) < cutoff * cutoff)
+                res.emplace_back(i, j);
+    return res;
+}
+
+std::vector<pair_type> sorted(std::vector<pair_type> p)
+{
+    std::sort(p.begin(), p.end());
+    return p;
+}
+
+template <size_t N>
+void neighbour_test(size_t n, double len, double cutoff)
+{
+    std::vector<vec<N,double>> x(n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < N; ++i)
+            x[k][i] = noise(k * N + i, len);
+    auto open_dist2 = [](const vec<N,double>& a, const vec<N,double>& b) {
+        return vec<N,double>(b - a).norm2_sq();
+    };
+    const periodic_box<N> box{vec<N,double>(len)};
+    auto periodic_dist2 = [&](const vec<N,double>& a, const vec<N,double>& b) {
+        return box.distance2(a, b);
+    };
+
+    // open boundaries
+    cell_list<N> open(cutoff, 0.1 * cutoff, 1);
+    assert(open.update(x));
+    std::vector<pair_type> found = open.pairs(x);
+    assert(sorted(found) == brute_force(x, cutoff, open_dist2));
+    assert(!found.empty());
+
+    // the result does not depend on the number of threads
+    cell_list<N> open4(cutoff, 0.1 * cutoff, 4);
+    open4.build(x);
+    assert(open4.pairs(x) == found);
+
+    // periodic boundaries
+    cell_list<N> per(box, cutoff, 0.1 * cutoff, 3);
+    per.build(x);
+    std::vector<pair_type> ref = brute_force(x, cutoff, periodic_dist2);
+    assert(sorted(per.pairs(x)) == ref);
+    assert(ref.size() > found.size());
+
+    // small moves are absorbed by the skin, large ones trigger a rebuild
+    std::vector<vec<N,double>> y = x;
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < N; ++i)
+            y[k][i] += 0.03 * cutoff * (noise(7 * k + i, 2.) - 1.);
+    assert(!per.update(y));
+    assert(!open.update(y));
+    assert(sorted(per.pairs(y)) == brute_force(y, cutoff, periodic_dist2));
+    assert(sorted(open.pairs(y)) == brute_force(y, cutoff, open_dist2));
+    y[n / 2][0] += 0.2 * cutoff;
+    assert(per.update(y));
+    assert(sorted(per.pairs(y)) == brute_force(y, cutoff, periodic_dist2));
+    y.pop_back();
+    assert(open.update(y));
+    assert(sorted(open.pairs(y)) == brute_force(y, cutoff, open_dist2));
+}
+
+int main ()
+{
+    neighbour_test<2>(1500, 15., 0.7);
+    neighbour_test<3>(1500, 8., 1.1);
+    neighbour_test<3>(500, 3., 1.3);   // only two cells per dimension
+    neighbour_test<1>(200, 50., 2.);
+
+    // multithreaded construction and queries give the same pairs in the
+    // same order
+    {
+        const size_t n = 50000;
+        std::vector<vec<3,double>> x(n);
+        for (size_t k = 0; k < n; ++k)
+            x[k] = {noise(3 * k, 30.), noise(3 * k + 1, 30.),
+                    noise(3 * k + 2, 30.)};
+        periodic_box<3> box(vec<3,double>(30.));
+        cell_list<3> serial(box, 1., 0.2, 1), threaded(box, 1., 0.2, 4);
+        serial.build(x);
+        threaded.build(x);
+        std::vector<pair_type> p = serial.pairs(x);
+        assert(p.size() > n && threaded.pairs(x) == p);
+        for (const auto& ij : p)
+            assert(ij.first < ij.second && box.distance2(x[ij.first], x[ij.second]) < 1.);
+    }
+
+    // cutoffs beyond half the box are rejected
+    bool thrown = false;
+    try {
+        cell_list<3> c(periodic_box<3>(vec<3,double>(2.)), 0.9, 0.2);
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // empty point sets
+    cell_list<3> empty(1.);
+    empty.build({});
+    assert(empty.pairs({}).empty());
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../vec_array.hpp"
+#include "../vec_compare.hpp"
+#include "../vec_simd.hpp"
+
+using namespace Vec;
+
+// the masks of approx_equal_scalars are identical for every instruction set,
+// including special values and lengths which leave a remainder
+template <typename T>
+void isa_test()
+{
+    const T special[] = {T(0), -T(0), T(1), -T(1),
+                         std::numeric_limits<T>::infinity(),
+                         -std::numeric_limits<T>::infinity(),
+                         std::numeric_limits<T>::quiet_NaN(),
+                         std::numeric_limits<T>::denorm_min(),
+                         std::numeric_limits<T>::max(),
+                         std::numeric_limits<T>::lowest()};
+    const size_t n = 1003;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, 13), ulps(-3, 3);
+    std::vector<T> l(n), r(n);
+    for (size_t k = 0; k < n; ++k) {
+        const int a = pick(rng), b = pick(rng);
+        l[k] = a < 10 ? special[a] : T(a - 11) * T(1.5);
+        r[k] = b < 10 ? special[b] : l[k];
+        for (int u = ulps(rng); u != 0; u += u > 0 ? -1 : 1)
+            r[k] = std::nextafter(r[k], u > 0 ? special[4] : special[5]);
+    }
+    const tolerance tols[] = {tolerance::exact(), tolerance::absolute(1e-30),
+                              tolerance::relative(1e-6), tolerance::ulp(2),
+                              tolerance::relative(1e-6).or_ulp(1),
+                              tolerance::ulp(uint64_t(1) << 40)};
+    const simd_isa isas[] = {simd_isa::scalar, simd_isa::sse2,
+                             simd_isa::avx2, simd_isa::avx512};
+    for (const tolerance& tol : tols) {
+        const vec_tolerance<T> close(tol);
+        std::vector<unsigned char> ref(n), eq(n);
+        for (size_t k = 0; k < n; ++k)
+            ref[k] = close(l[k], r[k]);
+        for (simd_isa isa : isas) {
+            simd_select(isa);
+            approx_equal_scalars(l.data(), r.data(), n, close, eq.data());
+            assert(eq == ref);
+        }
+    }
+    simd_select(simd_detect());
+}
+
+int main()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    // operator== on vectors longer than a block
+    {
+        vec<19,int> a, b;
+        for (size_t i = 0; i < 19; ++i)
+            a[i] = b[i] = int(i);
+        assert(a == b);
+        b[17] = 0;
+        assert(a != b);
+        b[17] = 17;
+        b[3] = 0;
+        assert(a != b);
+    }
+
+    // ULP distances
+    {
+        assert(vec_ulp_distance(1., std::nextafter(1., 2.)) == 1);
+        assert(vec_ulp_distance(1., std::nextafter(1., 0.)) == 1);
+        assert(vec_ulp_distance(0., -0.) == 0);
+        const double tiny = std::numeric_limits<double>::denorm_min();
+        assert(vec_ulp_distance(-tiny, tiny) == 2);
+        assert(vec_ulp_distance(1.f, std::nextafter(std::nextafter(1.f, 2.f), 2.f)) == 2);
+        assert(vec_ulp_distance(-3, 4) == 7);
+        assert(vec_ulp_distance(2u, 1u) == 1);
+        long double x = 1;
+        assert(vec_ulp_distance(x, std::nextafter(x, 2.L)) == 1);
+    }
+
+    // absolute, relative and ULP tolerances
+    {
+        vec<3,double> a = {1., 1e-20, -1e10};
+        vec<3,double> b = {1. + 1e-13, 2e-20, -1e10 * (1 + 1e-13)};
+        assert(!approx_equal(a, b, tolerance::exact()));
+        assert(!approx_equal(a, b, tolerance::relative(1e-12)));
+        assert(!approx_equal(a, b, tolerance::absolute(1e-12)));
+        assert(approx_equal(a, b, tolerance::relative(1e-12).or_absolute(1e-18)));
+        assert(approx_equal(a, a, tolerance::exact()));
+
+        vec<3,double> c = a;
+        c[0] = std::nextafter(std::nextafter(c[0], 2.), 2.);
+        assert(approx_equal(a, c, tolerance::ulp(2)));
+        assert(!approx_equal(a, c, tolerance::ulp(1)));
+
+        // expressions are compared without evaluating them first
+        assert(approx_equal(a + a, 2. * a, tolerance::exact()));
+        assert(approx_equal(a - b, b - b, tolerance::absolute(1e-2)));
+        assert(!approx_equal(a - b, b - b, tolerance::absolute(1e-4)));
+    }
+
+    // NaN and infinities
+    {
+        vec<2,double> a = {nan, 1.}, b = {inf, 1.};
+        assert(!approx_equal(a, a, tolerance::ulp(~uint64_t(0))));
+        assert(!approx_equal(a, a, tolerance::absolute(inf)));
+        assert(approx_equal(b, b, tolerance::exact()));
+        assert(!approx_equal(b, -b, tolerance::relative(1.)));
+    }
+
+    // complex components compare by modulus
+    {
+        typedef std::complex<double> C;
+        vec<2,C> a = {C(1., 1.), C(0., -2.)};
+        vec<2,C> b = {C(1., 1. + 1e-10), C(1e-10, -2.)};
+        assert(approx_equal(a, b, tolerance::absolute(1.1e-10)));
+        assert(!approx_equal(a, b, tolerance::absolute(0.9e-10)));
+        assert(approx_equal(a, b, tolerance::relative(1e-10)));
+        assert(!approx_equal(a, b, tolerance::ulp(1000)));
+        vec<2,C> c = a;
+        c[1].imag(std::nextafter(-2., 0.));
+        assert(approx_equal(a, c, tolerance::ulp(1)));
+    }
+
+    // integers and unsigned types do not wrap around
+    {
+        vec<3,unsigned> a = {1, 5, 9}, b = {2, 5, 7};
+        assert(approx_equal(a, b, tolerance::absolute(2)));
+        assert(!approx_equal(a, b, tolerance::absolute(1.5)));
+        assert(approx_equal(a, b, tolerance::ulp(2)));
+    }
+
+    // batch comparison
+    {
+        const size_t n = 1000;
+        std::vector<vec<3,double>> u(n), v;
+        for (size_t k = 0; k < n; ++k)
+            u[k] = {double(k), 1., -0.5 * k};
+        v = u;
+        assert(all_approx_equal(u, v, tolerance::exact()));
+        assert(count_approx_equal(u, v, tolerance::exact()) == n);
+        assert(find_approx_unequal(u, v, tolerance::exact()).empty());
+
+        v[7][1] += 1e-6;
+        v[300][2] = nan;
+        v[999][0] *= 1 + 1e-14;
+        const tolerance tol = tolerance::relative(1e-12);
+        assert(!all_approx_equal(u, v, tol));
+        assert(count_approx_equal(u, v, tol) == n - 2);
+        assert((find_approx_unequal(u, v, tol) == std::vector<size_t>{7, 300}));
+
+        vec_array<3,double> a(u.begin(), u.end()), b(v.begin(), v.end());
+        assert(!all_approx_equal(a, b, tol));
+        assert(count_approx_equal(a, b, tol) == n - 2);
+        assert((find_approx_unequal(a, b, tol) == std::vector<size_t>{7, 300}));
+        assert(all_approx_equal(a, a, tolerance::exact()));
+
+        std::vector<vec<3,double>> e;
+        assert(all_approx_equal(e, e, tol));
+        assert(count_approx_equal(e, e, tol) == 0);
+    }
+
+    // operands of different sizes are rejected rather than overrun
+    {
+        const tolerance tol = tolerance::relative(1e-12);
+        std::vector<vec<3,double>> u(10), v(3);
+        vec_array<3,double> a(u.begin(), u.end()), b(v.begin(), v.end());
+        int thrown = 0;
+        try { count_approx_equal(u, v, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        try { all_approx_equal(u, v, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        try { find_approx_unequal(u, v, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        try { count_approx_equal(a, b, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        try { all_approx_equal(a, b, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        try { find_approx_unequal(a, b, tol); }
+        catch (std::invalid_argument&) { ++thrown; }
+        assert(thrown == 6);
+    }
+
+    isa_test<float>();
+    isa_test<double>();
+}
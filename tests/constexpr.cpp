@@ -0,0 +1,94 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include "../vec.hpp"
+
+using namespace Vec;
+
+// lattice geometry evaluated at compile time
+constexpr vec<3,double> a1 = {1., 0., 0.};
+constexpr vec<3,double> a2 = {.5, .75, 0.};
+constexpr vec<3,double> a3 = {0., 0., 2.};
+constexpr double volume = a1 * cross(a2, a3);
+constexpr vec<3,double> b1 = cross(a2, a3) / volume;
+constexpr vec<3,double> b2 = cross(a3, a1) / volume;
+constexpr vec<3,double> b3 = cross(a1, a2) / volume;
+
+static_assert(volume == 1.5, "unit cell volume");
+static_assert(a1 * b1 == 1. && a2 * b2 == 1. && a3 * b3 == 1.,
+              "reciprocal basis is dual to direct basis");
+static_assert(a1 * b2 == 0. && a2 * b3 == 0. && a3 * b1 == 0.,
+              "reciprocal basis is dual to direct basis");
+
+// neighbour offsets of the square lattice, generated by a loop
+struct offset_table {
+    vec<2,int> offsets[8];
+};
+
+constexpr offset_table make_offsets()
+{
+    offset_table t = {};
+    size_t n = 0;
+    for (int dx = -1; dx <= 1; ++dx)
+        for (int dy = -1; dy <= 1; ++dy)
+            if (dx != 0 || dy != 0)
+                t.offsets[n++] = vec<2,int>{dx, dy};
+    return t;
+}
+
+constexpr offset_table neighbours = make_offsets();
+static_assert(neighbours.offsets[0] == vec<2,int>{-1, -1}, "first offset");
+static_assert(neighbours.offsets[7] == vec<2,int>{1, 1}, "last offset");
+static_assert(neighbours.offsets[3].norm2_sq() == 1, "nearest neighbour");
+
+// arithmetic, element access and comparisons
+constexpr vec<3,int> i = {1, 2, 3};
+constexpr vec<3,int> j = 2 * i - vec<3,int>(1);
+static_assert(j[0] == 1 && j[1] == 3 && j[2] == 5, "linear combination");
+static_assert(i * j == 22, "dot product");
+static_assert(-i + i == vec<3,int>(), "negation");
+static_assert(i != j, "inequality");
+static_assert(vec<3,int>(7) % i == vec<3,int>{0, 1, 1}, "integral modulo");
+static_assert((vec<3,int>(7) % 4)[0] == 3, "integral modulo by scalar");
+static_assert(vec<2,double>{5.5, -7.25} % 2. == vec<2,double>{1.5, -1.25},
+              "floating point modulo");
+
+constexpr vec<3,int> accumulate()
+{
+    vec<3,int> sum;
+    for (int k = 0; k < 4; ++k) {
+        sum += i;
+        sum -= vec<3,int>(1);
+        sum *= 1;
+    }
+    sum %= 5;
+    return sum;
+}
+
+static_assert(accumulate() == vec<3,int>{0, 4, 3}, "compound assignment");
+
+int main ()
+{
+    // the constexpr remainder agrees with std::fmod at runtime
+    const double xs[] = {5.5, -7.25, 1e300, 3e-310, 0.1, -0.};
+    const double ys[] = {2., 0.3, -3.7, 1e-320, 1e-3, 1.};
+    for (double x : xs)
+        for (double y : ys)
+            assert(vec_fmod_exact(x, y) == std::fmod(x, y));
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include "close.hpp"
+#include "../vec.hpp"
+
+using namespace Vec;
+
+template <size_t N, typename T, typename S>
+void expr_test(S tol)
+{
+    vec<N,T> a, b, c;
+    for (size_t i = 0; i < N; ++i) {
+        a[i] = T(i + 1);
+        b[i] = T(2 * N - i);
+        c[i] = T(3 * i + 2);
+    }
+
+    // fused evaluation agrees with eager element-wise evaluation
+    vec<N,T> d = a + T(2) * b - c / T(3);
+    for (size_t i = 0; i < N; ++i)
+        assert(CLOSE(d[i], (a[i] + T(2) * b[i] - c[i] / T(3)), tol));
+
+    // unary minus and nested sub-expressions
+    vec<N,T> e = -(a - b) * T(2) + (c + a);
+    for (size_t i = 0; i < N; ++i)
+        assert(CLOSE(e[i], (T(2) * (b[i] - a[i]) + c[i] + a[i]), tol));
+
+    // compound assignment from an expression
+    vec<N,T> f(a);
+    f += T(3) * b;
+    f -= c / T(2);
+    for (size_t i = 0; i < N; ++i)
+        assert(CLOSE(f[i], (a[i] + T(3) * b[i] - c[i] / T(2)), tol));
+
+    // aliasing the assignee within the expression is safe
+    vec<N,T> g(a);
+    g = b - g;
+    assert(g == b - a);
+
+    // expressions feed the dot product and comparisons directly
+    assert(CLOSE(((a + b) * c), (a * c + b * c), tol));
+    assert(a + b == b + a);
+    assert(a - b != b - a);
+}
+
+int main ()
+{
+    expr_test<10, float>(100 * std::numeric_limits<float>::epsilon());
+    expr_test<10, double>(100 * std::numeric_limits<double>::epsilon());
+    expr_test<3, std::complex<double>>(
+            100 * std::numeric_limits<double>::epsilon());
+
+    // mixed-type promotion is preserved
+    vec<3,int> i = {1, 2, 3};
+    vec<3,double> x = {.5, .25, .125};
+    static_assert(std::is_same<decltype(i + x)::value_type, double>::value,
+                  "int + double should promote to double");
+    static_assert(std::is_same<decltype(.5 * i)::value_type, double>::value,
+                  "double * int should promote to double");
+    vec<3,double> y = i + x;
+    assert((y == vec<3,double>{1.5, 2.25, 3.125}));
+    vec<3,double> z = .5 * i;
+    assert((z == vec<3,double>{.5, 1., 1.5}));
+    assert(((i % 2) == vec<3,int>{1, 0, 1}));
+
+    // cross product accepts expressions
+    vec<3,double> w = cross(i + x, x);
+    vec<3,double> ipx = i + x;
+    assert(w == cross(ipx, x));
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "../vec_array.hpp"
+#include "../vec_compare.hpp"
+
+using namespace Vec;
+
+int main()
+{
+    // with hardware FMA, results may differ from the operators in the last bit
+    const tolerance tol = tolerance::ulp(2).or_absolute(1e-15);
+
+    // single vectors
+    {
+        vec<3,double> x = {1., -2., 0.5}, y = {0.1, 0.2, 0.3}, z = {3., 2., 1.};
+        vec<3,double> r = y;
+        axpy(0.3, x, r);
+        assert(approx_equal(r, y + 0.3 * x, tol));
+        r = y;
+        axpby(0.3, x, -1.5, r);
+        assert(approx_equal(r, 0.3 * x - 1.5 * y, tol));
+        r = z;
+        update(0.1, x, 0.005, y, 1., r);
+        assert(approx_equal(r, z + 0.1 * x + 0.005 * y, tol));
+        assert(approx_equal(fma(x, y, z), (vec<3,double>{3.1, 1.6, 1.15}), tol));
+        assert(approx_equal(fma(2., x, z), (vec<3,double>{5., -2., 2.}), tol));
+        // expressions as operands
+        r = y;
+        axpy(2., x + z, r);
+        assert(approx_equal(r, y + 2. * (x + z), tol));
+    }
+
+    // lerp is exact at the end points and monotonic
+    {
+        vec<2,double> a = {0.1, -7.3}, b = {1e-3, 3.3};
+        assert(lerp(a, b, 0.) == a);
+        assert(lerp(a, b, 1.) == b);
+        assert(approx_equal(lerp(a, b, 0.25), 0.75 * a + 0.25 * b,
+                            tolerance::relative(1e-15)));
+        double prev = a[1];
+        for (int i = 1; i <= 100; ++i) {
+            double c = lerp(a, b, i / 100.)[1];
+            assert(c >= prev);
+            prev = c;
+        }
+    }
+
+    // vec_fma rounds like std::fma where the hardware supports it
+    {
+        const double e = std::ldexp(1., -30);
+        const double fused = vec_fma(1. + e, 1. - e, -1.);
+#ifdef FP_FAST_FMA
+        assert(fused == -e * e);
+#else
+        assert(fused == 0.);
+#endif
+    }
+
+    // complex vectors with complex and real coefficients
+    {
+        typedef std::complex<double> C;
+        vec<2,C> x = {C(1., 2.), C(-0.5, 0.)}, y = {C(0., 1.), C(3., -1.)};
+        vec<2,C> r = y;
+        axpy(C(0., 2.), x, r);
+        assert(approx_equal(r, y + C(0., 2.) * x, tol));
+        r = y;
+        axpy(0.5, x, r);
+        assert(approx_equal(r, y + 0.5 * x, tol));
+        r = y;
+        axpby(C(1., 1.), x, C(0., -1.), r);
+        assert(approx_equal(r, C(1., 1.) * x + C(0., -1.) * y, tol));
+        assert(approx_equal(fma(x, y, x), (vec<2,C>{C(-1., 3.), C(-2., 0.5)}), tol));
+        assert(lerp(x, y, 1.) == y);
+    }
+
+    // integers
+    {
+        vec<3,int> x = {1, 2, 3}, y = {4, 5, 6};
+        axpy(2, x, y);
+        assert(y == (vec<3,int>{6, 9, 12}));
+        axpby(-1, x, 2, y);
+        assert(y == (vec<3,int>{11, 16, 21}));
+    }
+
+    // batches agree with the single-vector versions
+    {
+        const size_t n = 257;
+        std::vector<vec<3,double>> x(n), v(n), a(n);
+        for (size_t k = 0; k < n; ++k) {
+            x[k] = {std::sin(double(k)), 0.5 * k, -1.};
+            v[k] = {0.1, std::cos(double(k)), 0.01 * k};
+            a[k] = {-0.2 * k, 1., std::sin(0.3 * k)};
+        }
+        const double dt = 0.01;
+
+        // velocity Verlet position update
+        std::vector<vec<3,double>> ref = x;
+        for (size_t k = 0; k < n; ++k)
+            update(dt, v[k], dt * dt / 2, a[k], 1., ref[k]);
+        std::vector<vec<3,double>> y = x;
+        update(dt, v, dt * dt / 2, a, 1., y);
+        assert(y == ref);
+        vec_array<3,double> sx(x.begin(), x.end()), sv(v.begin(), v.end()),
+            sa(a.begin(), a.end());
+        update(dt, sv, dt * dt / 2, sa, 1., sx);
+        for (size_t k = 0; k < n; ++k)
+            assert(sx[k] == ref[k]);
+
+        // axpy and axpby
+        y = x;
+        axpy(dt, v.data(), y.data(), n);
+        sx = vec_array<3,double>(x.begin(), x.end());
+        axpy(dt, sv, sx);
+        for (size_t k = 0; k < n; ++k) {
+            vec<3,double> r = x[k];
+            axpy(dt, v[k], r);
+            assert(y[k] == r && sx[k] == r);
+        }
+        // on std::vector the coefficient need not have the scalar type
+        y = x;
+        axpy(2, v, y);
+        for (size_t k = 0; k < n; ++k) {
+            vec<3,double> r = x[k];
+            axpy(2, v[k], r);
+            assert(y[k] == r);
+        }
+        y = x;
+        axpby(2., v, 0.5, y);
+        sx = vec_array<3,double>(x.begin(), x.end());
+        axpby(2., sv, 0.5, sx);
+        for (size_t k = 0; k < n; ++k) {
+            vec<3,double> r = x[k];
+            axpby(2., v[k], 0.5, r);
+            assert(y[k] == r && sx[k] == r);
+        }
+
+        // lerp
+        sx = vec_array<3,double>(x.begin(), x.end());
+        std::vector<vec<3,double>> l = lerp(x, v, 0.3);
+        vec_array<3,double> sl = lerp(sx, sv, 0.3);
+        for (size_t k = 0; k < n; ++k)
+            assert(l[k] == lerp(x[k], v[k], 0.3) && sl[k] == l[k]);
+    }
+}
@@ -0,0 +1,215 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../vec_hash.hpp"
+
+using namespace Vec;
+
+// Morton code of small nonnegative coordinates by interleaving the bits
+template <size_t N>
+uint64_t interleave(const vec<N,int>& a, unsigned bits)
+{
+    uint64_t code = 0;
+    for (unsigned b = bits; b-- > 0;)
+        for (size_t i = 0; i < N; ++i)
+            code = (code << 1) | ((a[i] >> b) & 1);
+    return code;
+}
+
+int main()
+{
+    typedef vec<3,int> site;
+
+    // std::hash agrees with hash64 and is only enabled for integers
+    {
+        const site a = {1, -2, 3};
+        assert(std::hash<site>()(a) == size_t(hash64(a)));
+        assert(hash64(a) == hash64(site{1, -2, 3}));
+        assert(hash64(a) != hash64(site{-2, 1, 3}));
+        assert((hash64(vec<2,long>{5, 7}) == hash64(vec<2,int>{5, 7})));
+        assert((hash64(vec<2,int>{5, 7}) != hash64(vec<3,int>{5, 7, 0})));
+        static_assert(std::is_default_constructible<std::hash<site>>::value,
+                      "hash of integral vec enabled");
+        static_assert(!std::is_default_constructible<
+                          std::hash<vec<3,double>>>::value,
+                      "hash of floating point vec disabled");
+    }
+
+    // no collisions of the full hash on a lattice, and an even spread of
+    // the low bits used to index hash tables
+    {
+        const int L = 64;
+        std::vector<uint64_t> h;
+        for (int x = -L / 2; x < L / 2; ++x)
+            for (int y = -L / 2; y < L / 2; ++y)
+                for (int z = -L / 2; z < L / 2; ++z)
+                    h.push_back(hash64(site{x, y, z}));
+        std::vector<size_t> buckets(1 << 12);
+        for (uint64_t x : h)
+            ++buckets[x & (buckets.size() - 1)];
+        const size_t mean = h.size() / buckets.size();
+        for (size_t c : buckets)
+            assert(c > mean / 2 && c < 2 * mean);
+        std::sort(h.begin(), h.end());
+        assert(std::adjacent_find(h.begin(), h.end()) == h.end());
+    }
+
+    // lexicographic order
+    {
+        lexicographic_less less;
+        assert(less(site{1, 2, 3}, site{1, 2, 4}));
+        assert(less(site{1, 2, 3}, site{2, -5, -5}));
+        assert(!less(site{1, 2, 3}, site{1, 2, 3}));
+        assert(!less(site{1, 3, 0}, site{1, 2, 9}));
+        assert((less(vec<2,double>{0.5, 1.}, vec<2,double>{0.5, 2.})));
+    }
+
+    // Morton order agrees with interleaving the bits
+    {
+        morton_less less;
+        std::vector<site> x;
+        for (int i = 0; i < 8; ++i)
+            for (int j = 0; j < 8; ++j)
+                for (int k = 0; k < 8; ++k)
+                    x.push_back({i, j, k});
+        for (const site& a : x)
+            for (const site& b : x)
+                assert(less(a, b) == (interleave(a, 3) < interleave(b, 3)));
+        std::sort(x.begin(), x.end(), less);
+        for (size_t k = 0; k < x.size(); ++k)
+            assert(interleave(x[k], 3) == k);
+
+        // with the sign bit flipped, coordinates in [-4, 4) are ordered
+        // like those in [0, 8), as the bits in between are all equal
+        for (const site& a : x)
+            for (const site& b : x)
+                assert(less(site(a - site(4)), site(b - site(4))) == less(a, b));
+        assert(less(site{-1, 0, 0}, site{0, 0, 0}));
+        assert((less(vec<2,unsigned>{1u, 0u}, vec<2,unsigned>{0u, 5u})));
+        assert((less(vec<2,long>{-1000000000000L, -1}, vec<2,long>{-1, -1})));
+        assert((less(vec<2,long>{-1, -1}, vec<2,long>{-1000000000000L, 0})));
+    }
+
+    // flat_hash_map against std::unordered_map
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> coord(-20, 20);
+        flat_hash_map<site, int> m;
+        std::unordered_map<site, int> ref;
+        for (int n = 0; n < 100000; ++n) {
+            const site a = {coord(rng), coord(rng), coord(rng)};
+            switch (rng() % 4) {
+            case 0:
+            case 1: {
+                auto r = m.try_emplace(a, n);
+                auto s = ref.emplace(a, n);
+                assert(r.second == s.second);
+                assert(r.first->first == a);
+                assert(r.first->second == s.first->second);
+                break;
+            }
+            case 2:
+                assert(m.erase(a) == ref.erase(a));
+                break;
+            case 3:
+                assert(m.count(a) == ref.count(a));
+                if (ref.count(a))
+                    assert(m.find(a)->second == ref[a]);
+                else
+                    assert(m.find(a) == m.end());
+                break;
+            }
+            assert(m.size() == ref.size());
+        }
+        assert(m.load_factor() <= 0.75);
+        size_t visited = 0;
+        for (const auto& kv : m) {
+            assert(ref.at(kv.first) == kv.second);
+            ++visited;
+        }
+        assert(visited == ref.size());
+    }
+
+    // operator[], at, insert, reserve, clear
+    {
+        flat_hash_map<vec<2,long>, std::string> m;
+        m[{1, 2}] = "a";
+        m[{1, 2}] += "b";
+        m[{-3, 0}];
+        assert(m.size() == 2);
+        assert((m.at({1, 2}) == "ab"));
+        assert((m.at({-3, 0}).empty()));
+        bool thrown = false;
+        try {
+            m.at({0, 0});
+        } catch (std::out_of_range&) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(!m.insert({{1, 2}, "c"}).second);
+        assert(m.insert({{2, 1}, "c"}).second);
+        const flat_hash_map<vec<2,long>, std::string>& cm = m;
+        assert((cm.find({2, 1})->second == "c"));
+        assert((cm.find({2, 2}) == cm.end()));
+
+        m.reserve(1000);
+        const size_t cap = m.capacity();
+        for (long i = 0; i < 1000; ++i)
+            m[{i, -i}] = "x";
+        assert(m.capacity() == cap);
+        assert(m.size() == 1003);
+        assert((m.at({1, 2}) == "ab"));
+        m.clear();
+        assert(m.empty() && m.begin() == m.end());
+        m[{4, 4}] = "y";
+        assert(m.size() == 1);
+    }
+
+    // flat_hash_set: erasure keeps the remaining keys reachable
+    {
+        flat_hash_set<site> s;
+        std::unordered_set<site> ref;
+        for (int x = 0; x < 16; ++x)
+            for (int y = 0; y < 16; ++y)
+                for (int z = 0; z < 16; ++z) {
+                    assert(s.insert({x, y, z}).second);
+                    ref.insert(site{x, y, z});
+                }
+        assert(!s.insert({0, 0, 0}).second);
+        for (int x = 0; x < 16; x += 2)
+            for (int y = 0; y < 16; ++y)
+                for (int z = 0; z < 16; z += 3) {
+                    assert(s.erase({x, y, z}) == 1);
+                    ref.erase(site{x, y, z});
+                }
+        assert(s.size() == ref.size());
+        for (const site& a : ref)
+            assert(s.count(a) && *s.find(a) == a);
+        for (const site& a : s)
+            assert(ref.count(a));
+        assert(s.erase({0, 0, 0}) == 0);
+    }
+}
@@ -0,0 +1,117 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include "close.hpp"
+#include "../vec_heap.hpp"
+
+using namespace Vec;
+
+template <size_t N>
+heap_vec<N,double> ramp(double slope)
+{
+    heap_vec<N,double> x;
+    for (size_t i = 0; i < N; ++i)
+        x[i] = slope * double(i % 17);
+    return x;
+}
+
+int main()
+{
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    // construction and expressions agree with vec
+    const size_t N = 300;
+    typedef heap_vec<N,double> H;
+    typedef vec<N,double> V;
+    H a = ramp<N>(0.5), b = ramp<N>(-0.25);
+    V va(a.data()), vb(b.data());
+    H c = a + 2. * b - a / 3.;
+    V vc = va + 2. * vb - va / 3.;
+    assert(c == vc);
+    assert(uintptr_t(c.data()) % 64 == 0);
+    assert(H() == V());
+    assert(H(1.5) == V(1.5));
+    assert((H{1., 2.} == V{1., 2.}));
+
+    c += a;
+    c -= 0.5 * b;
+    c *= 3.;
+    c /= 2.;
+    vc += va;
+    vc -= 0.5 * vb;
+    vc *= 3.;
+    vc /= 2.;
+    assert(c == vc);
+
+    // dot products and norms are blocked, hence only close to vec's
+    assert(CLOSE(a * b, va * vb, 10 * eps));
+    assert(CLOSE(a.norm2_sq(), va.norm2_sq(), 10 * eps));
+    assert(CLOSE(a.norm(), va.norm(), 10 * eps));
+
+    // copies are deep, moves transfer the buffer
+    H d = a;
+    assert(d == a && d.data() != a.data());
+    const double* p = d.data();
+    H e = std::move(d);
+    assert(e.data() == p && d.data() == nullptr);
+    d = b;
+    assert(d == b);
+    d = std::move(e);
+    assert(d.data() == p && d == a);
+    swap(d, e);
+    assert(e.data() == p && e == a);
+
+    // operators on rvalues reuse their buffer
+    H f = ramp<N>(1.);
+    p = f.data();
+    H g = -(std::move(f) + a - b) * 2.;
+    assert(g.data() == p);
+    assert(g == V(-2. * (vec<N,double>(ramp<N>(1.)) + va - vb)));
+    H h = a + ramp<N>(1.);
+    assert(h == V(va + V(ramp<N>(1.))));
+    H k = ramp<N>(1.) - ramp<N>(2.);
+    assert(k == V(-1. * V(ramp<N>(1.))));
+
+    // complex vectors
+    typedef std::complex<double> C;
+    heap_vec<N,C> u, w;
+    vec<N,C> vu, vw;
+    for (size_t i = 0; i < N; ++i) {
+        vu[i] = u[i] = C(0.1 * i, 1. - 0.01 * i);
+        vw[i] = w[i] = C(-0.3, 0.02 * i);
+    }
+    C uw = u * w, vuvw = vu * vw;
+    assert(abs(uw - vuvw) <= 10 * eps * abs(vuvw));
+    assert(CLOSE(u.norm2_sq(), vu.norm2_sq(), 10 * eps));
+    assert(conj(u) == conj(vu));
+    u.conj();
+    assert(u == conj(vu));
+
+    // long vectors are processed in chunks
+    const size_t M = heap_vec_parallel_size + 1001;
+    heap_vec<M,double> x(1.), y(2.);
+    heap_vec<M,double> z = x + 0.5 * y;
+    for (size_t i = 0; i < M; i += 997)
+        assert(z[i] == 2.);
+    assert(x * y == 2. * M);
+    assert(z.norm2_sq() == 4. * M);
+    return 0;
+}
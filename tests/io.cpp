@@ -0,0 +1,166 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "../vec_io.hpp"
+
+using namespace Vec;
+
+template <size_t N, typename T>
+std::vector<vec<N,T>> sample(size_t n)
+{
+    std::vector<vec<N,T>> res(n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < N; ++i)
+            res[k][i] = T(std::sin(double(k * N + i)) * 1e3);
+    return res;
+}
+
+// a stream buffer that cannot seek, like a pipe
+struct unseekable_buf : std::streambuf {
+    explicit unseekable_buf(std::string& s)
+    {
+        setg(&s[0], &s[0], &s[0] + s.size());
+    }
+};
+
+template <size_t N, typename T>
+void binary_test()
+{
+    std::vector<vec<N,T>> v = sample<N,T>(1000);
+
+    // stream round trip, both with the count patched in and left unknown
+    std::stringstream ss;
+    {
+        vec_writer<N,T> w(ss);
+        w.write(v.data(), 10);
+        w.write(v.begin() + 10, v.end());
+        assert(w.size() == v.size());
+    }
+    std::string bytes = ss.str();
+    assert(bytes.size() == sizeof(vec_file_header) + v.size() * sizeof(vec<N,T>));
+    assert((read_vecs<N,T>(ss) == v));
+    vec_file_header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    assert(h.count == v.size() && h.dim == N);
+    h.count = vec_file_header::unknown_count;
+    std::memcpy(&bytes[0], &h, sizeof(h));
+    std::istringstream unknown(bytes);
+    assert((read_vecs<N,T>(unknown) == v));
+
+    // a count the stream cannot back is rejected before allocating it,
+    // whether the stream can seek or not
+    h.count = uint64_t(1) << 40;
+    std::memcpy(&bytes[0], &h, sizeof(h));
+    for (int seekable = 0; seekable < 2; ++seekable) {
+        std::istringstream is(bytes);
+        unseekable_buf buf(bytes);
+        std::istream unseekable(&buf);
+        bool thrown = false;
+        try {
+            read_vecs<N,T>(seekable ? is : unseekable);
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    h.count = v.size();
+    std::memcpy(&bytes[0], &h, sizeof(h));
+    unseekable_buf buf(bytes);
+    std::istream unseekable(&buf);
+    assert((read_vecs<N,T>(unseekable) == v));
+
+    // memory-mapped file
+    const std::string path = "io_test.vec";
+    {
+        vec_writer<N,T> w(path);
+        for (const auto& x : v)
+            w.write(x);
+    }
+    {
+        vec_mapped_file<N,T> m(path);
+        assert(m.size() == v.size());
+        for (size_t k = 0; k < v.size(); ++k)
+            assert(m[k] == v[k]);
+        assert(std::equal(m.begin(), m.end(), v.begin()));
+        vec_mapped_file<N,T> moved(std::move(m));
+        assert(moved.data()[v.size() - 1] == v.back());
+    }
+
+    // mismatching types are rejected
+    bool thrown = false;
+    try {
+        vec_mapped_file<N + 1,T> m(path);
+    } catch (std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::remove(path.c_str());
+}
+
+template <size_t N, typename T>
+void text_test()
+{
+    std::vector<vec<N,T>> v = sample<N,T>(20);
+    std::stringstream ss;
+    ss.precision(std::numeric_limits<double>::max_digits10);
+    for (const auto& x : v)
+        ss << x << '\n';
+    for (const auto& x : v) {
+        vec<N,T> y;
+        assert(ss >> y);
+        assert(y == x);
+    }
+    vec<N,T> y;
+    assert(!(ss >> y));
+}
+
+int main ()
+{
+    binary_test<3,double>();
+    binary_test<2,float>();
+    binary_test<4,int>();
+    binary_test<3,std::complex<double>>();
+
+    text_test<3,double>();
+    text_test<1,int>();
+    text_test<2,std::complex<double>>();
+
+    // plain whitespace-separated components
+    std::istringstream plain("1 2.5 -3\n4 5 6");
+    vec<3,double> a, b;
+    assert(plain >> a >> b);
+    assert((a == vec<3,double>{1, 2.5, -3}));
+    assert((b == vec<3,double>{4, 5, 6}));
+
+    // malformed input sets failbit and leaves the vec alone
+    std::istringstream bad("(1, 2; 3)");
+    assert(!(bad >> a));
+    assert((a == vec<3,double>{1, 2.5, -3}));
+    std::istringstream short_("(1, 2)");
+    assert(!(short_ >> a));
+
+    return 0;
+}
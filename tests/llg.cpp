@@ -0,0 +1,248 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../vec_llg.hpp"
+
+using namespace Vec;
+
+typedef vec<3,double> V;
+
+const llg_scheme schemes[] = {llg_scheme::heun, llg_scheme::midpoint};
+
+std::vector<V> random_spins(size_t n, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> gauss;
+    std::vector<V> s(n);
+    for (V& a : s) {
+        a = {gauss(rng), gauss(rng), gauss(rng)};
+        a /= a.norm();
+    }
+    return s;
+}
+
+// a static field per spin
+struct static_field {
+    std::vector<V> b;
+
+    void operator()(const std::vector<V>&, std::vector<V>& h) const
+    {
+        h = b;
+    }
+};
+
+// nearest neighbour exchange on a ring
+struct ring_field {
+    double J;
+
+    void operator()(const std::vector<V>& s, std::vector<V>& h) const
+    {
+        const size_t n = s.size();
+        for (size_t k = 0; k < n; ++k)
+            h[k] = J * (s[(k + n - 1) % n] + s[(k + 1) % n]);
+    }
+};
+
+double energy(const std::vector<V>& s, const std::vector<V>& b)
+{
+    double e = 0;
+    for (size_t k = 0; k < s.size(); ++k)
+        e -= s[k] * b[k];
+    return e;
+}
+
+// error of the precession about a field B z after time t in steps of dt
+double precession_error(llg_scheme scheme, double dt)
+{
+    const double gamma = 1.5, B = 2., t = 1.;
+    llg_integrator<double> llg(gamma, 0., scheme);
+    std::vector<V> s = {V{1., 0., 0.}};
+    static_field field{{V{0., 0., B}}};
+    const int steps = int(std::lround(t / dt));
+    for (int i = 0; i < steps; ++i)
+        llg.step(s, dt, field);
+    const double w = gamma * B * t;
+    return V(s[0] - V{std::cos(w), std::sin(w), 0.}).norm();
+}
+
+int main()
+{
+    // precession at the Larmor frequency, to second order in dt
+    for (llg_scheme scheme : schemes) {
+        const double e1 = precession_error(scheme, 1e-2);
+        const double e2 = precession_error(scheme, 5e-3);
+        assert(e1 < 1e-3);
+        assert(e2 < e1 / 3.5 && e2 > e1 / 4.5);
+    }
+
+    // without damping, spins stay on the unit sphere and the Zeeman energy
+    // in a static field is conserved (by the midpoint scheme up to rounding)
+    for (llg_scheme scheme : schemes) {
+        const size_t n = 1000;
+        std::vector<V> s = random_spins(n, 1);
+        static_field field{random_spins(n, 2)};
+        const double e0 = energy(s, field.b);
+        llg_integrator<double> llg(1., 0., scheme);
+        for (int i = 0; i < 1000; ++i)
+            llg.step(s, 1e-2, field);
+        for (const V& a : s)
+            assert(std::abs(a.norm() - 1) < 1e-14);
+        const double de = std::abs(energy(s, field.b) - e0);
+        if (scheme == llg_scheme::midpoint)
+            assert(de < 1e-11);
+        else
+            assert(de < 1e-4 * n);
+    }
+
+    // exchange conserves the total spin and the exchange energy
+    for (llg_scheme scheme : schemes) {
+        const size_t n = 64;
+        std::vector<V> s = random_spins(n, 3);
+        const ring_field field{1.};
+        auto total = [](const std::vector<V>& x) {
+            V m{};
+            for (const V& a : x)
+                m += a;
+            return m;
+        };
+        auto exchange = [&](const std::vector<V>& x) {
+            double e = 0;
+            for (size_t k = 0; k < n; ++k)
+                e -= field.J * (x[k] * x[(k + 1) % n]);
+            return e;
+        };
+        const V m0 = total(s);
+        const double e0 = exchange(s);
+        llg_integrator<double> llg(1., 0., scheme);
+        for (int i = 0; i < 1000; ++i)
+            llg.step(s, 1e-3, field);
+        assert(V(total(s) - m0).norm() < 1e-5);
+        assert(std::abs(exchange(s) - e0) < 1e-5);
+    }
+
+    // damping relaxes a spin towards the field: tan(theta/2) decays with
+    // the rate alpha gamma B / (1 + alpha^2), and the energy never rises
+    for (llg_scheme scheme : schemes) {
+        const double gamma = 1., alpha = .3, B = 1., theta0 = 2.5, dt = 1e-2;
+        std::vector<V> s = {V{std::sin(theta0), 0., std::cos(theta0)}};
+        static_field field{{V{0., 0., B}}};
+        llg_integrator<double> llg(gamma, alpha, scheme);
+        double e = energy(s, field.b);
+        for (int i = 0; i < 500; ++i) {
+            llg.step(s, dt, field);
+            const double ei = energy(s, field.b);
+            assert(ei < e);
+            e = ei;
+        }
+        const double rate = alpha * gamma * B / (1 + alpha * alpha);
+        const double theta = 2 * std::atan(std::tan(theta0 / 2)
+                                           * std::exp(-rate * 500 * dt));
+        assert(std::abs(std::acos(s[0][2]) - theta) < 1e-4);
+        assert(std::abs(s[0].norm() - 1) < 1e-15);
+    }
+
+    // large steps still yield unit spins
+    {
+        std::vector<V> s = random_spins(13, 4);
+        static_field field{random_spins(13, 5)};
+        for (V& b : field.b)
+            b *= 100.;
+        llg_integrator<double> llg(1., .5, llg_scheme::heun);
+        llg.step(s, 1e-2, field);
+        for (const V& a : s)
+            assert(std::abs(a.norm() - 1) < 1e-15);
+    }
+
+    // the field may replace the field array, or must throw if it resizes it
+    for (llg_scheme scheme : schemes) {
+        const size_t n = 1000;
+        const V b = {.3, -.2, 1.};
+        std::vector<V> s1 = random_spins(n, 8), s2 = s1;
+        llg_integrator<double> llg1(1.7, .1, scheme), llg2(1.7, .1, scheme);
+        for (int i = 0; i < 3; ++i) {
+            llg1.step(s1, 1e-2, [&](const std::vector<V>&,
+                                    std::vector<V>& h) {
+                for (V& a : h)
+                    a = b;
+            });
+            llg2.step(s2, 1e-2, [&](const std::vector<V>&,
+                                    std::vector<V>& h) {
+                h = std::vector<V>(n, b);
+            });
+        }
+        assert(s1 == s2);
+
+        bool thrown = false;
+        try {
+            llg2.step(s2, 1e-2, [&](const std::vector<V>&,
+                                    std::vector<V>& h) {
+                h = std::vector<V>(n / 2, b);
+            });
+        } catch (std::length_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // bit-identical for every instruction set and number of threads, also
+    // for a remainder of spins which does not fill a vector
+    for (llg_scheme scheme : schemes) {
+        const size_t n = 10007;
+        const std::vector<V> s0 = random_spins(n, 6);
+        const static_field field{random_spins(n, 7)};
+        auto run = [&](thread_pool& pool) {
+            std::vector<V> s = s0;
+            llg_integrator<double> llg(1.7, .1, scheme, pool);
+            for (int i = 0; i < 10; ++i)
+                llg.step(s, 1e-2, field);
+            return s;
+        };
+        simd_select(simd_isa::scalar);
+        const std::vector<V> ref = run(thread_pool::global());
+        const simd_isa isas[] = {simd_isa::sse2, simd_isa::avx2,
+                                 simd_isa::avx512};
+        for (simd_isa isa : isas) {
+            simd_select(isa);
+            assert(run(thread_pool::global()) == ref);
+        }
+        simd_select(simd_detect());
+        thread_pool pool(4);
+        assert(run(pool) == ref);
+
+        // float spins
+        std::vector<vec<3,float>> sf(n);
+        std::vector<vec<3,float>> bf(n);
+        for (size_t k = 0; k < n; ++k) {
+            sf[k] = s0[k];
+            bf[k] = field.b[k];
+        }
+        llg_integrator<float> llg(1.7f, .1f, scheme);
+        for (int i = 0; i < 10; ++i)
+            llg.step(sf, 1e-2f, [&](const std::vector<vec<3,float>>&,
+                                    std::vector<vec<3,float>>& h) {
+                h = bf;
+            });
+        for (size_t k = 0; k < n; ++k) {
+            assert(std::abs(sf[k].norm() - 1) < 1e-6f);
+            assert((vec<3,double>(vec<3,double>(sf[k]) - ref[k]).norm() < 1e-5));
+        }
+    }
+}
@@ -0,0 +1,156 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include "close.hpp"
+#include "../vec_mat.hpp"
+
+using namespace Vec;
+
+// reference product via the generic vec operations
+template <size_t N, size_t M, typename A, typename B>
+vec<N,A> naive_apply(const mat<N,M,A>& m, const vec<M,B>& x)
+{
+    vec<N,A> res;
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < M; ++j)
+            res[i] += m(i, j) * x[j];
+    return res;
+}
+
+// the batched and the per-vector products may round differently where the
+// compiler fuses multiply-adds, e.g. with -march=native
+template <size_t N, typename T>
+bool close_vec(const vec<N,T>& a, const vec<N,T>& b)
+{
+    typedef typename norm_type<T>::type R;
+    const R tol = 16 * std::numeric_limits<R>::epsilon();
+    for (size_t i = 0; i < N; ++i)
+        if (!(std::abs(a[i] - b[i]) <= tol * std::max(R(1), std::abs(b[i]))))
+            return false;
+    return true;
+}
+
+// a square matrix can be applied in place
+template <size_t N, typename T>
+void apply_inplace_test()
+{
+    mat<N,N,T> m;
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            m(i, j) = T(std::sin(double(i * N + j + 1)));
+    std::vector<vec<N,T>> x(10);
+    for (size_t k = 0; k < x.size(); ++k)
+        for (size_t j = 0; j < N; ++j)
+            x[k][j] = T(std::cos(double(k * N + j)));
+
+    std::vector<vec<N,T>> y = apply(m, x);
+    apply(m, x.data(), x.data(), x.size());
+    assert(x == y);
+}
+
+template <size_t N, size_t M, typename T>
+void apply_test()
+{
+    mat<N,M,T> m;
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < M; ++j)
+            m(i, j) = T(std::sin(double(i * M + j + 1)));
+    std::vector<vec<M,T>> x(100);
+    for (size_t k = 0; k < x.size(); ++k)
+        for (size_t j = 0; j < M; ++j)
+            x[k][j] = T(std::cos(double(k * M + j)));
+
+    std::vector<vec<N,T>> y = apply(m, x);
+    vec_array<N,T> z = apply(m, vec_array<M,T>(x.begin(), x.end()));
+    for (size_t k = 0; k < x.size(); ++k) {
+        vec<N,T> ref = naive_apply(m, x[k]);
+        vec<N,T> mx = m * x[k];
+        for (size_t i = 0; i < N; ++i)
+            assert(CLOSE(mx[i], ref[i], 1e-12) || std::abs(mx[i] - ref[i]) < 1e-12);
+        assert(close_vec(y[k], mx));
+        assert(close_vec(vec<N,T>(z[k]), mx));
+    }
+
+    // (A B) x == A (B x) and (A B)^T = B^T A^T
+    mat<M,N,T> b = transpose(m);
+    mat<N,N,T> mb = m * b;
+    assert(transpose(mb) == transpose(b) * transpose(m));
+    vec<N,T> lhs = mb * vec<N,T>(T(1));
+    vec<N,T> rhs = m * (b * vec<N,T>(T(1)));
+    assert((vec<N,T>(lhs - rhs).norm() < 1e-5));
+}
+
+int main ()
+{
+    // construction and element access
+    mat<2,3,double> a{{1, 2, 3}, {4, 5, 6}};
+    assert(a(1, 2) == 6 && a[0][1] == 2);
+    assert((a.col(1) == vec<2,double>{2, 5}));
+    assert((transpose(a)[2] == vec<2,double>{3, 6}));
+    assert((mat<3,3,int>::identity() * vec<3,int>{1, 2, 3}
+            == vec<3,int>{1, 2, 3}));
+    assert((mat<2,2,int>::diagonal({2, 3}) * vec<2,int>{1, 1}
+            == vec<2,int>{2, 3}));
+
+    // arithmetic
+    assert((a * vec<3,double>{1, 0, -1} == vec<2,double>{-2, -2}));
+    assert((2. * a == a + a) && (a * 2. / 2. == a));
+    assert((a - a == mat<2,3,double>()) && (-a + a == mat<2,3,double>()));
+    mat<2,3,double> c = a;
+    c *= 3.;
+    c -= a;
+    c /= 2.;
+    assert(c == a);
+    assert((mat<2,2,double>{{1, 2}, {3, 4}} * mat<2,2,double>{{0, 1}, {1, 0}}
+            == mat<2,2,double>{{2, 1}, {4, 3}}));
+
+    // Hermitian adjoint
+    typedef std::complex<double> C;
+    C I(0, 1);
+    mat<2,2,C> h{{1., 2. + I}, {3. * I, 4.}};
+    mat<2,2,C> hd = adjoint(h);
+    assert(hd(0, 1) == -3. * I && hd(1, 0) == 2. - I);
+    assert(adjoint(hd) == h && conj(transpose(h)) == hd);
+    vec<2,C> u{1. + I, 2.};
+    vec<2,C> v{-I, 3.};
+    // <u, H v> == <H^dagger u, v>
+    assert(CLOSE((u * (h * v)), ((hd * u) * v), 1e-15));
+    mat<2,2,C> p = h * hd;
+    assert(adjoint(p) == p);
+
+    // output
+    std::ostringstream os;
+    os << a;
+    assert(os.str() == "((1, 2, 3), (4, 5, 6))");
+
+    apply_test<2,2,double>();
+    apply_test<3,3,double>();
+    apply_test<4,4,float>();
+    apply_test<3,2,double>();
+    apply_test<6,5,double>();
+    apply_inplace_test<3,double>();
+    apply_inplace_test<4,float>();
+    apply_test<3,3,C>();
+
+    return 0;
+}
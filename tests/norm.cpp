@@ -18,12 +18,67 @@
 #include <cmath>
 #include <limits>
 #include "close.hpp"
+#include <type_traits>
+#include <vector>
 #include "../vec.hpp"
+#include "../vec_array.hpp"
+#include "../vec_simd.hpp"
 
 using namespace Vec;
 
 const size_t N = 10;
 
+// reference p-norm using std::pow per element
+template <size_t M, typename T>
+long double pow_norm(const vec<M,T>& v, long double p)
+{
+    long double sum = 0;
+    for (size_t i = 0; i < M; ++i)
+        sum += std::pow(std::abs(std::complex<long double>(v[i])), p);
+    return std::pow(sum, 1 / p);
+}
+
+template <typename T, typename R>
+void norm_test(R tol)
+{
+    vec<5,T> v{T(1.5), T(-2), T(0.25), T(3), T(-0.5)};
+    static_assert(std::is_same<decltype(v.norm()), R>::value, "norm type");
+    static_assert(std::is_same<decltype(v.template norm<3>()), R>::value,
+                  "norm type");
+    for (long double p : {1.L, 2.L, 3.L, 4.L, 7.L, 2.5L})
+        assert(CLOSE(v.norm(double(p)), R(pow_norm(v, p)), tol));
+    assert(v.template norm<1>() == v.norm(1));
+    assert(v.template norm<2>() == v.norm());
+    assert(v.template norm<3>() == v.norm(3));
+    assert(v.norm_inf() == R(3));
+    assert(v.norm(std::numeric_limits<double>::infinity()) == R(3));
+    assert(CLOSE(v.norm_scaled(), v.norm(), tol));
+    assert(CLOSE(v.template norm_scaled<3>(), v.norm(3), tol));
+
+    // the scaled norm survives where the squares would over- or underflow
+    const R huge = std::numeric_limits<R>::max() / 4;
+    vec<2,T> h{T(huge), T(huge)};
+    assert(CLOSE(h.norm_scaled(), (huge * std::sqrt(R(2))), tol));
+    const R tiny = std::numeric_limits<R>::denorm_min() * 1024;
+    vec<2,T> t{T(3 * tiny), T(4 * tiny)};
+    assert(CLOSE(t.norm_scaled(), (5 * tiny), R(1e-3)));
+    assert((vec<2,T>{}).norm_scaled() == 0);
+
+    // batch forms agree with the member functions
+    std::vector<vec<3,T>> aos;
+    for (size_t k = 0; k < 50; ++k)
+        aos.push_back({T(k % 7) - T(3), T(0.5) * T(k % 3), T(k) / T(8)});
+    vec_array<3,T> arr(aos.begin(), aos.end());
+    for (double p : {1., 2., 3., 2.5, std::numeric_limits<double>::infinity()}) {
+        std::vector<R> a = norm(arr, p);
+        std::vector<R> b = norm(aos, p);
+        for (size_t k = 0; k < aos.size(); ++k) {
+            assert(a[k] == aos[k].norm(p));
+            assert(b[k] == aos[k].norm(p));
+        }
+    }
+}
+
 int main ()
 {
     vec<N,double> a(1.);
@@ -42,5 +97,16 @@ int main ()
     assert(CLOSE(c.norm() * 42., d.norm(),
                  100 * std::numeric_limits<double>::epsilon()));
 
+    norm_test<float>(10 * std::numeric_limits<float>::epsilon());
+    norm_test<double>(10 * std::numeric_limits<double>::epsilon());
+    norm_test<long double>(10 * std::numeric_limits<long double>::epsilon());
+    norm_test<std::complex<double>>(10 * std::numeric_limits<double>::epsilon());
+
+    // integers are normed in double precision
+    vec<2,int> e{3, -4};
+    static_assert(std::is_same<decltype(e.norm()), double>::value,
+                  "norm type");
+    assert(e.norm() == 5. && e.norm<1>() == 7. && e.norm_inf() == 4.);
+
     return 0;
 }
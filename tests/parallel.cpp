@@ -0,0 +1,152 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <cassert>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+#include "close.hpp"
+#include "../vec_parallel.hpp"
+
+using namespace Vec;
+
+int main()
+{
+    const size_t n = 100000;
+    std::vector<vec<3,double>> x(n), y(n);
+    for (size_t k = 0; k < n; ++k) {
+        x[k] = {1. + k % 7, -0.5 * (k % 3), 0.25 * k};
+        y[k] = {0., 1., double(k % 5)};
+    }
+    auto normalize = [](const vec<3,double>& v) { return v / v.norm(); };
+    auto crossed = [](const vec<3,double>& a, const vec<3,double>& b) {
+        return vec<3,double>(cross(a, b));
+    };
+
+    for (unsigned threads : {1u, 2u, 4u}) {
+        thread_pool pool(threads);
+        assert(pool.concurrency() == threads);
+
+        // every index is visited exactly once
+        {
+            std::vector<std::atomic<int>> hits(n);
+            for (auto& h : hits)
+                h = 0;
+            pool.parallel_for(n, [&](size_t b, size_t e) {
+                for (size_t k = b; k < e; ++k)
+                    ++hits[k];
+            }, 100);
+            for (auto& h : hits)
+                assert(h == 1);
+            pool.parallel_for(0, [](size_t, size_t) { assert(false); });
+        }
+
+        // unary, out of place and in place
+        {
+            std::vector<vec<3,double>> out;
+            vec_map(x, out, normalize, pool);
+            assert(out.size() == n);
+            for (size_t k = 0; k < n; ++k)
+                assert(out[k] == normalize(x[k]));
+
+            std::vector<vec<3,double>> z = x;
+            vec_map(z, normalize, pool);
+            assert(z == out);
+        }
+
+        // binary, out of place and in place
+        {
+            std::vector<vec<3,double>> out;
+            vec_zip(x, y, out, crossed, pool);
+            for (size_t k = 0; k < n; ++k)
+                assert(out[k] == crossed(x[k], y[k]));
+
+            std::vector<vec<3,double>> z = x;
+            vec_zip(z, y, crossed, pool);
+            assert(z == out);
+        }
+
+        // the element type may change
+        {
+            std::vector<vec<2,std::complex<double>>> c(n);
+            for (size_t k = 0; k < n; ++k)
+                c[k] = {std::complex<double>(k, 1.), std::complex<double>(0., -2.)};
+            std::vector<double> nrm(n);
+            vec_map(c.data(), nrm.data(), n,
+                    [](const vec<2,std::complex<double>>& v) {
+                        return v.norm();
+                    }, pool);
+            assert(CLOSE(nrm[3], std::sqrt(9. + 1. + 4.), 1e-15));
+        }
+
+        // exceptions are propagated to the caller
+        {
+            bool thrown = false;
+            try {
+                pool.parallel_for(n, [](size_t b, size_t e) {
+                    if (b <= n / 2 && n / 2 < e)
+                        throw std::runtime_error("chunk failed");
+                }, 1000);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+
+        // loops may be nested
+        {
+            std::atomic<size_t> count(0);
+            pool.parallel_for(64, [&](size_t b, size_t e) {
+                for (size_t i = b; i < e; ++i)
+                    pool.parallel_for(1000, [&](size_t b2, size_t e2) {
+                        count += e2 - b2;
+                    }, 100);
+            }, 4);
+            assert(count == 64000);
+        }
+    }
+
+    // the global pool
+    {
+        std::vector<vec<3,double>> out;
+        vec_zip(x, y, out, [](const vec<3,double>& a, const vec<3,double>& b) {
+            return vec<3,double>(a + 2. * b);
+        });
+        for (size_t k = 0; k < n; ++k)
+            assert(out[k] == x[k] + 2. * y[k]);
+    }
+
+    // operands of different sizes are rejected
+    {
+        std::vector<vec<3,double>> shorter(y.begin(), y.end() - 1), out;
+        auto add = [](const vec<3,double>& a, const vec<3,double>& b) {
+            return vec<3,double>(a + b);
+        };
+        int thrown = 0;
+        try {
+            vec_zip(x, shorter, out, add);
+        } catch (std::invalid_argument&) {
+            ++thrown;
+        }
+        try {
+            vec_zip(x, shorter, add);
+        } catch (std::invalid_argument&) {
+            ++thrown;
+        }
+        assert(thrown == 2);
+    }
+}
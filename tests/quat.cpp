@@ -0,0 +1,137 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <vector>
+#include "../vec_array.hpp"
+#include "../vec_compare.hpp"
+#include "../vec_quat.hpp"
+
+using namespace Vec;
+
+int main()
+{
+    const double pi = std::acos(-1.);
+    const tolerance tol = tolerance::absolute(1e-14);
+    typedef vec<3,double> V;
+    typedef quat<double> Q;
+
+    // quarter turn about z
+    {
+        Q q = Q::from_axis_angle(V{0., 0., 2.}, pi / 2);
+        assert(std::abs(q.norm() - 1) < 1e-15);
+        assert(approx_equal(rotate(q, V{1., 0., 0.}), V{0., 1., 0.}, tol));
+        assert(approx_equal(rotate(q, V{0., 1., 0.}), V{-1., 0., 0.}, tol));
+        assert(approx_equal(rotate(q, V{0., 0., 1.}), V{0., 0., 1.}, tol));
+        assert(std::abs(q.angle() - pi / 2) < 1e-15);
+        assert(approx_equal(q.axis(), V{0., 0., 1.}, tol));
+        assert(rotate(Q(), V{1., 2., 3.}) == (V{1., 2., 3.}));
+        assert(Q::from_axis_angle(V(), 1.) == Q::identity());
+        assert(Q::identity().axis() == (V{1., 0., 0.}));
+    }
+
+    // rotation preserves norms and agrees with Rodrigues' formula built
+    // from vec operators as well as with the rotation matrix
+    {
+        const V axis = {1., -2., 0.5};
+        const double angle = 0.7;
+        const Q q = Q::from_axis_angle(axis, angle);
+        const V k = axis / axis.norm();
+        const mat<3,3,double> m = rotation_matrix(q);
+        for (int i = 0; i < 10; ++i) {
+            V a = {0.3 * i, 1. - i, 2.};
+            V r = rotate(q, a);
+            V rodrigues = std::cos(angle) * a + std::sin(angle) * cross(k, a)
+                + ((1 - std::cos(angle)) * (k * a)) * k;
+            assert(approx_equal(r, rodrigues, tol.or_relative(1e-14)));
+            assert(approx_equal(r, m * a, tol.or_relative(1e-14)));
+            assert(std::abs(r.norm() - a.norm()) < 1e-14 * a.norm() + 1e-15);
+            assert(approx_equal(rotate(conj(q), r), a, tol.or_relative(1e-14)));
+        }
+        mat<3,3,double> mmt = m * transpose(m);
+        for (size_t i = 0; i < 3; ++i)
+            assert(approx_equal(mmt[i], (mat<3,3,double>::identity()[i]), tol));
+        assert(std::abs(q.angle() - angle) < 1e-15);
+        assert(approx_equal(q.axis(), k, tol));
+        assert(approx_equal(Q::from_rotation_vector(angle * k).v, q.v, tol));
+    }
+
+    // composition: p * q rotates by q first
+    {
+        Q p = Q::from_axis_angle(V{0., 0., 1.}, pi / 2);
+        Q q = Q::from_axis_angle(V{1., 0., 0.}, pi / 2);
+        V a = {0., 1., 0.};
+        assert(approx_equal(rotate(p * q, a), rotate(p, rotate(q, a)), tol));
+        assert(approx_equal(rotate(p * q, a), V{0., 0., 1.}, tol));
+        Q pq = p;
+        pq *= q;
+        assert(pq == p * q);
+        Q e = p * inverse(p);
+        assert(std::abs(e.w - 1) < 1e-15 && approx_equal(e.v, V(), tol));
+        assert(std::abs(dot(p, p) - 1) < 1e-15);
+    }
+
+    // slerp interpolates the angle linearly along the shorter arc
+    {
+        const V z = {0., 0., 1.};
+        Q q0 = Q::from_axis_angle(z, 0.2), q1 = Q::from_axis_angle(z, 1.4);
+        for (double t : {0., 0.25, 0.5, 1.}) {
+            Q q = slerp(q0, q1, t);
+            assert(std::abs(q.norm() - 1) < 1e-15);
+            assert(std::abs(q.angle() - (0.2 + 1.2 * t)) < 1e-14);
+        }
+        // -q1 is the same rotation
+        Q q = slerp(q0, -q1, 0.5);
+        assert(approx_equal(rotate(q, V{1., 0., 0.}),
+                            V{std::cos(0.8), std::sin(0.8), 0.}, tol));
+        // nearly identical rotations
+        Q r = slerp(q0, Q::from_axis_angle(z, 0.2 + 1e-9), 0.5);
+        assert(std::abs(r.angle() - (0.2 + 0.5e-9)) < 1e-14);
+    }
+
+    // batches, in place and out of place
+    {
+        const Q q = Q::from_axis_angle(V{1., 1., 1.}, 2.);
+        const size_t n = 1001;
+        std::vector<V> x(n);
+        for (size_t k = 0; k < n; ++k)
+            x[k] = {std::sin(double(k)), std::cos(0.5 * k), 0.01 * k};
+        std::vector<V> ref(n);
+        for (size_t k = 0; k < n; ++k)
+            ref[k] = rotate(q, x[k]);
+
+        const tolerance t = tol.or_relative(1e-14);
+        assert(all_approx_equal(rotate(q, x), ref, t));
+        std::vector<V> y = x;
+        rotate(q, y, y);
+        assert(all_approx_equal(y, ref, t));
+
+        vec_array<3,double> a(x.begin(), x.end());
+        vec_array<3,double> b(ref.begin(), ref.end());
+        assert(all_approx_equal(rotate(q, a), b, t));
+        rotate(q, a, a);
+        assert(all_approx_equal(a, b, t));
+    }
+
+    // output
+    {
+        std::ostringstream os;
+        os << Q(1., V{2., 3., 4.});
+        assert(os.str() == "(1, (2, 3, 4))");
+    }
+}
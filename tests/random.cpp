@@ -0,0 +1,176 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "../vec_array.hpp"
+#include "../vec_random.hpp"
+
+using namespace Vec;
+
+int main()
+{
+    // known answers of Philox4x32-10 from Random123
+    {
+        uint32_t c[4] = {0, 0, 0, 0};
+        philox4x32::apply(c, 0, 0);
+        assert(c[0] == 0x6627e8d5 && c[1] == 0xe169c58d &&
+               c[2] == 0xbc57ac4c && c[3] == 0x9b00dbd8);
+        uint32_t d[4] = {~0u, ~0u, ~0u, ~0u};
+        philox4x32::apply(d, ~0u, ~0u);
+        assert(d[0] == 0x408f276d && d[1] == 0x41c83b0e &&
+               d[2] == 0xa20bc7c6 && d[3] == 0x6d5451fd);
+        uint32_t e[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+        philox4x32::apply(e, 0xa4093822, 0x299f31d0);
+        assert(e[0] == 0xd16cfe09 && e[1] == 0x94fdcceb &&
+               e[2] == 0x5001e420 && e[3] == 0x24126ea1);
+    }
+
+    // uniform numbers stay within their intervals
+    {
+        assert(random_uniform<double>(0, 0, false) == 0.);
+        assert(random_uniform<double>(0, 0, true) > 0.);
+        assert(random_uniform<double>(~0u, ~0u, false) < 1.);
+        assert(random_uniform<double>(~0u, ~0u, true) < 1.);
+        assert(random_uniform<float>(~0u, ~0u, true) < 1.f);
+        assert(random_uniform<float>(0, 0, true) > 0.f);
+    }
+
+    const size_t n = 100000;
+    const double bound = 5 / std::sqrt(double(n));
+
+    // reproducible regardless of how the batch is split
+    {
+        counter_rng rng(42);
+        std::vector<vec<3,double>> a(n), b(n);
+        random_sphere(rng, a);
+        assert(rng.position() == n);
+
+        counter_rng part(42);
+        part.seek(1000);
+        random_sphere(part, b.data() + 1000, n - 1000);
+        part.seek(0);
+        random_sphere(part, b.data(), 1000);
+        assert(a == b);
+
+        vec_array<3,double> s(n);
+        counter_rng soa(42);
+        random_sphere(soa, s);
+        for (size_t k = 0; k < n; ++k)
+            assert(s[k] == a[k]);
+
+        // continuing from the position differs from starting over
+        random_sphere(rng, b);
+        assert(a != b);
+        counter_rng other(42, 1);
+        random_sphere(other, b);
+        assert(a[0] != b[0]);
+        assert(counter_rng(42, 1).seed() == 42 && other.stream() == 1);
+    }
+
+    // uniform on the sphere
+    {
+        counter_rng rng(7);
+        std::vector<vec<3,double>> x(n);
+        random_sphere(rng, x);
+        vec<3,double> mean;
+        double zz = 0;
+        for (const auto& v : x) {
+            assert(std::abs(v.norm() - 1) < 1e-15);
+            mean += v;
+            zz += v[2] * v[2];
+        }
+        mean /= double(n);
+        assert(mean.norm() < bound);
+        assert(std::abs(zz / n - 1. / 3) < bound);
+
+        std::vector<vec<5,float>> y(1000);
+        random_sphere(rng, y);
+        for (const auto& v : y)
+            assert(std::abs(v.norm() - 1) < 1e-6);
+        std::vector<vec<2,double>> z(1000);
+        random_sphere(rng, z);
+        for (const auto& v : z)
+            assert(std::abs(v.norm() - 1) < 1e-15);
+    }
+
+    // Gaussian
+    {
+        counter_rng rng(3);
+        std::vector<vec<3,double>> x(n);
+        random_gaussian(rng, x, 2.);
+        vec<3,double> mean, var;
+        for (const auto& v : x) {
+            mean += v;
+            for (size_t i = 0; i < 3; ++i)
+                var[i] += v[i] * v[i];
+        }
+        mean /= double(n);
+        var /= double(n);
+        assert(mean.norm() < 2 * bound);
+        for (size_t i = 0; i < 3; ++i)
+            assert(std::abs(var[i] - 4) < 4 * 4 * bound);
+
+        // complex Gaussians are circularly symmetric
+        typedef std::complex<double> C;
+        std::vector<vec<2,C>> z(n);
+        random_gaussian(rng, z);
+        double abs2 = 0;
+        C sq = 0;
+        for (const auto& v : z) {
+            abs2 += std::norm(v[1]);
+            sq += v[1] * v[1];
+        }
+        assert(std::abs(abs2 / n - 1) < 4 * bound);
+        assert(std::abs(sq / double(n)) < 4 * bound);
+
+        vec_array<2,C> s(n);
+        counter_rng again(3);
+        again.discard(n);
+        random_gaussian(again, s);
+        for (size_t k = 0; k < n; ++k)
+            assert(s[k] == z[k]);
+    }
+
+    // uniform in a box
+    {
+        counter_rng rng(11);
+        const vec<3,double> lo = {-1., 0., 10.}, hi = {1., 0.5, 20.};
+        std::vector<vec<3,double>> x(n);
+        random_box(rng, x, lo, hi);
+        vec<3,double> mean;
+        for (const auto& v : x) {
+            for (size_t i = 0; i < 3; ++i)
+                assert(v[i] >= lo[i] && v[i] < hi[i]);
+            mean += v;
+        }
+        mean /= double(n);
+        vec<3,double> mid = 0.5 * (lo + hi);
+        for (size_t i = 0; i < 3; ++i)
+            assert(std::abs(mean[i] - mid[i]) < (hi[i] - lo[i]) * bound);
+
+        typedef std::complex<float> C;
+        vec_array<1,C> z(1000);
+        random_box(rng, z, vec<1,C>{C(0.f, -1.f)}, vec<1,C>{C(1.f, 1.f)});
+        for (size_t k = 0; k < z.size(); ++k) {
+            const C c = z[k][0];
+            assert(c.real() >= 0.f && c.real() < 1.f);
+            assert(c.imag() >= -1.f && c.imag() < 1.f);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "close.hpp"
+#include "../vec_array.hpp"
+#include "../vec_reduce.hpp"
+
+using namespace Vec;
+
+int main()
+{
+    const size_t n = 100000;
+
+    // integer sums are exact
+    {
+        std::vector<vec<3,int>> v;
+        for (size_t k = 0; k < n; ++k)
+            v.push_back({int(k % 11), -int(k % 5), 1});
+        vec<3,int> s = sum(v.begin(), v.end());
+        vec<3,int> ref;
+        for (const auto& x : v)
+            ref += x;
+        assert(s == ref);
+        assert(sum(v.begin(), v.end(), reduce_policy::parallel(3)) == ref);
+        vec<3,double> m = mean(v.begin(), v.end());
+        assert(CLOSE(m[2], 1., 1e-15));
+        assert(CLOSE(m[0], (double(ref[0]) / n), 1e-15));
+
+        // whose sum would overflow int
+        std::vector<vec<2,int>> w(n, vec<2,int>{1 << 30, -(1 << 30)});
+        vec<2,double> mw = mean(w.begin(), w.end());
+        assert(mw[0] == double(1 << 30) && mw[1] == -double(1 << 30));
+    }
+
+    // compensated summation does not accumulate rounding errors
+    {
+        std::vector<vec<2,double>> v(n, vec<2,double>{0.1, -0.3});
+        vec<2,double> s = sum(v.begin(), v.end(), reduce_policy::serial());
+        assert(s[0] == 0.1 * n);
+        assert(s[1] == -0.3 * n);
+        vec<2,double> m = mean(v.begin(), v.end());
+        assert(m[0] == 0.1 && m[1] == -0.3);
+    }
+
+    // float data summed in double under accumulate_wide
+    {
+        std::vector<vec<2,float>> v(n, vec<2,float>{0.1f, 3.f});
+        std::vector<float> w(n, 0.5f);
+        const double x = 0.1f;
+        vec<2,double> s = sum<accumulate_wide>(v.begin(), v.end());
+        assert(CLOSE(s[0], x * n, 1e-15) && s[1] == 3. * n);
+        vec<2,double> m = mean<accumulate_wide>(v.begin(), v.end());
+        assert(CLOSE(m[0], x, 1e-15) && m[1] == 3.);
+        vec<2,double> c = centroid<accumulate_wide>(v.begin(), v.end(),
+                                                    w.begin());
+        assert(CLOSE(c[0], x, 1e-15) && c[1] == 3.);
+        vec<2,float> f = sum(v.begin(), v.end());
+        assert(f[1] == 3.f * n);
+    }
+
+    // reproducible mode is independent of the number of threads
+    {
+        std::vector<vec<3,double>> v;
+        for (size_t k = 0; k < n; ++k)
+            v.push_back({std::sin(double(k)), 1e8 * std::cos(double(k)),
+                         1. / (k + 1)});
+        vec<3,double> s = sum(v.begin(), v.end(),
+                              reduce_policy::reproducible_parallel(1));
+        for (unsigned t : {2u, 3u, 7u}) {
+            vec<3,double> st = sum(v.begin(), v.end(),
+                                   reduce_policy::reproducible_parallel(t));
+            for (size_t i = 0; i < 3; ++i)
+                assert(st[i] == s[i]);
+        }
+        vec<3,double> p = sum(v.begin(), v.end(), reduce_policy::parallel(4));
+        for (size_t i = 0; i < 3; ++i)
+            assert(CLOSE(p[i], s[i], 1e-12));
+    }
+
+    // complex sums
+    {
+        typedef std::complex<double> C;
+        std::vector<vec<2,C>> v(n, vec<2,C>{C(0.1, 0.2), C(-1, 0.7)});
+        vec<2,C> s = sum(v.begin(), v.end());
+        assert(s[0] == C(0.1 * n, 0.2 * n));
+        assert(s[1] == C(-1. * n, 0.7 * n));
+    }
+
+    // extremal norms
+    {
+        std::vector<vec<3,double>> v;
+        for (size_t k = 0; k < n; ++k)
+            v.push_back({double(k % 1000) + 1, 0, 0});
+        v[54321] = {0, 0.5, 0};
+        v[76543] = {0, 3e3, 4e3};
+        std::pair<double,double> mm = minmax_norm(v.begin(), v.end());
+        assert(mm.first == 0.5 && mm.second == 5e3);
+        assert(min_norm(v.begin(), v.end(), reduce_policy::serial()) == 0.5);
+        assert(max_norm(v.begin(), v.end(), reduce_policy::parallel(5)) == 5e3);
+
+        typedef std::complex<double> C;
+        std::vector<vec<2,C>> w(10, vec<2,C>{C(1, 1), C(0, 1)});
+        w[3] = {C(3, 0), C(0, 4)};
+        assert(max_norm(w.begin(), w.end()) == 5.);
+        assert(CLOSE(min_norm(w.begin(), w.end()), std::sqrt(3.), 1e-15));
+    }
+
+    // weighted centroid over a vec_array
+    {
+        vec_array<2,double> a;
+        std::vector<double> w;
+        for (size_t k = 0; k < n; ++k) {
+            a.push_back(vec<2,double>{k % 2 ? 1. : -1., 2.});
+            w.push_back(k % 2 ? 3. : 1.);
+        }
+        vec<2,double> c = centroid(a.begin(), a.end(), w.begin());
+        assert(CLOSE(c[0], 0.5, 1e-15));
+        assert(CLOSE(c[1], 2., 1e-15));
+        vec<2,double> u = centroid(a.begin(), a.end());
+        assert(u[0] == 0.);
+        assert(u[1] == 2.);
+    }
+
+    // empty ranges sum to zero
+    {
+        std::vector<vec<3,double>> v;
+        assert(sum(v.begin(), v.end()) == (vec<3,double>{}));
+    }
+}
@@ -0,0 +1,239 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../vec_hash.hpp"
+#include "../vec_reorder.hpp"
+
+using namespace Vec;
+
+// consecutive cells along the Hilbert curve are adjacent, and every cell
+// of the 2^bits grid is visited once
+template <size_t N>
+void check_hilbert(unsigned bits)
+{
+    const uint32_t side = uint32_t(1) << bits;
+    std::vector<vec<N,uint32_t>> cells(size_t(1) << (N * bits));
+    for (uint64_t code = 0; code < cells.size(); ++code) {
+        const vec<N,uint32_t> c = morton_decode<N>(code);
+        for (size_t i = 0; i < N; ++i)
+            assert(c[i] < side);
+        const uint64_t h = hilbert_encode(c, bits);
+        assert(h < cells.size());
+        cells[h] = c;
+    }
+    for (size_t k = 1; k < cells.size(); ++k) {
+        unsigned dist = 0;
+        for (size_t i = 0; i < N; ++i)
+            dist += cells[k][i] > cells[k-1][i] ? cells[k][i] - cells[k-1][i]
+                                                : cells[k-1][i] - cells[k][i];
+        assert(dist == 1);
+    }
+    assert((cells[0] == vec<N,uint32_t>(0u)));
+}
+
+int main()
+{
+    std::mt19937_64 rng(7);
+
+    // Morton codes: bit interleaving and its inverse, portable and BMI2,
+    // agreeing with morton_less
+    {
+        assert((morton_encode(vec<3,uint32_t>{5u, 3u, 7u}) == 0x15f));
+        assert((morton_encode(vec<2,uint32_t>{1u, 0u}) == 2));
+        const uint32_t max3 = (1u << 21) - 1;
+        assert((morton_encode(vec<3,uint32_t>(max3)) == (uint64_t(1) << 63) - 1));
+        assert((morton_encode(vec<2,uint32_t>(0xffffffffu)) == ~uint64_t(0)));
+        morton_less less;
+        for (int n = 0; n < 10000; ++n) {
+            const vec<3,uint32_t> a = {uint32_t(rng() & max3),
+                                       uint32_t(rng() & max3),
+                                       uint32_t(rng() & max3)};
+            const vec<3,uint32_t> b = {uint32_t(rng() & max3),
+                                       uint32_t(rng() & max3),
+                                       uint32_t(rng() & max3)};
+            const vec<2,uint32_t> c = {uint32_t(rng()), uint32_t(rng())};
+            assert(morton_decode<3>(morton_encode(a)) == a);
+            assert(morton_decode<2>(morton_encode(c)) == c);
+            assert(less(a, b) == (morton_encode(a) < morton_encode(b)));
+#ifdef VEC_REORDER_X86
+            if (sfc_detect_bmi2()) {
+                assert(morton_encode_bmi2(a) == morton_encode(a));
+                assert(morton_encode_bmi2(c) == morton_encode(c));
+                assert(morton_decode_bmi2<3>(morton_encode(a)) == a);
+                assert(morton_decode_bmi2<2>(morton_encode(c)) == c);
+            }
+#endif
+        }
+    }
+
+    // Hilbert curve
+    check_hilbert<2>(1);
+    check_hilbert<2>(5);
+    check_hilbert<3>(1);
+    check_hilbert<3>(4);
+    {
+        // full resolution keys stay distinct
+        const uint32_t max3 = (1u << 21) - 1;
+        assert((hilbert_encode(vec<3,uint32_t>(max3)) < uint64_t(1) << 63));
+        assert((hilbert_encode(vec<2,uint32_t>{0u, 1u})
+                != hilbert_encode(vec<2,uint32_t>{1u, 0u})));
+    }
+
+    // grid cells: corners of the box, clamping
+    {
+        const sfc_grid<3,double> g({0., 0., 0.}, {2., 1., 1.});
+        const uint32_t top = (1u << 21) - 1;
+        assert((g.cell({0., 0., 0.}) == vec<3,uint32_t>(0u)));
+        assert((g.cell({2., 0., 0.}) == vec<3,uint32_t>{top, 0u, 0u}));
+        assert((g.cell({1., 1., 1.})[1] == top / 2));
+        assert((g.cell({-5., 9., 0.5}) == vec<3,uint32_t>{0u, top, top / 4}));
+    }
+
+    // the top cell of a float grid with 2^32 cells per axis
+    {
+        const sfc_grid<2,float> g({-1.f, 0.f}, {3.f, 4.f});
+        const uint32_t top = ~0u;
+        assert((g.cell({-1.f, 0.f}) == vec<2,uint32_t>(0u)));
+        assert((g.cell({3.f, 4.f}) == vec<2,uint32_t>(top)));
+        assert((g.cell({3.f, 0.f}) == vec<2,uint32_t>{top, 0u}));
+        assert((g.cell({-2.f, 5.f}) == vec<2,uint32_t>{0u, top}));
+    }
+
+    // radix sort: stable, agrees with std::stable_sort for keys differing
+    // in many or few bits, and regardless of the number of threads
+    for (unsigned bits : {64u, 40u, 9u}) {
+        const size_t n = 300000;
+        // constant high bits are skipped
+        const uint64_t high = bits == 40 ? uint64_t(0x5a) << 56 : 0;
+        std::vector<uint64_t> keys(n);
+        for (uint64_t& k : keys)
+            k = high | (bits == 64 ? rng() : rng() & ((uint64_t(1) << bits) - 1));
+        std::vector<uint64_t> sorted = keys;
+        std::vector<size_t> ref(n);
+        std::iota(ref.begin(), ref.end(), 0);
+        std::stable_sort(ref.begin(), ref.end(), [&](size_t i, size_t j) {
+            return keys[i] < keys[j];
+        });
+        const std::vector<size_t> perm = radix_sort_permutation(sorted);
+        assert(perm == ref);
+        for (size_t k = 0; k < n; ++k)
+            assert(sorted[k] == keys[perm[k]]);
+
+        // one chunk per thread
+        thread_pool pool(4);
+        sorted = keys;
+        assert(radix_sort_permutation(sorted, pool) == ref);
+
+        // short ranges are sorted in cache right away
+        sorted.assign(keys.begin(), keys.begin() + 1000);
+        const std::vector<size_t> p = radix_sort_permutation(sorted);
+        for (size_t k = 1; k < p.size(); ++k)
+            assert(keys[p[k - 1]] < keys[p[k]]
+                   || (keys[p[k - 1]] == keys[p[k]] && p[k - 1] < p[k]));
+    }
+    {
+        std::vector<uint64_t> none;
+        assert(radix_sort_permutation(none).empty());
+        std::vector<uint64_t> same(1000, 42);
+        const std::vector<size_t> perm = radix_sort_permutation(same);
+        for (size_t k = 0; k < perm.size(); ++k)
+            assert(perm[k] == k);
+    }
+
+    // permutations
+    {
+        const std::vector<size_t> perm = {2, 0, 3, 1};
+        std::vector<int> data = {10, 11, 12, 13};
+        apply_permutation(perm, data);
+        assert((data == std::vector<int>{12, 10, 13, 11}));
+        const std::vector<size_t> inv = invert_permutation(perm);
+        for (size_t k = 0; k < perm.size(); ++k)
+            assert(inv[perm[k]] == k);
+        std::vector<int> wrong(3);
+        bool thrown = false;
+        try {
+            apply_permutation(perm, wrong);
+        } catch (std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // reordering points with payload
+    for (sfc_curve curve : {sfc_curve::morton, sfc_curve::hilbert}) {
+        std::uniform_real_distribution<double> uni(-3., 5.);
+        const size_t n = 20000;
+        std::vector<vec<3,double>> x(n);
+        std::vector<int> id(n);
+        std::vector<vec<3,double>> v(n);
+        for (size_t k = 0; k < n; ++k) {
+            x[k] = {uni(rng), uni(rng), uni(rng)};
+            id[k] = int(k);
+            v[k] = 2. * x[k];
+        }
+        const std::vector<vec<3,double>> x0 = x;
+        const std::vector<size_t> perm = sfc_reorder(x, curve, id, v);
+        const std::vector<uint64_t> keys = sfc_keys(x, curve);
+        for (size_t k = 0; k < n; ++k) {
+            assert(x[k] == x0[perm[k]]);
+            assert(size_t(id[k]) == perm[k]);
+            assert(v[k] == 2. * x[k]);
+            if (k)
+                assert(keys[k - 1] <= keys[k]);
+        }
+
+        // neighbours along the curve are mostly close in space
+        double mean_step = 0;
+        for (size_t k = 1; k < n; ++k)
+            mean_step += vec<3,double>(x[k] - x[k - 1]).norm() / (n - 1);
+        assert(mean_step < 0.5);
+
+        std::vector<int> short_payload(n - 1);
+        bool thrown = false;
+        try {
+            sfc_reorder(x, curve, id, short_payload);
+        } catch (std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(x[0] == x0[perm[0]]);
+    }
+
+    // 2D, and the portable kernels give the same keys
+    for (sfc_curve curve : {sfc_curve::morton, sfc_curve::hilbert}) {
+        std::uniform_real_distribution<float> uni(0.f, 1.f);
+        std::vector<vec<2,float>> x(5000);
+        for (vec<2,float>& a : x)
+            a = {uni(rng), uni(rng)};
+        sfc_select_bmi2(false);
+        assert(!sfc_bmi2_active());
+        const std::vector<uint64_t> keys = sfc_keys(x, curve);
+        const std::vector<size_t> perm = sfc_order(x, curve);
+        sfc_select_bmi2(true);
+        assert(sfc_bmi2_active() == sfc_detect_bmi2());
+        assert(sfc_keys(x, curve) == keys);
+        assert(sfc_order(x, curve) == perm);
+        for (size_t k = 1; k < perm.size(); ++k)
+            assert(keys[perm[k - 1]] <= keys[perm[k]]);
+    }
+}
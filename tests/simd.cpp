@@ -0,0 +1,124 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "../vec_simd.hpp"
+
+using namespace Vec;
+
+template <size_t N, typename T>
+void simd_test()
+{
+    const size_t n = 37;
+    std::vector<vec<N,T>> a(n), b(n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < N; ++i) {
+            a[k][i] = std::sin(T(k * N + i));
+            b[k][i] = std::cos(T(3 * k + i)) / T(7);
+        }
+
+    // every instruction set yields bit-identical results to the operators
+    const simd_isa isas[] = {simd_isa::scalar, simd_isa::sse2,
+                             simd_isa::avx2, simd_isa::avx512};
+    for (simd_isa isa : isas) {
+        simd_select(isa);
+        std::vector<T> d = dot(a, b);
+        std::vector<T> nsq = norm2_sq(a);
+        for (size_t k = 0; k < n; ++k) {
+            assert(d[k] == a[k] * b[k]);
+            assert(nsq[k] == a[k].norm2_sq());
+        }
+
+        std::vector<vec<N,T>> y(b);
+        simd_axpy(T(.5), a, y);
+        std::vector<vec<N,T>> s(n), t(n);
+        simd_add(simd_data(a), simd_data(b), simd_data(s), N * n);
+        simd_sub(simd_data(a), simd_data(b), simd_data(t), N * n);
+        for (size_t k = 0; k < n; ++k) {
+            vec<N,T> yk = b[k];
+            yk += T(.5) * a[k];
+            assert(y[k] == yk);
+            assert(s[k] == a[k] + b[k]);
+            assert(t[k] == a[k] - b[k]);
+        }
+    }
+    simd_select(simd_detect());
+}
+
+template <typename T>
+void cross_test()
+{
+    const size_t n = 21;
+    std::vector<vec<3,T>> a(n), b(n);
+    // the same data padded to four lanes
+    std::vector<vec<4,T>> ap(n), bp(n), cp(n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < 3; ++i) {
+            ap[k][i] = a[k][i] = std::sin(T(k * 3 + i));
+            bp[k][i] = b[k][i] = std::cos(T(5 * k + i));
+        }
+
+    const simd_isa isas[] = {simd_isa::scalar, simd_isa::sse2,
+                             simd_isa::avx2, simd_isa::avx512};
+    for (simd_isa isa : isas) {
+        simd_select(isa);
+        std::vector<vec<3,T>> c = cross(a, b);
+        std::vector<T> d(n);
+        simd_cross<4>(simd_data(ap), simd_data(bp), simd_data(cp), n);
+        simd_dot<3,4>(simd_data(ap), simd_data(bp), d.data(), n);
+        for (size_t k = 0; k < n; ++k) {
+            vec<3,T> ck = cross(a[k], b[k]);
+            assert(c[k] == ck);
+            for (size_t i = 0; i < 3; ++i)
+                assert(cp[k][i] == ck[i]);
+            assert(cp[k][3] == T(0));
+            assert(d[k] == a[k] * b[k]);
+        }
+    }
+    simd_select(simd_detect());
+}
+
+int main ()
+{
+    simd_test<2, float>();
+    simd_test<3, float>();
+    simd_test<4, float>();
+    simd_test<2, double>();
+    simd_test<3, double>();
+    simd_test<4, double>();
+    cross_test<float>();
+    cross_test<double>();
+
+    // non-floating point types fall back to the generic operators
+    std::vector<vec<3,int>> i = {{1, 2, 3}, {4, 5, 6}};
+    std::vector<int> d = dot(i, i);
+    assert(d[0] == 14 && d[1] == 77);
+
+    // operands of different sizes are rejected rather than overrun
+    std::vector<vec<3,double>> x(10), y(9);
+    std::vector<vec<3,int>> j(1);
+    int thrown = 0;
+    try { dot(x, y); } catch (std::invalid_argument&) { ++thrown; }
+    try { dot(i, j); } catch (std::invalid_argument&) { ++thrown; }
+    try { cross(x, y); } catch (std::invalid_argument&) { ++thrown; }
+    try { cross(i, j); } catch (std::invalid_argument&) { ++thrown; }
+    try { simd_axpy(2., x, y); } catch (std::invalid_argument&) { ++thrown; }
+    assert(thrown == 5);
+    return 0;
+}
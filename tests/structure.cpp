@@ -0,0 +1,160 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+#include "../vec_structure.hpp"
+
+using namespace Vec;
+
+template <size_t N, typename T>
+std::vector<vec<N,T>> random_points(const periodic_box<N,T>& box, size_t n)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<T> uni(0, 1);
+    std::vector<vec<N,T>> x(n);
+    for (vec<N,T>& a : x)
+        for (size_t i = 0; i < N; ++i)
+            a[i] = uni(rng) * box.lengths()[i];
+    return x;
+}
+
+// the recurrence agrees with the direct evaluation at q = 2 pi h / L
+template <size_t N, typename T>
+void check_lattice(const periodic_box<N,T>& box,
+                   const std::vector<vec<N,int>>& h, size_t n, T tol)
+{
+    const std::vector<vec<N,T>> x = random_points(box, n);
+    std::vector<vec<N,T>> q;
+    for (const vec<N,int>& k : h)
+        q.push_back(lattice_wave_vector(box, k));
+    const std::vector<std::complex<T>> rho = lattice_density_modes(box, h, x);
+    const std::vector<std::complex<T>> ref = density_modes(q, x);
+    assert(rho.size() == h.size());
+    for (size_t k = 0; k < h.size(); ++k)
+        assert(std::abs(rho[k] - ref[k]) <= tol * T(n));
+
+    const std::vector<T> s = structure_factor(box, h, x);
+    const std::vector<T> sref = structure_factor(q, x);
+    for (size_t k = 0; k < h.size(); ++k) {
+        assert(s[k] == std::norm(rho[k]) / T(n));
+        assert(std::abs(s[k] - sref[k]) <= 4 * tol * T(n));
+    }
+}
+
+int main()
+{
+    // half of the cube of indices without the origin
+    {
+        const std::vector<vec<3,int>> h = lattice_indices<3>(2);
+        assert(h.size() == (5 * 5 * 5 - 1) / 2);
+        for (const vec<3,int>& a : h) {
+            assert((a != vec<3,int>{0, 0, 0}));
+            for (const vec<3,int>& b : h)
+                assert(a != -b);
+        }
+        assert((h[0] == vec<3,int>{0, 0, 1}));
+        assert((h[1] == vec<3,int>{0, 0, 2}));
+        assert((h[2] == vec<3,int>{0, 1, -2}));
+        assert((h.back() == vec<3,int>{2, 2, 2}));
+        const std::vector<vec<1,int>> h1 = lattice_indices<1>(3);
+        assert(h1.size() == 3 && h1[0][0] == 1 && h1[2][0] == 3);
+    }
+
+    // n not a multiple of the block size, arbitrary order and signs
+    const periodic_box<3,double> box({5., 6., 7.});
+    check_lattice(box, lattice_indices<3>(4), 300, 1e-13);
+    check_lattice(box, {{-2, 1, 0}, {3, -1, 2}, {0, 0, -4}, {-7, 0, 0},
+                        {0, 0, 0}, {1, 1, 1}}, 1000, 1e-13);
+    check_lattice(periodic_box<2,double>({3., 4.}), lattice_indices<2>(6), 77,
+                  1e-13);
+    check_lattice(periodic_box<1,double>(vec<1,double>(2.)),
+                  lattice_indices<1>(9), 5, 1e-13);
+    check_lattice(periodic_box<3,float>({5.f, 6.f, 7.f}),
+                  lattice_indices<3>(3), 200, 1e-5f);
+
+    // Bragg peaks of a simple cubic crystal at multiples of 2 pi / a
+    {
+        const int c = 4;
+        const periodic_box<3,double> cube({double(c), double(c), double(c)});
+        std::vector<vec<3,double>> x;
+        for (int i = 0; i < c; ++i)
+            for (int j = 0; j < c; ++j)
+                for (int k = 0; k < c; ++k)
+                    x.push_back({i + .5, j + .5, k + .5});
+        const std::vector<vec<3,int>> h = lattice_indices<3>(c + 1);
+        const std::vector<double> s = structure_factor(cube, h, x);
+        for (size_t k = 0; k < h.size(); ++k) {
+            const bool bragg = h[k][0] % c == 0 && h[k][1] % c == 0
+                && h[k][2] % c == 0;
+            assert(std::abs(s[k] - (bragg ? double(x.size()) : 0.)) < 1e-9);
+        }
+    }
+
+    // bit-identical results for every instruction set and thread count
+    {
+        const std::vector<vec<3,double>> x = random_points(box, 517);
+        const std::vector<vec<3,int>> h = lattice_indices<3>(5);
+        simd_select(simd_isa::scalar);
+        const std::vector<std::complex<double>> ref =
+            lattice_density_modes(box, h, x);
+        const simd_isa isas[] = {simd_isa::sse2, simd_isa::avx2,
+                                 simd_isa::avx512};
+        for (simd_isa isa : isas) {
+            simd_select(isa);
+            assert(lattice_density_modes(box, h, x) == ref);
+        }
+        simd_select(simd_detect());
+        thread_pool pool(4);
+        assert(lattice_density_modes(box, h, x, pool) == ref);
+        std::vector<vec<3,double>> q;
+        for (const vec<3,int>& k : h)
+            q.push_back(lattice_wave_vector(box, k));
+        assert(density_modes(q, x, pool) == density_modes(q, x));
+    }
+
+    // a shell of modes as a complex vector
+    {
+        const std::vector<vec<3,double>> x = random_points(box, 100);
+        const std::array<vec<3,int>,3> h = {{{1, 0, 0}, {0, 1, 0},
+                                              {0, 0, 1}}};
+        const std::array<vec<3,double>,3> q = {{
+            lattice_wave_vector(box, h[0]), lattice_wave_vector(box, h[1]),
+            lattice_wave_vector(box, h[2])}};
+        const vec<3,std::complex<double>> rho = lattice_density_modes(box, h, x);
+        const vec<3,std::complex<double>> ref = density_modes(q, x);
+        const std::vector<double> s = structure_factor(
+            box, std::vector<vec<3,int>>(h.begin(), h.end()), x);
+        for (size_t k = 0; k < 3; ++k)
+            assert(std::abs(rho[k] - ref[k]) < 1e-10);
+        const double mean = (s[0] + s[1] + s[2]) / 3;
+        assert(std::abs(rho.norm2_sq() / (3 * 100.) - mean) < 1e-12);
+        assert(std::abs(std::real(rho * rho) / (3 * 100.) - mean) < 1e-12);
+    }
+
+    // nothing to sum
+    {
+        const std::vector<vec<3,double>> none;
+        const std::vector<vec<3,int>> h = lattice_indices<3>(1);
+        for (const std::complex<double>& r : lattice_density_modes(box, h, none))
+            assert(r == 0.);
+        assert(lattice_density_modes(box, {}, random_points(box, 3)).empty());
+    }
+}
@@ -0,0 +1,135 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include "../vec.hpp"
+
+using namespace Vec;
+
+// the unrolled operations of short vectors against the plain loops
+
+template <size_t N>
+void check_real()
+{
+    typedef vec<N,double> V;
+    V a, b;
+    for (size_t i = 0; i < N; ++i) {
+        a[i] = std::sin(1. + i) * 3.;
+        b[i] = std::cos(2. * i) / 7.;
+    }
+    double ab = 0;
+    for (size_t i = 0; i < N; ++i)
+        ab += a[i] * b[i];
+    assert(a * b == ab);
+    assert((vec_sum<vec_dot_term>(0., a, b, vec_loop<N>()) == ab));
+    assert(a.norm2_sq() == a * a);
+
+    V c = a;
+    c += 2. * b;
+    c -= b / 3.;
+    c *= 1.5;
+    c /= 0.7;
+    c %= 0.9;
+    for (size_t i = 0; i < N; ++i) {
+        double ci = a[i];
+        ci += 2. * b[i];
+        ci -= b[i] / 3.;
+        ci *= 1.5;
+        ci /= 0.7;
+        ci = std::fmod(ci, 0.9);
+        assert(c[i] == ci);
+    }
+
+    V d(a - b);
+    V e(0.25);
+    V f(&a[0]);
+    for (size_t i = 0; i < N; ++i) {
+        assert(d[i] == a[i] - b[i]);
+        assert(e[i] == 0.25);
+    }
+    assert(f == a);
+    assert(!(f != a));
+    assert((vec_equal(f, a, vec_loop<N>())));
+    for (size_t i = 0; i < N; ++i) {
+        f[i] += 1.;
+        assert(f != a);
+        assert((!vec_equal(f, a, vec_loop<N>())));
+        f[i] = a[i];
+    }
+
+    // partial initializer lists zero the remaining components
+    V g = {1.};
+    assert(g[0] == 1.);
+    for (size_t i = 1; i < N; ++i)
+        assert(g[i] == 0.);
+}
+
+template <size_t N>
+void check_complex()
+{
+    typedef std::complex<double> C;
+    typedef vec<N,C> V;
+    V a, b;
+    for (size_t i = 0; i < N; ++i) {
+        a[i] = C(1. + i, -0.5 * i);
+        b[i] = C(0.3, 2. - i);
+    }
+    C ab = 0;
+    double aa = 0;
+    for (size_t i = 0; i < N; ++i) {
+        ab += std::conj(a[i]) * b[i];
+        aa += a[i].real() * a[i].real() + a[i].imag() * a[i].imag();
+    }
+    assert(a * b == ab);
+    assert((vec_sum<vec_cdot_term>(C(), a, b, vec_loop<N>()) == ab));
+    assert(a.norm2_sq() == aa);
+    assert((vec_sum<vec_norm2_term>(0., a, a, vec_loop<N>()) == aa));
+}
+
+// unrolled and looped versions give the same results in constant expressions
+constexpr vec<4,int> p = {3, -1, 4};
+constexpr vec<4,int> q = 2 * p + vec<4,int>(1);
+static_assert(q == vec<4,int>{7, -1, 9, 1}, "unrolled arithmetic");
+static_assert(p * q == 58, "unrolled dot product");
+static_assert(vec<5,int>{1, 2, 3, 4, 5}.norm2_sq() == 55, "looped norm");
+
+int main()
+{
+    check_real<1>();
+    check_real<2>();
+    check_real<3>();
+    check_real<4>();
+    check_real<5>();
+    check_real<9>();
+    check_complex<2>();
+    check_complex<3>();
+    check_complex<4>();
+    check_complex<6>();
+
+    // integer vectors
+    vec<3,int> i = {7, -8, 9};
+    i %= vec<3,int>{4, 3, 5};
+    assert((i == vec<3,int>{3, -2, 4}));
+    i %= 3;
+    assert((i == vec<3,int>{0, -2, 1}));
+
+    // the cross product is built from an unrolled initializer list
+    vec<3,double> x = {1., 0., 0.}, y = {0., 1., 0.};
+    assert((cross(x, y) == vec<3,double>{0., 0., 1.}));
+    return 0;
+}
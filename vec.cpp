@@ -36,7 +36,7 @@ int main(int argc, char *argv[])
     cout << "cross product: a x b = " << cross(a, b) << endl;
 
     // linear operations are overloaded, naturally
-    auto d = a - b;
+    vec<3> d = a - b;
     d /= 2;
     cout << "d = " << d << endl;
 
@@ -18,185 +18,598 @@
 #include <iostream>
 #include <initializer_list>
 #include <type_traits>
+#include <utility>
 #include <complex>
 #include <cmath>
+#include <limits>
 
 namespace Vec {
     template<typename S> struct is_complex : std::false_type {};
     template<typename S> struct is_complex<std::complex<S>> : std::true_type {};
 
+    template <size_t N, typename T> class vec;
+
+    // floating point remainder as by std::fmod, which cannot be used in
+    // constant expressions; at runtime, std::fmod is called where possible
+    template <typename T>
+    constexpr T vec_fmod_exact(T x, T y)
+    {
+        T r = x < 0 ? -x : x;
+        const T m = y < 0 ? -y : y;
+        if (!(m > 0) || !(r - r == 0))
+            return std::fmod(x, y); // zero divisor, inf or NaN
+        // subtracting the largest y * 2^k <= r is exact (Sterbenz lemma)
+        while (r >= m) {
+            T d = m;
+            while (d <= r - d)
+                d += d;
+            r -= d;
+        }
+        return x < 0 ? -r : (x == 0 ? x : r);
+    }
+
+    template <typename T>
+    constexpr T vec_fmod(T x, T y)
+    {
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+        if (!__builtin_is_constant_evaluated())
+            return std::fmod(x, y);
+#endif
+#endif
+        return vec_fmod_exact(x, y);
+    }
+
+    // scalar type of norms: the underlying real type, or double for integers
+    template <typename T, typename = void>
+    struct norm_type {
+	typedef double type;
+    };
+
+    template <typename T>
+    struct norm_type<T, typename std::enable_if<
+                            std::is_floating_point<T>::value>::type> {
+	typedef T type;
+    };
+
+    template <typename S>
+    struct norm_type<std::complex<S>> {
+	typedef typename norm_type<S>::type type;
+    };
+
+    // magnitude of a single component and its square, in the norm type
+    template <typename T, typename R = typename norm_type<T>::type>
+    R vec_abs_sq(const T& x)
+    {
+        return R(x) * R(x);
+    }
+
+    template <typename S, typename R = typename norm_type<S>::type>
+    R vec_abs_sq(const std::complex<S>& x)
+    {
+        return R(x.real()) * R(x.real()) + R(x.imag()) * R(x.imag());
+    }
+
+    template <typename T, typename R = typename norm_type<T>::type>
+    R vec_abs(const T& x)
+    {
+        return std::abs(R(x));
+    }
+
+    // unlike std::abs, this is not safe from overflow, but vectorizes
+    template <typename S, typename R = typename norm_type<S>::type>
+    R vec_abs(const std::complex<S>& x)
+    {
+        return std::sqrt(vec_abs_sq(x));
+    }
+
+    // an overflow-safe bound within a factor of sqrt(2) of the magnitude
+    template <typename T, typename R = typename norm_type<T>::type>
+    R vec_abs_max(const T& x)
+    {
+        return std::abs(R(x));
+    }
+
+    template <typename S, typename R = typename norm_type<S>::type>
+    R vec_abs_max(const std::complex<S>& x)
+    {
+        R re = std::abs(R(x.real())), im = std::abs(R(x.imag()));
+        return re < im ? im : re;
+    }
+
+    // x^p by repeated squaring
+    template <typename R>
+    constexpr R vec_ipow(R x, unsigned p)
+    {
+        R res = 1;
+        for (; p; p >>= 1, x *= x)
+            if (p & 1)
+                res *= x;
+        return res;
+    }
+
+    // inverse of the above
+    template <typename R>
+    R vec_iroot(R x, unsigned p)
+    {
+        return p == 1 ? x : (p == 2 ? std::sqrt(x) : std::pow(x, R(1) / p));
+    }
+
+    // a * b + c with a single rounding where the hardware supports it (as
+    // indicated by FP_FAST_FMA etc., e.g. when compiling with -mfma);
+    // otherwise, and for integers, as written
+    template <typename A, typename B, typename C>
+    constexpr auto vec_fma(const A& a, const B& b, const C& c) -> decltype(a * b + c)
+    {
+        return a * b + c;
+    }
+
+    inline float vec_fma(float a, float b, float c)
+    {
+#ifdef FP_FAST_FMAF
+        return std::fma(a, b, c);
+#else
+        return a * b + c;
+#endif
+    }
+
+    inline double vec_fma(double a, double b, double c)
+    {
+#ifdef FP_FAST_FMA
+        return std::fma(a, b, c);
+#else
+        return a * b + c;
+#endif
+    }
+
+    inline long double vec_fma(long double a, long double b, long double c)
+    {
+#ifdef FP_FAST_FMAL
+        return std::fma(a, b, c);
+#else
+        return a * b + c;
+#endif
+    }
+
+    template <typename S>
+    std::complex<S> vec_fma(const std::complex<S>& a, const std::complex<S>& b,
+                            const std::complex<S>& c)
+    {
+        return {vec_fma(a.real(), b.real(), vec_fma(-a.imag(), b.imag(), c.real())),
+                vec_fma(a.real(), b.imag(), vec_fma(a.imag(), b.real(), c.imag()))};
+    }
+
+    // a real coefficient scales real and imaginary parts alike
+    template <typename S>
+    std::complex<S> vec_fma(const S& a, const std::complex<S>& b,
+                            const std::complex<S>& c)
+    {
+        return {vec_fma(a, b.real(), c.real()), vec_fma(a, b.imag(), c.imag())};
+    }
+
+    // type to which a scalar coefficient S of vectors of T is converted: T,
+    // except for real coefficients of complex vectors, which remain real
+    template <typename T, typename S>
+    struct fma_coeff {
+	typedef T type;
+    };
+
+    template <typename S, typename R>
+    struct fma_coeff<std::complex<S>, R> {
+	typedef typename std::conditional<is_complex<R>::value,
+					  std::complex<S>, S>::type type;
+    };
+
+
+    // compile-time unrolling
+    //
+    // The component loops of vectors with up to VEC_UNROLL_MAX components are
+    // expanded over a std::index_sequence rather than left to the optimizer,
+    // which does not unroll them at -O2. Longer vectors select the plain loops
+    // through the vec_loop<N> tag. Both visit the components in the same
+    // order and thus give identical results.
+#ifndef VEC_UNROLL_MAX
+#define VEC_UNROLL_MAX 4
+#endif
+    const size_t vec_unroll_max = VEC_UNROLL_MAX;
+
+    template <size_t N> struct vec_loop {};
+
+    template <size_t N>
+    using vec_indices = typename std::conditional<(N <= vec_unroll_max),
+                                                  std::make_index_sequence<N>,
+                                                  vec_loop<N>>::type;
+
+    // sum + Term::apply(l[0], r[0]) + ... + Term::apply(l[N-1], r[N-1]),
+    // accumulated from left to right
+    template <typename Term, typename S, typename E1, typename E2>
+    constexpr S vec_sum(S sum, const E1&, const E2&, std::index_sequence<>)
+    {
+        return sum;
+    }
+
+    template <typename Term, typename S, typename E1, typename E2, size_t I,
+              size_t... Is>
+    constexpr S vec_sum(S sum, const E1& l, const E2& r,
+                        std::index_sequence<I, Is...>)
+    {
+        return vec_sum<Term>(S(sum + Term::apply(l[I], r[I])), l, r,
+                             std::index_sequence<Is...>());
+    }
+
+    template <typename Term, typename S, typename E1, typename E2, size_t N>
+    constexpr S vec_sum(S sum, const E1& l, const E2& r, vec_loop<N>)
+    {
+        for (size_t i = 0; i < N; ++i)
+            sum += Term::apply(l[i], r[i]);
+        return sum;
+    }
+
+    struct vec_dot_term {
+	template <typename A, typename B>
+	static constexpr auto apply(const A& a, const B& b) -> decltype(a * b)
+	{
+	    return a * b;
+	}
+    };
+
+    struct vec_cdot_term {
+	template <typename A, typename B>
+	static constexpr auto apply(const A& a, const B& b)
+	    -> decltype(std::conj(a) * b)
+	{
+	    return std::conj(a) * b;
+	}
+    };
+
+    // re^2 + im^2 of a complex component, ignoring the second argument
+    struct vec_norm2_term {
+	template <typename A>
+	static constexpr auto apply(const A& a, const A&)
+	    -> decltype(a.real() * a.real())
+	{
+	    return a.real() * a.real() + a.imag() * a.imag();
+	}
+    };
+
+
+    // component operations, used both by the expression nodes and by the
+    // compound assignment operators
+    struct vec_negate {
+	template <typename T>
+	static constexpr T apply(const T& a) { return -a; }
+    };
+
+    struct vec_assign {
+	template <typename T>
+	static constexpr T apply(const T&, const T& b) { return b; }
+    };
+
+    struct vec_plus {
+	template <typename T>
+	static constexpr T apply(const T& a, const T& b) { return a + b; }
+    };
+
+    struct vec_minus {
+	template <typename T>
+	static constexpr T apply(const T& a, const T& b) { return a - b; }
+    };
+
+    struct vec_multiplies {
+	template <typename T>
+	static constexpr T apply(const T& a, const T& b) { return a * b; }
+    };
+
+    struct vec_divides {
+	template <typename T>
+	static constexpr T apply(const T& a, const T& b) { return a / b; }
+    };
+
+    struct vec_modulus {
+	template <typename T>
+	static constexpr
+	typename std::enable_if<std::is_integral<T>::value, T>::type
+	apply(const T& a, const T& b) { return a % b; }
+
+	template <typename T>
+	static constexpr
+	typename std::enable_if<std::is_floating_point<T>::value, T>::type
+	apply(const T& a, const T& b) { return vec_fmod(a, b); }
+    };
+
+
+    // expression templates
+    //
+    // The arithmetic operators do not compute their result right away but
+    // return lightweight expression nodes referring to their operands. A
+    // chain like `a + 2.*b - c/3.` is thus evaluated in a single fused loop
+    // once it is assigned to a vec, without any intermediate vectors. Since
+    // the nodes store references to vec operands, they must not outlive the
+    // full expression; spell out the vec type instead of using `auto` when
+    // storing a result.
+    template <typename E, size_t N, typename T>
+    struct vec_expr {
+	typedef T value_type;
+
+	constexpr const E& self() const
+	{
+	    return static_cast<const E&>(*this);
+	}
+
+	constexpr T operator[](size_t i) const
+	{
+	    return self()[i];
+	}
+    };
+
+    template <typename E, size_t N, typename T>
+    std::true_type is_vec_expr_impl(const vec_expr<E,N,T>*);
+    std::false_type is_vec_expr_impl(...);
+
+    template <typename S>
+    struct is_vec_expr
+        : decltype(is_vec_expr_impl(
+                       std::declval<typename std::decay<S>::type*>())) {};
+
+    // vec operands are captured by reference, everything else by value
+    template <typename E> struct vec_expr_ref { typedef const E type; };
+    template <size_t N, typename T>
+    struct vec_expr_ref<vec<N,T>> {
+	typedef const vec<N,T>& type;
+    };
+
+
+    template <size_t N, typename S> class vec_scalar;
+
+
     // definition
     template <size_t N, typename T = double>
-    class vec {
+    class vec : public vec_expr<vec<N,T>, N, T> {
 	static_assert(N > 0, "vec may not be zero-dimensional");
     private:
 	T data[N];
-    public:
-	// assignment operator
-	template <typename T2,
-		    typename = typename std::enable_if<
-			std::is_convertible<T2, T>::value, T2>::type>
-	vec& operator=(const vec<N, T2>& x)
+
+	// data[i] = Op::apply(data[i], e[i]) for all components
+	template <typename Op, typename E, size_t... I>
+	constexpr void apply(const E& e, std::index_sequence<I...>)
+	{
+	    int expand[] = {(data[I] = Op::apply(data[I], T(e[I])), 0)...};
+	    (void) expand;
+	}
+
+	template <typename Op, typename E>
+	constexpr void apply(const E& e, vec_loop<N>)
 	{
 	    for (size_t i = 0; i < N; ++i)
-		data[i] = x[i];
-	    return *this;
+		data[i] = Op::apply(data[i], T(e[i]));
 	}
 
+	// unrolled constructors initialize the components directly
+	template <size_t... I>
+	constexpr vec(const T& val, std::index_sequence<I...>)
+	    : data{(void(I), val)...} {}
 
-	// constructors
-	vec() : data{} {}
+	template <size_t... I>
+	constexpr vec(const T* p, std::index_sequence<I...>) : data{p[I]...} {}
 
-	vec(const T& val)
+	template <typename E, typename T2, size_t... I>
+	constexpr vec(const vec_expr<E, N, T2>& x, std::index_sequence<I...>)
+	    : data{T(x.self()[I])...} {}
+
+	template <size_t... I>
+	constexpr vec(std::initializer_list<T> il, std::index_sequence<I...>)
+	    : data{(I < il.size() ? il.begin()[I] : T())...} {}
+
+	constexpr vec(const T& val, vec_loop<N>) : data{}
 	{
 	    for (size_t i = 0; i < N; ++i)
 		data[i] = val;
 	}
 
-	vec(const T* p)
+	constexpr vec(const T* p, vec_loop<N>) : data{}
 	{
 	    for (size_t i = 0; i < N; ++i)
 		data[i] = p[i];
 	}
 
-	template <typename T2,
-		    typename = typename std::enable_if<
-			std::is_convertible<T2, T>::value, T2>::type>
-	vec(const vec<N, T2>& x)
+	template <typename E, typename T2>
+	constexpr vec(const vec_expr<E, N, T2>& x, vec_loop<N>) : data{}
 	{
 	    *this = x;
 	}
 
-	vec(std::initializer_list<T> il)
+	constexpr vec(std::initializer_list<T> il, vec_loop<N>) : data{}
 	{
-	    size_t i;
-	    const T* it;
-	    for (i = 0, it = il.begin(); it != il.end() && i < N; ++i, ++it)
+	    size_t i = 0;
+	    const T* it = il.begin();
+	    for (; it != il.end() && i < N; ++i, ++it)
 		data[i] = *it;
 	    for (; i < N; ++i)
 		data[i] = T();
 	}
+    public:
+	// assignment operator
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	constexpr vec& operator=(const vec_expr<E, N, T2>& x)
+	{
+	    apply<vec_assign>(x.self(), vec_indices<N>());
+	    return *this;
+	}
+
+
+	// constructors
+	constexpr vec() : data{} {}
+
+	constexpr vec(const T& val) : vec(val, vec_indices<N>()) {}
+
+	constexpr vec(const T* p) : vec(p, vec_indices<N>()) {}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	constexpr vec(const vec_expr<E, N, T2>& x) : vec(x, vec_indices<N>()) {}
+
+	constexpr vec(std::initializer_list<T> il) : vec(il, vec_indices<N>()) {}
 
 
 	// operators
-	inline const T& operator[](size_t i) const
+	constexpr const T& operator[](size_t i) const
 	{
 	    return data[i];
 	}
 
-	inline T& operator[](size_t i)
+	constexpr T& operator[](size_t i)
 	{
 	    return data[i];
 	}
 
-	// unary sign operators
-	vec operator+() const
+	// unary sign operator
+	constexpr vec operator+() const
 	{
 	    return vec(*this);
 	}
 
-	vec operator-() const
-	{
-	    vec res;
-	    for (size_t i = 0; i < N; ++i)
-		res.data[i] = -data[i];
-	    return res;
-	}
-
+	// remainder as by % for integers and by fmod for floating point
 	template <typename..., typename S = T>
-	typename std::enable_if<std::is_integral<S>::value, vec&>::type
+	constexpr typename std::enable_if<std::is_arithmetic<S>::value, vec&>::type
 	operator%= (const vec& rhs)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] %= rhs.data[i];
+	    apply<vec_modulus>(rhs, vec_indices<N>());
+	    return *this;
 	}
 
-	template <typename..., typename S = T>
-	typename std::enable_if<std::is_floating_point<S>::value,vec&>::type
-	operator%= (const vec& rhs)
+	constexpr vec& operator+= (const vec& rhs)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] = std::fmod(data[i], rhs.data[i]);
+	    apply<vec_plus>(rhs, vec_indices<N>());
+	    return *this;
 	}
 
-	vec& operator+= (const vec& rhs)
+	constexpr vec& operator-= (const vec& rhs)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] += rhs.data[i];
+	    apply<vec_minus>(rhs, vec_indices<N>());
 	    return *this;
 	}
 
-	vec& operator-= (const vec& rhs)
+	// compound assignment from an expression evaluates it in the same
+	// loop, e.g. `x += dt * v` does not materialize `dt * v`
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	constexpr vec& operator+= (const vec_expr<E, N, T2>& rhs)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] -= rhs.data[i];
+	    apply<vec_plus>(rhs.self(), vec_indices<N>());
 	    return *this;
 	}
 
-	template <typename..., typename S = T>
-	typename std::enable_if<std::is_integral<S>::value, vec&>::type
-	operator%= (const T& val)
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	constexpr vec& operator-= (const vec_expr<E, N, T2>& rhs)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] %= val;
+	    apply<vec_minus>(rhs.self(), vec_indices<N>());
+	    return *this;
 	}
 
 	template <typename..., typename S = T>
-	typename std::enable_if<std::is_floating_point<S>::value,vec&>::type
+	constexpr typename std::enable_if<std::is_arithmetic<S>::value, vec&>::type
 	operator%= (const T& val)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] = std::fmod(data[i], val);
+	    apply<vec_modulus>(vec_scalar<N,T>(val), vec_indices<N>());
+	    return *this;
 	}
 
-	vec& operator*= (const T& val)
+	constexpr vec& operator*= (const T& val)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] *= val;
+	    apply<vec_multiplies>(vec_scalar<N,T>(val), vec_indices<N>());
 	    return *this;
 	}
 
-	vec& operator/= (const T& val)
+	constexpr vec& operator/= (const T& val)
 	{
-	    for (size_t i = 0; i < N; ++i)
-		data[i] /= val;
+	    apply<vec_divides>(vec_scalar<N,T>(val), vec_indices<N>());
 	    return *this;
 	}
 
-	// friends
-	template <size_t N_, typename A, typename B>
-	friend bool operator== (const vec<N_,A>&, const vec<N_,B>&);
-
-	template <size_t N_, typename A, typename B, typename C>
-	friend typename std::enable_if<std::is_arithmetic<A>::value,C>::type
-	operator* (const vec<N_,A>&, const vec<N_,B>&);
-
-	template <size_t N_, typename A, typename B, typename C>
-	friend typename std::enable_if<is_complex<A>::value,C>::type
-	operator* (const vec<N_,A>&, const vec<N_,B>&);
-
 	// norm
 	template <typename..., typename S = T>
-	typename std::enable_if<std::is_arithmetic<S>::value, S>::type
+	constexpr typename std::enable_if<std::is_arithmetic<S>::value, S>::type
 	norm2_sq() const
 	{
 	    return (*this) * (*this);
 	}
 
 	template <typename..., typename S = T>
-	typename std::enable_if<is_complex<S>::value,
-				typename S::value_type>::type
+	constexpr typename std::enable_if<is_complex<S>::value,
+					  typename S::value_type>::type
 	norm2_sq() const
 	{
-	    return ((*this) * (*this)).real();
+	    // only accumulate re^2 + im^2 rather than the full complex product
+	    return vec_sum<vec_norm2_term>(typename S::value_type(), data, data,
+					   vec_indices<N>());
 	}
 
-	double norm(double p = 2) const
+	// p-norm; p = 1, 2, infinity and other integers take the specialized
+	// paths below, only fractional p resort to std::pow per element
+	typename norm_type<T>::type norm(double p = 2) const
 	{
-	    double sum;
+	    typedef typename norm_type<T>::type R;
+	    if (p == 2)
+		return norm<2>();
+	    if (p == 1)
+		return norm<1>();
+	    if (p == std::numeric_limits<double>::infinity())
+		return norm_inf();
+	    if (p > 0 && p <= 64 && p == unsigned(p))
+		return norm_int(unsigned(p));
+	    R sum = 0;
 	    for (size_t i = 0; i < N; ++i)
-		sum += pow(abs(data[i]), p);
-	    return pow(sum, 1./p);
+		sum += std::pow(vec_abs(data[i]), R(p));
+	    return std::pow(sum, R(1 / p));
+	}
+
+	// p-norm for integer p known at compile time
+	template <unsigned P>
+	typename norm_type<T>::type norm() const
+	{
+	    static_assert(P > 0, "p-norm requires p >= 1");
+	    return norm_int(P);
+	}
+
+	// maximum norm
+	typename norm_type<T>::type norm_inf() const
+	{
+	    typename norm_type<T>::type res = 0;
+	    for (size_t i = 0; i < N; ++i) {
+		auto a = vec_abs(data[i]);
+		if (a > res || a != a)
+		    res = a;
+	    }
+	    return res;
+	}
+
+	// p-norm which, like std::hypot, neither overflows nor underflows for
+	// intermediate results by scaling with the largest component; slower
+	template <unsigned P = 2>
+	typename norm_type<T>::type norm_scaled() const
+	{
+	    static_assert(P > 0, "p-norm requires p >= 1");
+	    typedef typename norm_type<T>::type R;
+	    R scale = 0;
+	    for (size_t i = 0; i < N; ++i) {
+		R a = vec_abs_max(data[i]);
+		if (a > scale || a != a)
+		    scale = a;
+	    }
+	    if (!(scale > 0) || scale == std::numeric_limits<R>::infinity())
+		return scale; // zero, inf or NaN
+	    R sum = 0;
+	    for (size_t i = 0; i < N; ++i) {
+		auto x = decltype(R() * T())(data[i]) / scale;
+		sum += P == 2 ? vec_abs_sq(x) : vec_ipow(vec_abs(x), P);
+	    }
+	    return scale * vec_iroot(sum, P);
 	}
 
 	template <typename..., typename S = T>
@@ -206,44 +619,105 @@ namespace Vec {
 	    for (size_t i = 0; i < N; ++i)
 		data[i] = std::conj(data[i]);
 	}
+
+    private:
+	typename norm_type<T>::type norm_int(unsigned p) const
+	{
+	    typename norm_type<T>::type sum = 0;
+	    if (p == 2) {
+		for (size_t i = 0; i < N; ++i)
+		    sum += vec_abs_sq(data[i]);
+	    } else {
+		for (size_t i = 0; i < N; ++i)
+		    sum += vec_ipow(vec_abs(data[i]), p);
+	    }
+	    return vec_iroot(sum, p);
+	}
+    };
+
+
+    // expression nodes
+    template <size_t N, typename S>
+    class vec_scalar : public vec_expr<vec_scalar<N,S>, N, S> {
+    private:
+	S val;
+    public:
+	constexpr vec_scalar(const S& v) : val(v) {}
+
+	constexpr const S& operator[](size_t) const
+	{
+	    return val;
+	}
+    };
+
+    template <typename Op, typename E, size_t N, typename T>
+    class vec_unary : public vec_expr<vec_unary<Op,E,N,T>, N, T> {
+    private:
+	typename vec_expr_ref<E>::type arg;
+    public:
+	constexpr vec_unary(const E& a) : arg(a) {}
+
+	constexpr T operator[](size_t i) const
+	{
+	    return Op::apply(static_cast<T>(arg[i]));
+	}
+    };
+
+    template <typename Op, typename L, typename R, size_t N, typename T>
+    class vec_binary : public vec_expr<vec_binary<Op,L,R,N,T>, N, T> {
+    private:
+	typename vec_expr_ref<L>::type lhs;
+	typename vec_expr_ref<R>::type rhs;
+    public:
+	constexpr vec_binary(const L& l, const R& r) : lhs(l), rhs(r) {}
+
+	constexpr T operator[](size_t i) const
+	{
+	    return Op::apply(static_cast<T>(lhs[i]), static_cast<T>(rhs[i]));
+	}
     };
 
     // dot product
-    template <size_t N, typename A, typename B, typename C = decltype(A()*B())>
-    typename std::enable_if<std::is_arithmetic<A>::value, C>::type
-    operator*(const vec<N,A>& lhs, const vec<N,B>& rhs)
+    template <typename E1, typename E2, size_t N, typename A, typename B,
+              typename C = decltype(A()*B())>
+    constexpr typename std::enable_if<std::is_arithmetic<A>::value, C>::type
+    operator*(const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
     {
-        C sum;
-        for (size_t i = 0; i < N; ++i)
-            sum += lhs.data[i] * rhs.data[i];
-        return sum;
+        return vec_sum<vec_dot_term>(C(), lhs.self(), rhs.self(),
+                                     vec_indices<N>());
     }
 
-    template <size_t N, typename A, typename B, typename C = decltype(A()*B())>
-    typename std::enable_if<is_complex<A>::value, C>::type
-    operator*(const vec<N,A>& lhs, const vec<N,B>& rhs)
+    template <typename E1, typename E2, size_t N, typename A, typename B,
+              typename C = decltype(A()*B())>
+    constexpr typename std::enable_if<is_complex<A>::value, C>::type
+    operator*(const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
     {
-        C sum;
-        for (size_t i = 0; i < N; ++i)
-            sum += conj(lhs.data[i]) * rhs.data[i];
-        return sum;
+        return vec_sum<vec_cdot_term>(C(), lhs.self(), rhs.self(),
+                                      vec_indices<N>());
     }
 
 
     // cross product
-    template <typename A, typename B, typename C = decltype(A()*B())>
+    template <typename E1, typename E2, typename A, typename B,
+              typename C = decltype(A()*B())>
+    constexpr
     typename std::enable_if<std::is_arithmetic<A>::value, vec<3,C>>::type
-    cross(const vec<3,A>& lhs, const vec<3,B>& rhs)
+    cross(const vec_expr<E1,3,A>& l, const vec_expr<E2,3,B>& r)
     {
+        const E1& lhs = l.self();
+        const E2& rhs = r.self();
         return {lhs[1] * rhs[2] - lhs[2] * rhs[1],
                 lhs[2] * rhs[0] - lhs[0] * rhs[2],
                 lhs[0] * rhs[1] - lhs[1] * rhs[0]};
     }
 
-    template <typename A, typename B, typename C = decltype(A()*B())>
-    typename std::enable_if<is_complex<A>::value, vec<3,C>>::type
-    cross(const vec<3,A>& lhs, const vec<3,B>& rhs)
+    template <typename E1, typename E2, typename A, typename B,
+              typename C = decltype(A()*B())>
+    constexpr typename std::enable_if<is_complex<A>::value, vec<3,C>>::type
+    cross(const vec_expr<E1,3,A>& l, const vec_expr<E2,3,B>& r)
     {
+        const E1& lhs = l.self();
+        const E2& rhs = r.self();
         return {std::conj(lhs[1] * rhs[2] - lhs[2] * rhs[1]),
                 std::conj(lhs[2] * rhs[0] - lhs[0] * rhs[2]),
                 std::conj(lhs[0] * rhs[1] - lhs[1] * rhs[0])};
@@ -251,9 +725,9 @@ namespace Vec {
 
 
     // complex conjugation
-    template <size_t N, typename T>
+    template <typename E, size_t N, typename T>
     typename std::enable_if<is_complex<T>::value, vec<N,T>>::type
-    conj(const vec<N,T>& c)
+    conj(const vec_expr<E,N,T>& c)
     {
         vec<N,T> res(c);
         res.conj();
@@ -261,93 +735,250 @@ namespace Vec {
     }
 
 
+    // unary minus
+    template <typename E, size_t N, typename T>
+    constexpr vec_unary<vec_negate,E,N,T> operator- (const vec_expr<E,N,T>& rhs)
+    {
+        return vec_unary<vec_negate,E,N,T>(rhs.self());
+    }
+
+
     // scalar multiplication
-    template <size_t N, typename T, typename S, typename C = decltype(S()*T())>
-    vec<N,C> operator* (const S& val, const vec<N,T>& rhs)
+    template <typename E, size_t N, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type,
+              typename C = decltype(S()*T())>
+    constexpr vec_binary<vec_multiplies,E,vec_scalar<N,S>,N,C>
+    operator* (const S& val, const vec_expr<E,N,T>& rhs)
     {
-        vec<N,C> res(rhs);
-        res *= val;
-        return res;
+        return vec_binary<vec_multiplies,E,vec_scalar<N,S>,N,C>(rhs.self(),
+                                                                val);
     }
 
-    template <size_t N, typename T, typename S, typename C = decltype(S()*T())>
-    vec<N,C> operator* (const vec<N,T>& lhs, const S& val)
+    template <typename E, size_t N, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type,
+              typename C = decltype(S()*T())>
+    constexpr vec_binary<vec_multiplies,E,vec_scalar<N,S>,N,C>
+    operator* (const vec_expr<E,N,T>& lhs, const S& val)
     {
-        vec<N,C> res(lhs);
-        res *= val;
-        return res;
+        return vec_binary<vec_multiplies,E,vec_scalar<N,S>,N,C>(lhs.self(),
+                                                                val);
     }
 
-    template <size_t N, typename T, typename S, typename C = decltype(S()*T())>
-    vec<N,C> operator/ (const vec<N,T>& lhs, const S& val)
+    template <typename E, size_t N, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type,
+              typename C = decltype(S()*T())>
+    constexpr vec_binary<vec_divides,E,vec_scalar<N,S>,N,C>
+    operator/ (const vec_expr<E,N,T>& lhs, const S& val)
     {
-        vec<N,C> res(lhs);
-        res /= val;
-        return res;
+        return vec_binary<vec_divides,E,vec_scalar<N,S>,N,C>(lhs.self(), val);
     }
 
 
     // modulo operator
-    template <size_t N, typename T>
-    vec<N,T> operator% (const vec<N,T>& lhs, const vec<N,T>& rhs)
+    template <typename E1, typename E2, size_t N, typename T>
+    constexpr vec_binary<vec_modulus,E1,E2,N,T>
+    operator% (const vec_expr<E1,N,T>& lhs, const vec_expr<E2,N,T>& rhs)
     {
-        vec<N,T> res(lhs);
-        res %= rhs;
-        return res;
+        return vec_binary<vec_modulus,E1,E2,N,T>(lhs.self(), rhs.self());
     }
 
-    template <size_t N, typename T>
-    vec<N,T> operator% (const vec<N,T>& lhs, const T& val)
+    template <typename E, size_t N, typename T>
+    constexpr vec_binary<vec_modulus,E,vec_scalar<N,T>,N,T>
+    operator% (const vec_expr<E,N,T>& lhs, const T& val)
     {
-        vec<N,T> res(lhs);
-        res %= val;
-        return res;
+        return vec_binary<vec_modulus,E,vec_scalar<N,T>,N,T>(lhs.self(), val);
     }
 
 
     // addition & subtraction operators
-    template <size_t N, typename A, typename B, typename C = decltype(A()+B())>
-    vec<N,C> operator+ (const vec<N,A>& lhs, const vec<N,B>& rhs)
+    template <typename E1, typename E2, size_t N, typename A, typename B,
+              typename C = decltype(A()+B())>
+    constexpr vec_binary<vec_plus,E1,E2,N,C>
+    operator+ (const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
     {
-        vec<N,C> res(lhs);
-        res += rhs;
+        return vec_binary<vec_plus,E1,E2,N,C>(lhs.self(), rhs.self());
+    }
+
+    template <typename E1, typename E2, size_t N, typename A, typename B,
+              typename C = decltype(A()-B())>
+    constexpr vec_binary<vec_minus,E1,E2,N,C>
+    operator- (const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
+    {
+        return vec_binary<vec_minus,E1,E2,N,C>(lhs.self(), rhs.self());
+    }
+
+
+    // Fused multiply-add operations, evaluated in a single pass using
+    // vec_fma for each component. With hardware FMA, results may thus differ
+    // in the last bit from the equivalent operator expressions.
+
+    // y += alpha * x
+    template <typename S, typename E, size_t N, typename T2, typename T,
+              typename A = typename fma_coeff<T,S>::type>
+    void axpy(const S& alpha, const vec_expr<E,N,T2>& x, vec<N,T>& y)
+    {
+        const E& xs = x.self();
+        const A a(alpha);
+        for (size_t i = 0; i < N; ++i)
+            y[i] = vec_fma(a, T(xs[i]), y[i]);
+    }
+
+    // y = alpha * x + beta * y
+    template <typename S, typename E, size_t N, typename T2, typename T,
+              typename A = typename fma_coeff<T,S>::type>
+    void axpby(const S& alpha, const vec_expr<E,N,T2>& x, const S& beta,
+               vec<N,T>& y)
+    {
+        const E& xs = x.self();
+        const A a(alpha), b(beta);
+        for (size_t i = 0; i < N; ++i)
+            y[i] = vec_fma(a, T(xs[i]), T(b * y[i]));
+    }
+
+    // z = alpha * x + beta * y + gamma * z, e.g. the position update of a
+    // velocity Verlet step, x += dt * v + dt^2/2 * a, in one pass
+    template <typename S, typename E1, typename E2, size_t N, typename T1,
+              typename T2, typename T,
+              typename A = typename fma_coeff<T,S>::type>
+    void update(const S& alpha, const vec_expr<E1,N,T1>& x, const S& beta,
+                const vec_expr<E2,N,T2>& y, const S& gamma, vec<N,T>& z)
+    {
+        const E1& xs = x.self();
+        const E2& ys = y.self();
+        const A a(alpha), b(beta), g(gamma);
+        for (size_t i = 0; i < N; ++i)
+            z[i] = vec_fma(a, T(xs[i]), vec_fma(b, T(ys[i]), T(g * z[i])));
+    }
+
+    // a * b + c component-wise, with a vector or a scalar a
+    template <typename E1, typename E2, typename E3, size_t N, typename T>
+    vec<N,T> fma(const vec_expr<E1,N,T>& a, const vec_expr<E2,N,T>& b,
+                 const vec_expr<E3,N,T>& c)
+    {
+        const E1& as = a.self();
+        const E2& bs = b.self();
+        const E3& cs = c.self();
+        vec<N,T> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = vec_fma(as[i], bs[i], cs[i]);
+        return res;
+    }
+
+    template <typename S, typename E2, typename E3, size_t N, typename T,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type,
+              typename A = typename fma_coeff<T,S>::type>
+    vec<N,T> fma(const S& a, const vec_expr<E2,N,T>& b,
+                 const vec_expr<E3,N,T>& c)
+    {
+        const E2& bs = b.self();
+        const E3& cs = c.self();
+        const A as(a);
+        vec<N,T> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = vec_fma(as, bs[i], cs[i]);
         return res;
     }
 
-    template <size_t N, typename A, typename B, typename C = decltype(A()-B())>
-    vec<N,C> operator- (const vec<N,A>& lhs, const vec<N,B>& rhs)
+    // linear interpolation (1 - t) a + t b, exact at t = 0 and t = 1
+    template <typename E1, typename E2, size_t N, typename T, typename S,
+              typename A = typename fma_coeff<T,S>::type>
+    vec<N,T> lerp(const vec_expr<E1,N,T>& a, const vec_expr<E2,N,T>& b,
+                  const S& t)
     {
-        vec<N,C> res(lhs);
-        res -= rhs;
+        const E1& as = a.self();
+        const E2& bs = b.self();
+        const A ts(t);
+        vec<N,T> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = vec_fma(ts, bs[i], vec_fma(A(-ts), as[i], as[i]));
         return res;
     }
 
 
     // (in)equality operators
-    template <size_t N, typename A, typename B>
-    bool operator== (const vec<N,A>& lhs, const vec<N,B>& rhs)
+    //
+    // Components are compared in blocks without branching, so that the
+    // comparisons within a block vectorize; mismatches exit between blocks.
+    // Unrolled vectors are compared as a single block.
+    const size_t vec_compare_block = 8;
+
+    template <typename E1, typename E2>
+    constexpr bool vec_equal(const E1&, const E2&, std::index_sequence<>)
     {
-        for (size_t i = 0; i < N; ++i)
-            if (lhs.data[i] != rhs.data[i])
+        return true;
+    }
+
+    template <typename E1, typename E2, size_t I, size_t... Is>
+    constexpr bool vec_equal(const E1& l, const E2& r,
+                             std::index_sequence<I, Is...>)
+    {
+        return (l[I] == r[I]) & vec_equal(l, r, std::index_sequence<Is...>());
+    }
+
+    template <typename E1, typename E2, size_t N>
+    constexpr bool vec_equal(const E1& l, const E2& r, vec_loop<N>)
+    {
+        for (size_t b = 0; b < N; b += vec_compare_block) {
+            const size_t e = N - b < vec_compare_block ? N : b + vec_compare_block;
+            bool eq = true;
+            for (size_t i = b; i < e; ++i)
+                eq &= l[i] == r[i];
+            if (!eq)
                 return false;
+        }
         return true;
     }
 
-    template <size_t N, typename A, typename B>
-    bool operator!= (const vec<N,A>& lhs, const vec<N,B>& rhs)
+    template <typename E1, typename E2, size_t N, typename A, typename B>
+    constexpr bool operator== (const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
+    {
+        return vec_equal(lhs.self(), rhs.self(), vec_indices<N>());
+    }
+
+    template <typename E1, typename E2, size_t N, typename A, typename B>
+    constexpr bool operator!= (const vec_expr<E1,N,A>& lhs, const vec_expr<E2,N,B>& rhs)
     {
         return !(lhs == rhs);
     }
 
 
     // stream operators
-    template <size_t N, typename T>
-    std::ostream& operator<< (std::ostream& os, const vec<N,T>& rhs)
+    template <typename E, size_t N, typename T>
+    std::ostream& operator<< (std::ostream& os, const vec_expr<E,N,T>& rhs)
     {
-        os << "(" << rhs[0];
+        const E& r = rhs.self();
+        os << "(" << r[0];
         for (size_t i = 1; i < N; ++i)
-            os << ", " << rhs[i];
+            os << ", " << r[i];
         os << ")";
         return os;
     }
+
+    // reads the format written by operator<<, i.e. "(a, b, c)", or N plain
+    // whitespace-separated components; sets failbit on malformed input
+    template <size_t N, typename T>
+    std::istream& operator>> (std::istream& is, vec<N,T>& rhs)
+    {
+        vec<N,T> res;
+        char c;
+        if (!(is >> c))
+            return is;
+        if (c != '(') {
+            is.putback(c);
+            for (size_t i = 0; i < N; ++i)
+                if (!(is >> res[i]))
+                    return is;
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                if (!(is >> res[i] >> c))
+                    return is;
+                if (c != (i + 1 < N ? ',' : ')')) {
+                    is.setstate(std::ios::failbit);
+                    return is;
+                }
+            }
+        }
+        rhs = res;
+        return is;
+    }
 }
@@ -0,0 +1,384 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+
+namespace Vec {
+    // compensated scalar accumulators; integers are summed exactly anyway
+    template <typename T, typename = void>
+    struct compensated {
+	T sum = T();
+
+	void add(const T& x)
+	{
+	    sum += x;
+	}
+
+	void merge(const compensated& o)
+	{
+	    sum += o.sum;
+	}
+
+	T value() const
+	{
+	    return sum;
+	}
+    };
+
+    template <typename T>
+    struct compensated<T, typename std::enable_if<
+                              std::is_floating_point<T>::value>::type> {
+	T sum = T();
+	T c = T();
+
+	void add(const T& x)
+	{
+	    T t = sum + x;
+	    if (std::abs(sum) >= std::abs(x))
+		c += (sum - t) + x;
+	    else
+		c += (x - t) + sum;
+	    sum = t;
+	}
+
+	void merge(const compensated& o)
+	{
+	    add(o.sum);
+	    c += o.c;
+	}
+
+	T value() const
+	{
+	    return sum + c;
+	}
+    };
+
+    template <typename T>
+    struct compensated<std::complex<T>> {
+	compensated<T> re, im;
+
+	void add(const std::complex<T>& x)
+	{
+	    re.add(x.real());
+	    im.add(x.imag());
+	}
+
+	void merge(const compensated& o)
+	{
+	    re.merge(o.re);
+	    im.merge(o.im);
+	}
+
+	std::complex<T> value() const
+	{
+	    return {re.value(), im.value()};
+	}
+    };
+
+    template <size_t N, typename T>
+    struct compensated<vec<N,T>> {
+	compensated<T> comp[N];
+
+	template <typename V>
+	void add(const V& x)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].add(x[i]);
+	}
+
+	void merge(const compensated& o)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].merge(o.comp[i]);
+	}
+
+	vec<N,T> value() const
+	{
+	    vec<N,T> res;
+	    for (size_t i = 0; i < N; ++i)
+		res[i] = comp[i].value();
+	    return res;
+	}
+    };
+
+
+    // Accumulation policies for dot products, squared norms and norms. The
+    // operators accumulate in the product type, i.e. in float for
+    // vec<N,float> and in int for vec<N,int>, which may lose precision or
+    // overflow. The functions dot, norm2_sq and norm below take a policy as
+    // their first template argument instead:
+    //
+    //     dot<accumulate_wide>(a, b)      float -> double, int32 -> int64
+    //     dot<accumulate_in<long double>>(a, b)
+    //     dot<accumulate_compensated>(a, b)
+    //
+    // Without it, they use accumulation<C>::type for the product type C,
+    // which may be specialized to select a policy per type:
+    //
+    //     template <> struct Vec::accumulation<float> {
+    //         typedef Vec::accumulate_wide type;
+    //     };
+    struct accumulate_plain {};         // in the product type, as operator*
+    struct accumulate_wide {};          // in wider<C>::type
+    template <typename Acc>
+    struct accumulate_in {};            // in Acc (or std::complex<Acc>)
+    struct accumulate_compensated {};   // compensated, in the product type
+
+    template <typename C>
+    struct accumulation {
+	typedef accumulate_plain type;
+    };
+
+    // wider type to accumulate in; integers widen to 64 bits
+    template <typename T, typename = void>
+    struct wider {
+	typedef T type;
+    };
+
+    template <>
+    struct wider<float> {
+	typedef double type;
+    };
+
+    template <typename T>
+    struct wider<T, typename std::enable_if<std::is_integral<T>::value &&
+					    (sizeof(T) < 8)>::type> {
+	typedef typename std::conditional<std::is_signed<T>::value,
+					  int64_t, uint64_t>::type type;
+    };
+
+    template <typename S>
+    struct wider<std::complex<S>> {
+	typedef std::complex<typename wider<S>::type> type;
+    };
+
+    // accumulator type and summation for a policy and product type C
+    template <typename Policy, typename C>
+    struct accumulator {
+	typedef C type;
+	type sum = type();
+
+	void add(const type& x)
+	{
+	    sum += x;
+	}
+
+	type value() const
+	{
+	    return sum;
+	}
+    };
+
+    template <typename C>
+    struct accumulator<accumulate_wide, C>
+	: accumulator<accumulate_plain, typename wider<C>::type> {};
+
+    template <typename Acc, typename C>
+    struct accumulator<accumulate_in<Acc>, C>
+	: accumulator<accumulate_plain,
+		      typename std::conditional<is_complex<C>::value,
+						std::complex<Acc>, Acc>::type> {};
+
+    template <typename C>
+    struct accumulator<accumulate_compensated, C> {
+	typedef C type;
+	compensated<C> sum;
+
+	void add(const type& x)
+	{
+	    sum.add(x);
+	}
+
+	type value() const
+	{
+	    return sum.value();
+	}
+    };
+
+    template <typename Policy, typename C>
+    using policy_or_default = typename std::conditional<
+        std::is_void<Policy>::value, typename accumulation<C>::type,
+        Policy>::type;
+
+    template <typename Policy, typename C>
+    using accumulator_for = accumulator<policy_or_default<Policy, C>, C>;
+
+    // terms evaluated in the accumulator type, so that e.g. products of
+    // int32 do not overflow before being widened
+    template <typename Acc, typename A, typename B>
+    typename std::enable_if<!is_complex<A>::value, Acc>::type
+    accumulate_dot_term(const A& a, const B& b)
+    {
+        return Acc(a) * Acc(b);
+    }
+
+    template <typename Acc, typename A, typename B>
+    typename std::enable_if<is_complex<A>::value, Acc>::type
+    accumulate_dot_term(const A& a, const B& b)
+    {
+        return std::conj(Acc(a)) * Acc(b);
+    }
+
+    template <typename Acc, typename T>
+    Acc accumulate_abs_sq(const T& x)
+    {
+        return Acc(x) * Acc(x);
+    }
+
+    template <typename Acc, typename S>
+    Acc accumulate_abs_sq(const std::complex<S>& x)
+    {
+        return Acc(x.real()) * Acc(x.real()) + Acc(x.imag()) * Acc(x.imag());
+    }
+
+
+    // dot product lhs * rhs
+    template <typename Policy = void, typename E1, typename E2, size_t N,
+              typename A, typename B, typename C = decltype(A()*B()),
+              typename Acc = accumulator_for<Policy, C>>
+    typename Acc::type dot(const vec_expr<E1,N,A>& lhs,
+                           const vec_expr<E2,N,B>& rhs)
+    {
+        const E1& l = lhs.self();
+        const E2& r = rhs.self();
+        Acc acc;
+        for (size_t i = 0; i < N; ++i)
+            acc.add(accumulate_dot_term<typename Acc::type>(l[i], r[i]));
+        return acc.value();
+    }
+
+    // squared 2-norm, accumulated in the real type
+    template <typename Policy = void, typename E, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>>
+    typename Acc::type norm2_sq(const vec_expr<E,N,T>& x)
+    {
+        const E& e = x.self();
+        Acc acc;
+        for (size_t i = 0; i < N; ++i)
+            acc.add(accumulate_abs_sq<typename Acc::type>(e[i]));
+        return acc.value();
+    }
+
+    // 2-norm
+    template <typename Policy = void, typename E, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>>
+    auto norm(const vec_expr<E,N,T>& x)
+        -> decltype(std::sqrt(typename Acc::type()))
+    {
+        return std::sqrt(norm2_sq<Policy>(x));
+    }
+
+
+    // batch versions for vec_array; one accumulator per vector
+    template <typename Policy, size_t N, typename A, typename B,
+              typename C = decltype(A()*B()),
+              typename Acc = accumulator_for<Policy, C>>
+    std::vector<typename Acc::type> dot(const vec_array<N,A>& lhs,
+                                        const vec_array<N,B>& rhs)
+    {
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        std::vector<Acc> acc(n);
+        for (size_t i = 0; i < N; ++i) {
+            const A* l = lhs.component(i);
+            const B* r = rhs.component(i);
+            for (size_t k = 0; k < n; ++k)
+                acc[k].add(accumulate_dot_term<typename Acc::type>(l[k], r[k]));
+        }
+        std::vector<typename Acc::type> res(n);
+        for (size_t k = 0; k < n; ++k)
+            res[k] = acc[k].value();
+        return res;
+    }
+
+    template <typename Policy, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>>
+    std::vector<typename Acc::type> norm2_sq(const vec_array<N,T>& x)
+    {
+        const size_t n = x.size();
+        std::vector<Acc> acc(n);
+        for (size_t i = 0; i < N; ++i) {
+            const T* c = x.component(i);
+            for (size_t k = 0; k < n; ++k)
+                acc[k].add(accumulate_abs_sq<typename Acc::type>(c[k]));
+        }
+        std::vector<typename Acc::type> res(n);
+        for (size_t k = 0; k < n; ++k)
+            res[k] = acc[k].value();
+        return res;
+    }
+
+    template <typename Policy, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>,
+              typename S = decltype(std::sqrt(typename Acc::type()))>
+    std::vector<S> norm(const vec_array<N,T>& x)
+    {
+        const std::vector<typename Acc::type> n2 = norm2_sq<Policy>(x);
+        std::vector<S> res(n2.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = std::sqrt(n2[k]);
+        return res;
+    }
+
+    // batch versions for std::vector<vec>
+    template <typename Policy, size_t N, typename A, typename B,
+              typename C = decltype(A()*B()),
+              typename Acc = accumulator_for<Policy, C>>
+    std::vector<typename Acc::type> dot(const std::vector<vec<N,A>>& lhs,
+                                        const std::vector<vec<N,B>>& rhs)
+    {
+        batch_check_size(lhs.size(), rhs.size());
+        std::vector<typename Acc::type> res(lhs.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = dot<Policy>(lhs[k], rhs[k]);
+        return res;
+    }
+
+    template <typename Policy, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>>
+    std::vector<typename Acc::type> norm2_sq(const std::vector<vec<N,T>>& x)
+    {
+        std::vector<typename Acc::type> res(x.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = norm2_sq<Policy>(x[k]);
+        return res;
+    }
+
+    template <typename Policy, size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq()),
+              typename Acc = accumulator_for<Policy, R>,
+              typename S = decltype(std::sqrt(typename Acc::type()))>
+    std::vector<S> norm(const std::vector<vec<N,T>>& x)
+    {
+        std::vector<S> res(x.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = norm<Policy>(x[k]);
+        return res;
+    }
+}
@@ -0,0 +1,315 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_simd.hpp"
+
+namespace Vec {
+    // size in bytes of an aligned vector of the given payload: the next
+    // power of two up to the alignment, multiples of the alignment beyond
+    constexpr size_t aligned_vec_bytes(size_t payload, size_t align,
+                                       size_t pow2 = 1)
+    {
+        return pow2 >= payload ? pow2
+            : (pow2 >= align ? (payload + align - 1) / align * align
+               : aligned_vec_bytes(payload, align, 2 * pow2));
+    }
+
+    constexpr size_t aligned_vec_align(size_t payload, size_t align)
+    {
+        return aligned_vec_bytes(payload, align) < align
+            ? aligned_vec_bytes(payload, align) : align;
+    }
+
+    // Vector whose storage is padded to a SIMD width and aligned to it (at
+    // most Align bytes), e.g. aligned_vec<3,double> occupies 32 bytes on a
+    // 32 byte boundary, so that it is loaded by a single instruction and
+    // arrays of it never straddle cache lines.
+    //
+    // The padding lanes are kept at zero and all operations, including
+    // operator==, norm, dot products and operator<<, only ever consider the
+    // first N components. Through vec_expr, aligned_vec mixes freely with
+    // vec in expressions.
+    template <size_t N, typename T = double, size_t Align = 32>
+    class alignas(aligned_vec_align(N * sizeof(T), Align)) aligned_vec : public vec_expr<aligned_vec<N,T,Align>, N, T> {
+	static_assert(N > 0, "vec may not be zero-dimensional");
+	static_assert(Align && !(Align & (Align - 1)),
+		      "alignment must be a power of two");
+    public:
+	// number of components including padding
+	static const size_t padded_size =
+	    aligned_vec_bytes(N * sizeof(T), Align) / sizeof(T);
+    private:
+	T data_[padded_size];
+    public:
+	// constructors
+	aligned_vec() : data_{} {}
+
+	aligned_vec(const T& val) : data_{}
+	{
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] = val;
+	}
+
+	aligned_vec(const T* p) : data_{}
+	{
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] = p[i];
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	aligned_vec(const vec_expr<E, N, T2>& x) : data_{}
+	{
+	    *this = x;
+	}
+
+	aligned_vec(std::initializer_list<T> il) : data_{}
+	{
+	    size_t i = 0;
+	    for (const T* it = il.begin(); it != il.end() && i < N; ++i, ++it)
+		data_[i] = *it;
+	}
+
+	// assignment; evaluates expressions without touching the padding
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	aligned_vec& operator=(const vec_expr<E, N, T2>& x)
+	{
+	    const E& e = x.self();
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] = e[i];
+	    return *this;
+	}
+
+	// element access
+	const T& operator[](size_t i) const
+	{
+	    return data_[i];
+	}
+
+	T& operator[](size_t i)
+	{
+	    return data_[i];
+	}
+
+	// padded storage, e.g. for SIMD loads of padded_size lanes
+	const T* data() const
+	{
+	    return data_;
+	}
+
+	// compound assignment; between aligned vecs, the padding takes part
+	// (0 + 0 stays 0) so that the loops run over whole SIMD registers
+	aligned_vec& operator+= (const aligned_vec& rhs)
+	{
+	    for (size_t i = 0; i < padded_size; ++i)
+		data_[i] += rhs.data_[i];
+	    return *this;
+	}
+
+	aligned_vec& operator-= (const aligned_vec& rhs)
+	{
+	    for (size_t i = 0; i < padded_size; ++i)
+		data_[i] -= rhs.data_[i];
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	aligned_vec& operator+= (const vec_expr<E, N, T2>& rhs)
+	{
+	    const E& e = rhs.self();
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] += T(e[i]);
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	aligned_vec& operator-= (const vec_expr<E, N, T2>& rhs)
+	{
+	    const E& e = rhs.self();
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] -= T(e[i]);
+	    return *this;
+	}
+
+	// scalar operations spare the padding, which could otherwise turn
+	// into NaN (0 * inf, 0 / 0)
+	aligned_vec& operator*= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] *= val;
+	    return *this;
+	}
+
+	aligned_vec& operator/= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] /= val;
+	    return *this;
+	}
+
+	// norm
+	auto norm2_sq() const -> decltype(vec<N,T>().norm2_sq())
+	{
+	    return vec<N,T>(*this).norm2_sq();
+	}
+
+	typename norm_type<T>::type norm(double p = 2) const
+	{
+	    return vec<N,T>(*this).norm(p);
+	}
+
+	template <unsigned P>
+	typename norm_type<T>::type norm() const
+	{
+	    return vec<N,T>(*this).template norm<P>();
+	}
+
+	typename norm_type<T>::type norm_inf() const
+	{
+	    return vec<N,T>(*this).norm_inf();
+	}
+
+	template <typename..., typename S = T>
+	typename std::enable_if<is_complex<S>::value, void>::type
+	conj()
+	{
+	    for (size_t i = 0; i < N; ++i)
+		data_[i] = std::conj(data_[i]);
+	}
+    };
+
+    template <size_t N, typename T, size_t Align>
+    const size_t aligned_vec<N,T,Align>::padded_size;
+
+    // aligned vecs are captured by reference in expressions, like vecs
+    template <size_t N, typename T, size_t Align>
+    struct vec_expr_ref<aligned_vec<N,T,Align>> {
+	typedef const aligned_vec<N,T,Align>& type;
+    };
+
+
+    // Allocator returning storage aligned to Align bytes (or the alignment
+    // of T, if larger), which std::allocator does not guarantee for
+    // over-aligned types before C++17:
+    //     std::vector<aligned_vec<3>, aligned_allocator<aligned_vec<3>>>
+    template <typename T, size_t Align = alignof(T)>
+    class aligned_allocator {
+    public:
+	typedef T value_type;
+	static const size_t alignment = Align < alignof(T) ? alignof(T) : Align;
+
+	template <typename U>
+	struct rebind {
+	    typedef aligned_allocator<U, Align> other;
+	};
+
+	aligned_allocator() = default;
+
+	template <typename U>
+	aligned_allocator(const aligned_allocator<U, Align>&) {}
+
+	// over-allocates and keeps the original pointer right before the
+	// aligned block
+	T* allocate(size_t n)
+	{
+	    if (n > (std::numeric_limits<size_t>::max() - alignment
+		     - sizeof(void*)) / sizeof(T))
+		throw std::bad_alloc();
+	    void* raw = ::operator new(n * sizeof(T) + alignment + sizeof(void*));
+	    uintptr_t p = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+	    p = (p + alignment - 1) & ~uintptr_t(alignment - 1);
+	    reinterpret_cast<void**>(p)[-1] = raw;
+	    return reinterpret_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t)
+	{
+	    ::operator delete(reinterpret_cast<void**>(p)[-1]);
+	}
+    };
+
+    template <typename T, size_t Align>
+    const size_t aligned_allocator<T,Align>::alignment;
+
+    template <typename T, typename U, size_t Align>
+    bool operator== (const aligned_allocator<T,Align>&,
+                     const aligned_allocator<U,Align>&)
+    {
+        return true;
+    }
+
+    template <typename T, typename U, size_t Align>
+    bool operator!= (const aligned_allocator<T,Align>&,
+                     const aligned_allocator<U,Align>&)
+    {
+        return false;
+    }
+
+    // std::vector of aligned vecs with suitably aligned storage
+    template <size_t N, typename T = double, size_t Align = 32>
+    using aligned_vec_vector =
+        std::vector<aligned_vec<N,T,Align>,
+                    aligned_allocator<aligned_vec<N,T,Align>>>;
+
+
+    // batch kernels on the padded layout; the SIMD kernels read vectors of
+    // stride padded_size but only their first N lanes
+    template <size_t N, typename T, size_t Align>
+    const T* simd_data(const aligned_vec_vector<N,T,Align>& x)
+    {
+        return x.empty() ? nullptr : x[0].data();
+    }
+
+    template <size_t N, typename T, size_t Align>
+    typename std::enable_if<std::is_floating_point<T>::value,
+                            std::vector<T>>::type
+    dot(const aligned_vec_vector<N,T,Align>& lhs,
+        const aligned_vec_vector<N,T,Align>& rhs)
+    {
+        simd_check_size(lhs.size(), rhs.size());
+        std::vector<T> res(lhs.size());
+        simd_dot<N, aligned_vec<N,T,Align>::padded_size>(
+            simd_data(lhs), simd_data(rhs), res.data(), res.size());
+        return res;
+    }
+
+    template <size_t N, typename T, size_t Align>
+    typename std::enable_if<std::is_floating_point<T>::value,
+                            std::vector<T>>::type
+    norm2_sq(const aligned_vec_vector<N,T,Align>& x)
+    {
+        std::vector<T> res(x.size());
+        simd_norm2_sq<N, aligned_vec<N,T,Align>::padded_size>(
+            simd_data(x), res.data(), res.size());
+        return res;
+    }
+}
@@ -0,0 +1,656 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "vec.hpp"
+
+namespace Vec {
+    // Structure-of-arrays storage for many vec<N,T>: component i of all
+    // vectors is kept contiguously, so that the batch kernels below can
+    // vectorize over the element index. Elements are accessed through proxy
+    // objects which take part in the vec expression templates and can thus
+    // be used wherever a vec is expected (dot product, cross, conj, ...).
+    template <size_t N, typename T> class vec_array;
+
+    // proxy to a single element of a vec_array
+    template <size_t N, typename T>
+    class vec_array_ref : public vec_expr<vec_array_ref<N,T>, N, T> {
+    private:
+	std::vector<T>* comp;
+	size_t k;
+    public:
+	vec_array_ref(std::vector<T>* c, size_t idx) : comp(c), k(idx) {}
+
+	vec_array_ref(const vec_array_ref&) = default;
+
+	// assignment writes through to the array, it never rebinds
+	vec_array_ref& operator=(const vec_array_ref& x)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] = x[i];
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	vec_array_ref& operator=(const vec_expr<E, N, T2>& x)
+	{
+	    const E& e = x.self();
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] = e[i];
+	    return *this;
+	}
+
+	T& operator[](size_t i) const
+	{
+	    return comp[i][k];
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	vec_array_ref& operator+= (const vec_expr<E, N, T2>& rhs)
+	{
+	    const E& e = rhs.self();
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] += T(e[i]);
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	vec_array_ref& operator-= (const vec_expr<E, N, T2>& rhs)
+	{
+	    const E& e = rhs.self();
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] -= T(e[i]);
+	    return *this;
+	}
+
+	vec_array_ref& operator*= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] *= val;
+	    return *this;
+	}
+
+	vec_array_ref& operator/= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] /= val;
+	    return *this;
+	}
+
+	auto norm2_sq() const -> decltype(vec<N,T>().norm2_sq())
+	{
+	    return vec<N,T>(*this).norm2_sq();
+	}
+
+	typename norm_type<T>::type norm(double p = 2) const
+	{
+	    return vec<N,T>(*this).norm(p);
+	}
+
+	template <unsigned P>
+	typename norm_type<T>::type norm() const
+	{
+	    return vec<N,T>(*this).template norm<P>();
+	}
+
+	typename norm_type<T>::type norm_inf() const
+	{
+	    return vec<N,T>(*this).norm_inf();
+	}
+
+	template <typename..., typename S = T>
+	typename std::enable_if<is_complex<S>::value, void>::type
+	conj() const
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i][k] = std::conj(comp[i][k]);
+	}
+    };
+
+    // read-only proxy to a single element of a const vec_array
+    template <size_t N, typename T>
+    class vec_array_cref : public vec_expr<vec_array_cref<N,T>, N, T> {
+    private:
+	const std::vector<T>* comp;
+	size_t k;
+    public:
+	vec_array_cref(const std::vector<T>* c, size_t idx) : comp(c), k(idx) {}
+
+	const T& operator[](size_t i) const
+	{
+	    return comp[i][k];
+	}
+
+	auto norm2_sq() const -> decltype(vec<N,T>().norm2_sq())
+	{
+	    return vec<N,T>(*this).norm2_sq();
+	}
+
+	typename norm_type<T>::type norm(double p = 2) const
+	{
+	    return vec<N,T>(*this).norm(p);
+	}
+
+	template <unsigned P>
+	typename norm_type<T>::type norm() const
+	{
+	    return vec<N,T>(*this).template norm<P>();
+	}
+
+	typename norm_type<T>::type norm_inf() const
+	{
+	    return vec<N,T>(*this).norm_inf();
+	}
+    };
+
+    // random access iterator over the element proxies
+    template <size_t N, typename T, typename Ref, typename Comp>
+    class vec_array_iterator {
+    private:
+	Comp* comp;
+	size_t k;
+    public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef vec<N,T> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef void pointer;
+	typedef Ref reference;
+
+	vec_array_iterator() : comp(nullptr), k(0) {}
+	vec_array_iterator(Comp* c, size_t idx) : comp(c), k(idx) {}
+
+	Ref operator*() const { return Ref(comp, k); }
+	Ref operator[](difference_type n) const { return Ref(comp, k + n); }
+
+	vec_array_iterator& operator++() { ++k; return *this; }
+	vec_array_iterator& operator--() { --k; return *this; }
+	vec_array_iterator operator++(int) { return {comp, k++}; }
+	vec_array_iterator operator--(int) { return {comp, k--}; }
+	vec_array_iterator& operator+=(difference_type n) { k += n; return *this; }
+	vec_array_iterator& operator-=(difference_type n) { k -= n; return *this; }
+
+	vec_array_iterator operator+(difference_type n) const
+	{
+	    return {comp, k + n};
+	}
+
+	vec_array_iterator operator-(difference_type n) const
+	{
+	    return {comp, k - n};
+	}
+
+	difference_type operator-(const vec_array_iterator& rhs) const
+	{
+	    return difference_type(k) - difference_type(rhs.k);
+	}
+
+	bool operator==(const vec_array_iterator& rhs) const { return k == rhs.k; }
+	bool operator!=(const vec_array_iterator& rhs) const { return k != rhs.k; }
+	bool operator<(const vec_array_iterator& rhs) const { return k < rhs.k; }
+	bool operator>(const vec_array_iterator& rhs) const { return k > rhs.k; }
+	bool operator<=(const vec_array_iterator& rhs) const { return k <= rhs.k; }
+	bool operator>=(const vec_array_iterator& rhs) const { return k >= rhs.k; }
+    };
+
+
+    // definition
+    template <size_t N, typename T = double>
+    class vec_array {
+	static_assert(N > 0, "vec may not be zero-dimensional");
+    private:
+	std::vector<T> comp[N];
+    public:
+	typedef vec<N,T> value_type;
+	typedef vec_array_ref<N,T> reference;
+	typedef vec_array_cref<N,T> const_reference;
+	typedef vec_array_iterator<N, T, reference, std::vector<T>> iterator;
+	typedef vec_array_iterator<N, T, const_reference,
+				   const std::vector<T>> const_iterator;
+
+	// constructors
+	vec_array() {}
+
+	explicit vec_array(size_t n, const vec<N,T>& val = vec<N,T>())
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].assign(n, val[i]);
+	}
+
+	template <typename InputIt,
+		    typename = typename std::iterator_traits<
+			InputIt>::iterator_category>
+	vec_array(InputIt first, InputIt last)
+	{
+	    for (; first != last; ++first)
+		push_back(*first);
+	}
+
+	vec_array(std::initializer_list<vec<N,T>> il)
+	    : vec_array(il.begin(), il.end()) {}
+
+	// element access
+	reference operator[](size_t k)
+	{
+	    return reference(comp, k);
+	}
+
+	const_reference operator[](size_t k) const
+	{
+	    return const_reference(comp, k);
+	}
+
+	// contiguous storage of the i-th component of all elements
+	T* component(size_t i)
+	{
+	    return comp[i].data();
+	}
+
+	const T* component(size_t i) const
+	{
+	    return comp[i].data();
+	}
+
+	iterator begin() { return iterator(comp, 0); }
+	iterator end() { return iterator(comp, size()); }
+	const_iterator begin() const { return const_iterator(comp, 0); }
+	const_iterator end() const { return const_iterator(comp, size()); }
+
+	// capacity
+	size_t size() const
+	{
+	    return comp[0].size();
+	}
+
+	bool empty() const
+	{
+	    return comp[0].empty();
+	}
+
+	void reserve(size_t n)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].reserve(n);
+	}
+
+	void resize(size_t n, const vec<N,T>& val = vec<N,T>())
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].resize(n, val[i]);
+	}
+
+	void clear()
+	{
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].clear();
+	}
+
+	// modifiers
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	void push_back(const vec_expr<E, N, T2>& x)
+	{
+	    const E& e = x.self();
+	    for (size_t i = 0; i < N; ++i)
+		comp[i].push_back(e[i]);
+	}
+    };
+
+
+    // element-wise kernels shared by the batch operations
+    template <typename A, typename B>
+    typename std::enable_if<std::is_arithmetic<A>::value,
+                            decltype(A()*B())>::type
+    dot_term(const A& a, const B& b)
+    {
+        return a * b;
+    }
+
+    template <typename A, typename B>
+    typename std::enable_if<is_complex<A>::value, decltype(A()*B())>::type
+    dot_term(const A& a, const B& b)
+    {
+        return std::conj(a) * b;
+    }
+
+    // spelled out to avoid the NaN/inf recovery of complex multiplication,
+    // which would prevent vectorization
+    template <typename T>
+    std::complex<T> dot_term(const std::complex<T>& a, const std::complex<T>& b)
+    {
+        return {a.real() * b.real() + a.imag() * b.imag(),
+                a.real() * b.imag() - a.imag() * b.real()};
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+    abs_sq(const T& a)
+    {
+        return a * a;
+    }
+
+    template <typename T>
+    typename std::enable_if<is_complex<T>::value,
+                            typename T::value_type>::type
+    abs_sq(const T& a)
+    {
+        return a.real() * a.real() + a.imag() * a.imag();
+    }
+
+
+    // the operands of batch operations must have the same size
+    inline void batch_check_size(size_t n, size_t m)
+    {
+        if (n != m)
+            throw std::invalid_argument("batch operands differ in size");
+    }
+
+
+    // batch dot product: res[k] = lhs[k] * rhs[k]
+    template <size_t N, typename A, typename B, typename C = decltype(A()*B())>
+    std::vector<C> dot(const vec_array<N,A>& lhs, const vec_array<N,B>& rhs)
+    {
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        std::vector<C> res(n);
+        C* out = res.data();
+        for (size_t i = 0; i < N; ++i) {
+            const A* l = lhs.component(i);
+            const B* r = rhs.component(i);
+            for (size_t k = 0; k < n; ++k)
+                out[k] += dot_term(l[k], r[k]);
+        }
+        return res;
+    }
+
+
+    // batch squared 2-norm
+    template <size_t N, typename T,
+              typename R = decltype(abs_sq(T()))>
+    std::vector<R> norm2_sq(const vec_array<N,T>& x)
+    {
+        const size_t n = x.size();
+        std::vector<R> res(n);
+        R* out = res.data();
+        for (size_t i = 0; i < N; ++i) {
+            const T* c = x.component(i);
+            for (size_t k = 0; k < n; ++k)
+                out[k] += abs_sq(c[k]);
+        }
+        return res;
+    }
+
+
+    // batch maximum norm
+    template <size_t N, typename T, typename R = typename norm_type<T>::type>
+    std::vector<R> norm_inf(const vec_array<N,T>& x)
+    {
+        const size_t n = x.size();
+        std::vector<R> res(n);
+        R* out = res.data();
+        for (size_t i = 0; i < N; ++i) {
+            const T* c = x.component(i);
+            for (size_t k = 0; k < n; ++k) {
+                R a = vec_abs(c[k]);
+                out[k] = a > out[k] || a != a ? a : out[k];
+            }
+        }
+        return res;
+    }
+
+    // batch p-norm; like vec::norm, p = 1, 2, infinity and other integers
+    // avoid std::pow per element
+    template <size_t N, typename T, typename R = typename norm_type<T>::type>
+    std::vector<R> norm(const vec_array<N,T>& x, double p = 2)
+    {
+        const size_t n = x.size();
+        std::vector<R> res(n);
+        R* out = res.data();
+        if (p == 2) {
+            for (size_t i = 0; i < N; ++i) {
+                const T* c = x.component(i);
+                for (size_t k = 0; k < n; ++k)
+                    out[k] += vec_abs_sq(c[k]);
+            }
+            for (size_t k = 0; k < n; ++k)
+                out[k] = std::sqrt(out[k]);
+        } else if (p == 1) {
+            for (size_t i = 0; i < N; ++i) {
+                const T* c = x.component(i);
+                for (size_t k = 0; k < n; ++k)
+                    out[k] += vec_abs(c[k]);
+            }
+        } else if (p == std::numeric_limits<double>::infinity()) {
+            res = norm_inf(x);
+        } else if (p > 0 && p <= 64 && p == unsigned(p)) {
+            const unsigned q = unsigned(p);
+            for (size_t i = 0; i < N; ++i) {
+                const T* c = x.component(i);
+                for (size_t k = 0; k < n; ++k)
+                    out[k] += vec_ipow(vec_abs(c[k]), q);
+            }
+            for (size_t k = 0; k < n; ++k)
+                out[k] = vec_iroot(out[k], q);
+        } else {
+            for (size_t i = 0; i < N; ++i) {
+                const T* c = x.component(i);
+                for (size_t k = 0; k < n; ++k)
+                    out[k] += std::pow(vec_abs(c[k]), R(p));
+            }
+            for (size_t k = 0; k < n; ++k)
+                out[k] = std::pow(out[k], R(1 / p));
+        }
+        return res;
+    }
+
+
+
+    // batch cross product
+    template <typename A, typename B, typename C = decltype(A()*B())>
+    typename std::enable_if<std::is_arithmetic<A>::value, vec_array<3,C>>::type
+    cross(const vec_array<3,A>& lhs, const vec_array<3,B>& rhs)
+    {
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        vec_array<3,C> res(n);
+        const A *l0 = lhs.component(0), *l1 = lhs.component(1),
+            *l2 = lhs.component(2);
+        const B *r0 = rhs.component(0), *r1 = rhs.component(1),
+            *r2 = rhs.component(2);
+        C *o0 = res.component(0), *o1 = res.component(1),
+            *o2 = res.component(2);
+        for (size_t k = 0; k < n; ++k) {
+            o0[k] = l1[k] * r2[k] - l2[k] * r1[k];
+            o1[k] = l2[k] * r0[k] - l0[k] * r2[k];
+            o2[k] = l0[k] * r1[k] - l1[k] * r0[k];
+        }
+        return res;
+    }
+
+    template <typename A, typename B, typename C = decltype(A()*B())>
+    typename std::enable_if<is_complex<A>::value, vec_array<3,C>>::type
+    cross(const vec_array<3,A>& lhs, const vec_array<3,B>& rhs)
+    {
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        vec_array<3,C> res(n);
+        const A *l0 = lhs.component(0), *l1 = lhs.component(1),
+            *l2 = lhs.component(2);
+        const B *r0 = rhs.component(0), *r1 = rhs.component(1),
+            *r2 = rhs.component(2);
+        C *o0 = res.component(0), *o1 = res.component(1),
+            *o2 = res.component(2);
+        for (size_t k = 0; k < n; ++k) {
+            o0[k] = std::conj(l1[k] * r2[k] - l2[k] * r1[k]);
+            o1[k] = std::conj(l2[k] * r0[k] - l0[k] * r2[k]);
+            o2[k] = std::conj(l0[k] * r1[k] - l1[k] * r0[k]);
+        }
+        return res;
+    }
+
+
+    // Batched fused multiply-add operations (see axpy etc. in vec.hpp),
+    // each a single pass over the arrays.
+
+    // y += alpha * x for all elements
+    template <size_t N, typename T, typename S,
+              typename A = typename fma_coeff<T,S>::type>
+    void axpy(const S& alpha, const vec_array<N,T>& x, vec_array<N,T>& y)
+    {
+        const size_t n = x.size();
+        batch_check_size(n, y.size());
+        const A a(alpha);
+        for (size_t i = 0; i < N; ++i) {
+            const T* xi = x.component(i);
+            T* yi = y.component(i);
+            for (size_t k = 0; k < n; ++k)
+                yi[k] = vec_fma(a, xi[k], yi[k]);
+        }
+    }
+
+    // y = alpha * x + beta * y for all elements
+    template <size_t N, typename T, typename S,
+              typename A = typename fma_coeff<T,S>::type>
+    void axpby(const S& alpha, const vec_array<N,T>& x, const S& beta,
+               vec_array<N,T>& y)
+    {
+        const size_t n = x.size();
+        batch_check_size(n, y.size());
+        const A a(alpha), b(beta);
+        for (size_t i = 0; i < N; ++i) {
+            const T* xi = x.component(i);
+            T* yi = y.component(i);
+            for (size_t k = 0; k < n; ++k)
+                yi[k] = vec_fma(a, xi[k], T(b * yi[k]));
+        }
+    }
+
+    // z = alpha * x + beta * y + gamma * z for all elements
+    template <size_t N, typename T, typename S,
+              typename A = typename fma_coeff<T,S>::type>
+    void update(const S& alpha, const vec_array<N,T>& x, const S& beta,
+                const vec_array<N,T>& y, const S& gamma, vec_array<N,T>& z)
+    {
+        const size_t n = x.size();
+        batch_check_size(n, y.size());
+        batch_check_size(n, z.size());
+        const A a(alpha), b(beta), g(gamma);
+        for (size_t i = 0; i < N; ++i) {
+            const T* xi = x.component(i);
+            const T* yi = y.component(i);
+            T* zi = z.component(i);
+            for (size_t k = 0; k < n; ++k)
+                zi[k] = vec_fma(a, xi[k], vec_fma(b, yi[k], T(g * zi[k])));
+        }
+    }
+
+    // (1 - t) a + t b for all elements
+    template <size_t N, typename T, typename S,
+              typename A = typename fma_coeff<T,S>::type>
+    vec_array<N,T> lerp(const vec_array<N,T>& a, const vec_array<N,T>& b,
+                        const S& t)
+    {
+        const size_t n = a.size();
+        batch_check_size(n, b.size());
+        const A ts(t);
+        vec_array<N,T> res(n);
+        for (size_t i = 0; i < N; ++i) {
+            const T* ai = a.component(i);
+            const T* bi = b.component(i);
+            T* ri = res.component(i);
+            for (size_t k = 0; k < n; ++k)
+                ri[k] = vec_fma(ts, bi[k], vec_fma(A(-ts), ai[k], ai[k]));
+        }
+        return res;
+    }
+
+
+    // The same for arrays of vec<N,T>, passed as pointers and a count or as
+    // std::vector. For float and double, vec_simd.hpp provides simd_axpy on
+    // std::vector, which is not fused and whose results are bit-identical to
+    // the operators instead.
+    template <size_t N, typename T, typename S>
+    void axpy(const S& alpha, const vec<N,T>* x, vec<N,T>* y, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k)
+            axpy(alpha, x[k], y[k]);
+    }
+
+    template <size_t N, typename T, typename S>
+    void axpy(const S& alpha, const std::vector<vec<N,T>>& x,
+              std::vector<vec<N,T>>& y)
+    {
+        batch_check_size(x.size(), y.size());
+        axpy(alpha, x.data(), y.data(), x.size());
+    }
+
+    template <size_t N, typename T, typename S>
+    void axpby(const S& alpha, const vec<N,T>* x, const S& beta, vec<N,T>* y,
+               size_t n)
+    {
+        for (size_t k = 0; k < n; ++k)
+            axpby(alpha, x[k], beta, y[k]);
+    }
+
+    template <size_t N, typename T, typename S>
+    void axpby(const S& alpha, const std::vector<vec<N,T>>& x, const S& beta,
+               std::vector<vec<N,T>>& y)
+    {
+        batch_check_size(x.size(), y.size());
+        axpby(alpha, x.data(), beta, y.data(), x.size());
+    }
+
+    template <size_t N, typename T, typename S>
+    void update(const S& alpha, const vec<N,T>* x, const S& beta,
+                const vec<N,T>* y, const S& gamma, vec<N,T>* z, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k)
+            update(alpha, x[k], beta, y[k], gamma, z[k]);
+    }
+
+    template <size_t N, typename T, typename S>
+    void update(const S& alpha, const std::vector<vec<N,T>>& x, const S& beta,
+                const std::vector<vec<N,T>>& y, const S& gamma,
+                std::vector<vec<N,T>>& z)
+    {
+        batch_check_size(x.size(), y.size());
+        batch_check_size(x.size(), z.size());
+        update(alpha, x.data(), beta, y.data(), gamma, z.data(), x.size());
+    }
+
+    template <size_t N, typename T, typename S>
+    std::vector<vec<N,T>> lerp(const std::vector<vec<N,T>>& a,
+                               const std::vector<vec<N,T>>& b, const S& t)
+    {
+        batch_check_size(a.size(), b.size());
+        std::vector<vec<N,T>> res(a.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = lerp(a[k], b[k], t);
+        return res;
+    }
+}
@@ -0,0 +1,237 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+#include "vec_mat.hpp"
+
+namespace Vec {
+    // Periodic boundary conditions. Unlike operator% (std::fmod), wrapping
+    // always yields coordinates in [0, L) and needs neither a division nor a
+    // library call: the box keeps its inverse lengths and rounds via
+    // truncating integer conversion, so the kernels are free of branches.
+
+    // floor and rounding to nearest for |x| < 2^63
+    template <typename T>
+    T box_floor(T x)
+    {
+        const T t = T((long long)(x));
+        return t - T(x < t);
+    }
+
+    template <typename T>
+    T box_round(T x)
+    {
+        return box_floor(x + T(0.5));
+    }
+
+    // the representative of x in [0, l), given inv = 1 / l
+    template <typename T>
+    T box_wrap(T x, T l, T inv)
+    {
+        T r = x - l * box_floor(x * inv);
+        // correct for the rounding of x * inv close to multiples of l
+        r = r < 0 ? r + l : r;
+        return r >= l ? r - l : r;
+    }
+
+
+    // orthorhombic box [0, L_0) x ... x [0, L_{N-1})
+    template <size_t N, typename T = double>
+    class periodic_box {
+	static_assert(std::is_floating_point<T>::value,
+		      "periodic_box requires floating point coordinates");
+    private:
+	vec<N,T> len, inv;
+    public:
+	periodic_box(const vec<N,T>& lengths) : len(lengths)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		inv[i] = T(1) / len[i];
+	}
+
+	const vec<N,T>& lengths() const
+	{
+	    return len;
+	}
+
+	T volume() const
+	{
+	    T v = 1;
+	    for (size_t i = 0; i < N; ++i)
+		v *= len[i];
+	    return v;
+	}
+
+	// position mapped into the box
+	vec<N,T> wrap(const vec<N,T>& x) const
+	{
+	    vec<N,T> res;
+	    for (size_t i = 0; i < N; ++i)
+		res[i] = box_wrap(x[i], len[i], inv[i]);
+	    return res;
+	}
+
+	// shortest periodic image of the displacement d
+	vec<N,T> minimum_image(const vec<N,T>& d) const
+	{
+	    vec<N,T> res;
+	    for (size_t i = 0; i < N; ++i)
+		res[i] = d[i] - len[i] * box_round(d[i] * inv[i]);
+	    return res;
+	}
+
+	// minimum-image displacement from a to b and its square
+	vec<N,T> displacement(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    return minimum_image(vec<N,T>(b - a));
+	}
+
+	T distance2(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    return displacement(a, b).norm2_sq();
+	}
+
+	// batch versions, in place
+	void wrap(vec<N,T>* x, size_t n) const
+	{
+	    for (size_t k = 0; k < n; ++k)
+		x[k] = wrap(x[k]);
+	}
+
+	void wrap(std::vector<vec<N,T>>& x) const
+	{
+	    wrap(x.data(), x.size());
+	}
+
+	void wrap(vec_array<N,T>& x) const
+	{
+	    const size_t n = x.size();
+	    for (size_t i = 0; i < N; ++i) {
+		T* c = x.component(i);
+		const T l = len[i], il = inv[i];
+		for (size_t k = 0; k < n; ++k)
+		    c[k] = box_wrap(c[k], l, il);
+	    }
+	}
+
+	void minimum_image(vec<N,T>* d, size_t n) const
+	{
+	    for (size_t k = 0; k < n; ++k)
+		d[k] = minimum_image(d[k]);
+	}
+
+	void minimum_image(std::vector<vec<N,T>>& d) const
+	{
+	    minimum_image(d.data(), d.size());
+	}
+
+	void minimum_image(vec_array<N,T>& d) const
+	{
+	    const size_t n = d.size();
+	    for (size_t i = 0; i < N; ++i) {
+		T* c = d.component(i);
+		const T l = len[i], il = inv[i];
+		for (size_t k = 0; k < n; ++k)
+		    c[k] -= l * box_round(c[k] * il);
+	    }
+	}
+    };
+
+
+    // Triclinic box spanned by the columns of the cell matrix h. Positions
+    // are handled in fractional coordinates s = h^-1 x. The minimum image
+    // obtained by rounding s is exact for displacements shorter than half
+    // the smallest distance between opposite faces, provided the cell is
+    // reduced (tilts of at most half the corresponding box length).
+    template <size_t N, typename T = double>
+    class triclinic_box {
+	static_assert(std::is_floating_point<T>::value,
+		      "triclinic_box requires floating point coordinates");
+    private:
+	mat<N,N,T> h, h_inv;
+    public:
+	triclinic_box(const mat<N,N,T>& cell) : h(cell), h_inv(inverse(cell)) {}
+
+	const mat<N,N,T>& cell() const
+	{
+	    return h;
+	}
+
+	vec<N,T> fractional(const vec<N,T>& x) const
+	{
+	    return h_inv * x;
+	}
+
+	vec<N,T> cartesian(const vec<N,T>& s) const
+	{
+	    return h * s;
+	}
+
+	vec<N,T> wrap(const vec<N,T>& x) const
+	{
+	    vec<N,T> s = h_inv * x;
+	    for (size_t i = 0; i < N; ++i)
+		s[i] = box_wrap(s[i], T(1), T(1));
+	    return h * s;
+	}
+
+	vec<N,T> minimum_image(const vec<N,T>& d) const
+	{
+	    vec<N,T> s = h_inv * d;
+	    for (size_t i = 0; i < N; ++i)
+		s[i] -= box_round(s[i]);
+	    return h * s;
+	}
+
+	vec<N,T> displacement(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    return minimum_image(vec<N,T>(b - a));
+	}
+
+	T distance2(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    return displacement(a, b).norm2_sq();
+	}
+
+	// batch versions, in place
+	void wrap(vec<N,T>* x, size_t n) const
+	{
+	    for (size_t k = 0; k < n; ++k)
+		x[k] = wrap(x[k]);
+	}
+
+	void wrap(std::vector<vec<N,T>>& x) const
+	{
+	    wrap(x.data(), x.size());
+	}
+
+	void minimum_image(vec<N,T>* d, size_t n) const
+	{
+	    for (size_t k = 0; k < n; ++k)
+		d[k] = minimum_image(d[k]);
+	}
+
+	void minimum_image(std::vector<vec<N,T>>& d) const
+	{
+	    minimum_image(d.data(), d.size());
+	}
+    };
+}
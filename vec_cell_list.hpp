@@ -0,0 +1,285 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+#include "vec_box.hpp"
+
+namespace Vec {
+    // number of cells adjacent to a cell, including itself
+    constexpr size_t cell_stencil_size(size_t n)
+    {
+        return n ? 3 * cell_stencil_size(n - 1) : 1;
+    }
+
+    // Linked-cell neighbour search. Space is divided into cells at least
+    // cutoff + skin wide, the points are sorted by cell, and pairs are only
+    // looked for among points in the same or adjacent cells, which takes
+    // O(n) rather than O(n^2) operations.
+    //
+    // The cells are built from reference positions. As long as no point has
+    // moved by more than skin / 2 since, they remain valid for current
+    // positions; update() only rebuilds once that is no longer the case.
+    template <size_t N, typename T = double>
+    class cell_list {
+	static_assert(std::is_floating_point<T>::value,
+		      "cell_list requires floating point coordinates");
+    public:
+	typedef std::pair<size_t,size_t> pair_type;
+    private:
+	T cutoff, skin;
+	bool periodic;
+	periodic_box<N,T> box;
+	unsigned threads;
+	vec<N,T> lo, inv_width;
+	size_t dims[N];
+	std::vector<size_t> order;    // point indices sorted by cell
+	std::vector<size_t> start;    // offsets of the cells in order
+	std::vector<vec<N,T>> ref;    // positions at the last build
+
+	static const size_t grain_size = 1 << 12;
+    public:
+	// open boundaries; the cells cover the bounding box of the points
+	cell_list(T rc, T sk = 0, unsigned nt = 0)
+	    : cutoff(rc), skin(sk), periodic(false), box(vec<N,T>(T(1))),
+	      threads(nt), dims{}
+	{
+	    if (!(cutoff > 0) || skin < 0)
+		throw std::invalid_argument("invalid cutoff or skin");
+	}
+
+	// periodic boundaries according to the minimum image convention,
+	// which requires cutoff + skin to be at most half of the box lengths
+	cell_list(const periodic_box<N,T>& b, T rc, T sk = 0, unsigned nt = 0)
+	    : cutoff(rc), skin(sk), periodic(true), box(b), threads(nt), dims{}
+	{
+	    if (!(cutoff > 0) || skin < 0)
+		throw std::invalid_argument("invalid cutoff or skin");
+	    for (size_t i = 0; i < N; ++i)
+		if (2 * (cutoff + skin) > box.lengths()[i])
+		    throw std::invalid_argument("cutoff exceeds half the box");
+	}
+
+	size_t size() const
+	{
+	    return order.size();
+	}
+
+	// number of cells in dimension i
+	size_t cells(size_t i) const
+	{
+	    return dims[i];
+	}
+
+	// build the cells from the given reference positions
+	void build(const std::vector<vec<N,T>>& x)
+	{
+	    const size_t n = x.size();
+	    ref = x;
+	    if (periodic)
+		box.wrap(ref);
+	    setup_grid();
+
+	    // counting sort by cell, with one histogram per thread, so that
+	    // the points of each cell stay ordered by index
+	    const size_t ncells = start.size() - 1;
+	    const unsigned nt = num_threads(n);
+	    std::vector<size_t> cell(n);
+	    std::vector<std::vector<size_t>> hist(nt,
+						  std::vector<size_t>(ncells));
+	    parallel(nt, n, [&](unsigned t, size_t b, size_t e) {
+		for (size_t k = b; k < e; ++k)
+		    ++hist[t][cell[k] = cell_of(ref[k])];
+	    });
+	    size_t offset = 0;
+	    for (size_t c = 0; c < ncells; ++c) {
+		start[c] = offset;
+		for (unsigned t = 0; t < nt; ++t) {
+		    const size_t count = hist[t][c];
+		    hist[t][c] = offset;
+		    offset += count;
+		}
+	    }
+	    start[ncells] = offset;
+	    order.resize(n);
+	    parallel(nt, n, [&](unsigned t, size_t b, size_t e) {
+		for (size_t k = b; k < e; ++k)
+		    order[hist[t][cell[k]]++] = k;
+	    });
+	}
+
+	// rebuild if some point has moved by more than skin / 2 since the
+	// last build (or the number of points has changed); returns whether
+	// the cells were rebuilt
+	bool update(const std::vector<vec<N,T>>& x)
+	{
+	    bool stale = x.size() != ref.size() || start.empty();
+	    const T limit = skin * skin / 4;
+	    for (size_t k = 0; !stale && k < x.size(); ++k)
+		stale = distance2(ref[k], x[k]) > limit;
+	    if (stale)
+		build(x);
+	    return stale;
+	}
+
+	// all pairs (i, j), i < j, of points closer than the cutoff, at the
+	// current positions x; the cells have to be up to date, see update()
+	std::vector<pair_type> pairs(const std::vector<vec<N,T>>& x) const
+	{
+	    if (start.empty() || x.size() != order.size())
+		throw std::invalid_argument("cell list is out of date");
+	    // gather the positions in cell order for locality
+	    std::vector<vec<N,T>> xs(x.size());
+	    for (size_t k = 0; k < xs.size(); ++k)
+		xs[k] = x[order[k]];
+
+	    // contiguous ranges of cells per thread, concatenated in order, so
+	    // the result does not depend on the number of threads
+	    const size_t ncells = start.size() - 1;
+	    const unsigned nt = num_threads(x.size());
+	    std::vector<std::vector<pair_type>> found(nt);
+	    parallel(nt, ncells, [&](unsigned t, size_t b, size_t e) {
+		for (size_t c = b; c < e; ++c)
+		    cell_pairs(c, xs, found[t]);
+	    });
+	    std::vector<pair_type> res;
+	    for (auto& f : found)
+		res.insert(res.end(), f.begin(), f.end());
+	    return res;
+	}
+
+    private:
+	T distance2(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    return periodic ? box.distance2(a, b) : vec<N,T>(b - a).norm2_sq();
+	}
+
+	unsigned num_threads(size_t n) const
+	{
+	    unsigned nt = threads ? threads
+		: std::max(1u, std::thread::hardware_concurrency());
+	    return unsigned(std::max<size_t>(1, std::min<size_t>(
+		nt, n / grain_size)));
+	}
+
+	// f(t, begin, end) on nt contiguous chunks of [0, n)
+	template <typename F>
+	static void parallel(unsigned nt, size_t n, F f)
+	{
+	    std::vector<std::thread> pool;
+	    for (unsigned t = 1; t < nt; ++t)
+		pool.emplace_back(f, t, n * t / nt, n * (t + 1) / nt);
+	    f(0, 0, n / nt);
+	    for (std::thread& th : pool)
+		th.join();
+	}
+
+	void setup_grid()
+	{
+	    vec<N,T> extent;
+	    if (periodic) {
+		lo = vec<N,T>();
+		extent = box.lengths();
+	    } else if (!ref.empty()) {
+		lo = ref[0];
+		vec<N,T> hi = ref[0];
+		for (const auto& p : ref)
+		    for (size_t i = 0; i < N; ++i) {
+			lo[i] = std::min(lo[i], p[i]);
+			hi[i] = std::max(hi[i], p[i]);
+		    }
+		extent = hi - lo;
+	    }
+	    // cells no narrower than cutoff + skin, but no more than about
+	    // two per point
+	    const T width = cutoff + skin;
+	    const size_t limit = std::max<size_t>(64, 2 * ref.size());
+	    T total = 1;
+	    for (size_t i = 0; i < N; ++i) {
+		dims[i] = std::max<size_t>(1, size_t(extent[i] / width));
+		total *= T(dims[i]);
+	    }
+	    if (total > T(limit)) {
+		const T shrink = std::pow(total / T(limit), T(1) / T(N));
+		for (size_t i = 0; i < N; ++i)
+		    dims[i] = std::max<size_t>(1, size_t(T(dims[i]) / shrink));
+	    }
+	    size_t ncells = 1;
+	    for (size_t i = 0; i < N; ++i) {
+		ncells *= dims[i];
+		inv_width[i] = extent[i] > 0 ? T(dims[i]) / extent[i] : T(0);
+	    }
+	    start.assign(ncells + 1, 0);
+	}
+
+	size_t cell_of(const vec<N,T>& p) const
+	{
+	    size_t c = 0;
+	    for (size_t i = 0; i < N; ++i) {
+		T s = (p[i] - lo[i]) * inv_width[i];
+		size_t ci = s > 0 ? size_t(s) : 0;
+		c = c * dims[i] + std::min(ci, dims[i] - 1);
+	    }
+	    return c;
+	}
+
+	void cell_pairs(size_t c, const std::vector<vec<N,T>>& xs,
+			std::vector<pair_type>& out) const
+	{
+	    size_t coord[N];
+	    for (size_t i = N, r = c; i-- > 0; r /= dims[i])
+		coord[i] = r % dims[i];
+
+	    // the adjacent cells, including c itself
+	    size_t stencil[cell_stencil_size(N)];
+	    size_t m = 0;
+	    for (size_t s = 0; s < cell_stencil_size(N); ++s) {
+		size_t nc = 0, r = s;
+		bool inside = true;
+		for (size_t i = 0; i < N; ++i, r /= 3) {
+		    long long ci = (long long)(coord[i]) + (long long)(r % 3) - 1;
+		    if (ci < 0 || ci >= (long long)(dims[i])) {
+			if (!periodic)
+			    inside = false;
+			ci = ci < 0 ? ci + (long long)(dims[i])
+			    : ci - (long long)(dims[i]);
+		    }
+		    nc = nc * dims[i] + size_t(ci);
+		}
+		// with fewer than three cells in a periodic dimension, some
+		// offsets lead to the same cell
+		if (inside && std::find(stencil, stencil + m, nc) == stencil + m)
+		    stencil[m++] = nc;
+	    }
+
+	    const T cut2 = cutoff * cutoff;
+	    for (size_t a = start[c]; a < start[c + 1]; ++a)
+		for (size_t s = 0; s < m; ++s)
+		    for (size_t b = std::max(start[stencil[s]], a + 1);
+			 b < start[stencil[s] + 1]; ++b)
+			if (distance2(xs[a], xs[b]) < cut2)
+			    out.push_back(std::minmax(order[a], order[b]));
+	}
+    };
+}
@@ -0,0 +1,478 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+#include "vec_simd.hpp"
+
+namespace Vec {
+    // Tolerances for approximate comparison. Two components x and y are
+    // considered equal if x == y or if any of the following holds:
+    //
+    //     |x - y| <= abs
+    //     |x - y| <= rel * max(|x|, |y|)
+    //     x and y are at most `ulps` representable values apart
+    //
+    // For complex components, |.| is the modulus and the last criterion
+    // applies to the real and imaginary parts separately. NaN is never
+    // approximately equal to anything. Criteria are combined like
+    //
+    //     tolerance::relative(1e-12).or_absolute(1e-300)
+    struct tolerance {
+	double abs;
+	double rel;
+	uint64_t ulps;
+
+	static tolerance exact()
+	{
+	    return {0, 0, 0};
+	}
+
+	static tolerance absolute(double eps)
+	{
+	    return {eps, 0, 0};
+	}
+
+	static tolerance relative(double eps)
+	{
+	    return {0, eps, 0};
+	}
+
+	static tolerance ulp(uint64_t n)
+	{
+	    return {0, 0, n};
+	}
+
+	tolerance or_absolute(double eps) const
+	{
+	    return {eps, rel, ulps};
+	}
+
+	tolerance or_relative(double eps) const
+	{
+	    return {abs, eps, ulps};
+	}
+
+	tolerance or_ulp(uint64_t n) const
+	{
+	    return {abs, rel, n};
+	}
+    };
+
+
+    // number of representable values from x to y; the bit patterns are
+    // mapped to integers ordered like the values, with -0 == +0
+    inline uint64_t vec_ulp_distance(double x, double y)
+    {
+        int64_t i, j;
+        std::memcpy(&i, &x, sizeof(i));
+        std::memcpy(&j, &y, sizeof(j));
+        i = i < 0 ? std::numeric_limits<int64_t>::min() - i : i;
+        j = j < 0 ? std::numeric_limits<int64_t>::min() - j : j;
+        return i < j ? uint64_t(j) - uint64_t(i) : uint64_t(i) - uint64_t(j);
+    }
+
+    inline uint64_t vec_ulp_distance(float x, float y)
+    {
+        int32_t i, j;
+        std::memcpy(&i, &x, sizeof(i));
+        std::memcpy(&j, &y, sizeof(j));
+        i = i < 0 ? std::numeric_limits<int32_t>::min() - i : i;
+        j = j < 0 ? std::numeric_limits<int32_t>::min() - j : j;
+        return i < j ? uint32_t(j) - uint32_t(i) : uint32_t(i) - uint32_t(j);
+    }
+
+    // other floating point types: distance in units of the spacing at the
+    // larger magnitude
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type
+    vec_ulp_distance(T x, T y)
+    {
+        const T d = std::abs(x - y);
+        if (d == 0)
+            return 0;
+        const T m = std::max(std::abs(x), std::abs(y));
+        const T ulp = std::max(std::numeric_limits<T>::denorm_min(),
+                               std::ldexp(std::numeric_limits<T>::epsilon(),
+                                          std::ilogb(m)));
+        const T n = d / ulp;
+        return n < T(std::numeric_limits<uint64_t>::max())
+            ? uint64_t(n) : std::numeric_limits<uint64_t>::max();
+    }
+
+    // integers are one unit apart
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, uint64_t>::type
+    vec_ulp_distance(T x, T y)
+    {
+        return x < y ? uint64_t(y) - uint64_t(x) : uint64_t(x) - uint64_t(y);
+    }
+
+    template <typename S>
+    uint64_t vec_ulp_distance(const std::complex<S>& x, const std::complex<S>& y)
+    {
+        return std::max(vec_ulp_distance(x.real(), y.real()),
+                        vec_ulp_distance(x.imag(), y.imag()));
+    }
+
+    // |x - y| <= max(abs, rel * max(|x|, |y|)) in the norm type, without
+    // wrapping around for unsigned types
+    template <typename T, typename R = typename norm_type<T>::type>
+    bool vec_within(const T& x, const T& y, R abs, R rel)
+    {
+        const R d = std::abs(R(x) - R(y));
+        return d <= std::max(abs, rel * std::max(vec_abs(x), vec_abs(y)));
+    }
+
+    // compares squares, which avoids the roots but may overflow like vec_abs
+    template <typename S, typename R = typename norm_type<S>::type>
+    bool vec_within(const std::complex<S>& x, const std::complex<S>& y,
+                    R abs, R rel)
+    {
+        const R re = R(x.real()) - R(y.real()), im = R(x.imag()) - R(y.imag());
+        const R m2 = std::max(vec_abs_sq(x), vec_abs_sq(y));
+        return re * re + im * im <= std::max(abs * abs, rel * rel * m2);
+    }
+
+    // the tolerance in the norm type of T
+    template <typename T, typename R = typename norm_type<T>::type>
+    struct vec_tolerance {
+	R abs;
+	R rel;
+	uint64_t ulps;
+
+	vec_tolerance(const tolerance& tol)
+	    : abs(R(tol.abs)), rel(R(tol.rel)), ulps(tol.ulps) {}
+
+	// x == y or within the absolute or relative tolerance
+	bool within(const T& x, const T& y) const
+	{
+	    return (x == y) | vec_within(x, y, abs, rel);
+	}
+
+	// within the ULP tolerance; not for NaN
+	bool within_ulps(const T& x, const T& y) const
+	{
+	    return (x == x) & (y == y) & (vec_ulp_distance(x, y) <= ulps);
+	}
+
+	// apart from the ULP distance, which is skipped unless asked for, the
+	// criteria are evaluated and combined without branching
+	bool operator()(const T& x, const T& y) const
+	{
+	    bool eq = within(x, y);
+	    if (ulps)
+		eq |= within_ulps(x, y);
+	    return eq;
+	}
+    };
+
+
+    template <typename E1, typename E2, size_t N, typename T>
+    bool approx_equal(const vec_expr<E1,N,T>& lhs, const vec_expr<E2,N,T>& rhs,
+                      const vec_tolerance<T>& close)
+    {
+        const E1& l = lhs.self();
+        const E2& r = rhs.self();
+        for (size_t b = 0; b < N; b += vec_compare_block) {
+            const size_t e = std::min(N, b + vec_compare_block);
+            bool eq = true;
+            for (size_t i = b; i < e; ++i)
+                eq &= close(l[i], r[i]);
+            if (!eq)
+                return false;
+        }
+        return true;
+    }
+
+    // component-wise approximate comparison
+    template <typename E1, typename E2, size_t N, typename T>
+    bool approx_equal(const vec_expr<E1,N,T>& lhs, const vec_expr<E2,N,T>& rhs,
+                      const tolerance& tol)
+    {
+        return approx_equal(lhs, rhs, vec_tolerance<T>(tol));
+    }
+
+
+    // Batch comparison of lhs[k] and rhs[k] for arrays of equal size, e.g.
+    // for convergence checks. The vectors are compared in blocks, each
+    // yielding a mask of the vectors compared equal; for vec_array, the mask
+    // is computed one component at a time across the whole block.
+    const size_t vec_compare_batch = 256;
+
+    // eq[k] = whether l[k] and r[k] compare equal for k in [first, n);
+    // separate passes keep the loops free of branches
+    template <typename T>
+    void approx_equal_scalars_generic(const T* l, const T* r, size_t first,
+                                      size_t n, const vec_tolerance<T>& close,
+                                      unsigned char* eq)
+    {
+        for (size_t k = first; k < n; ++k)
+            eq[k] = close.within(l[k], r[k]);
+        if (close.ulps)
+            for (size_t k = first; k < n; ++k)
+                eq[k] |= close.within_ulps(l[k], r[k]);
+    }
+
+    // float and double are compared with the SIMD instruction set selected
+    // in vec_simd.hpp
+    template <typename T>
+    struct approx_equal_simd
+        : std::integral_constant<bool, std::is_same<T, float>::value ||
+                                       std::is_same<T, double>::value> {};
+
+#ifdef VEC_SIMD_X86
+    // unsigned integer of the given size
+    template <size_t Bytes> struct approx_equal_uint;
+    template <> struct approx_equal_uint<1> { typedef uint8_t type; };
+    template <> struct approx_equal_uint<2> { typedef uint16_t type; };
+    template <> struct approx_equal_uint<4> { typedef uint32_t type; };
+    template <> struct approx_equal_uint<8> { typedef uint64_t type; };
+
+    // Stores W lanes of 0 or 1 as bytes. They are narrowed by halving the
+    // lanes in each step, which GCC turns into packs, whereas the direct
+    // conversion extracts the lanes one by one.
+    template <size_t W, typename U>
+    VEC_SIMD_INLINE typename std::enable_if<sizeof(U) == 1>::type
+    approx_equal_store(const typename simd_vector<U,W>::type& x,
+                       unsigned char* eq)
+    {
+        std::memcpy(eq, &x, W);
+    }
+
+    template <size_t W, typename U>
+    VEC_SIMD_INLINE typename std::enable_if<(sizeof(U) > 1)>::type
+    approx_equal_store(const typename simd_vector<U,W>::type& x,
+                       unsigned char* eq)
+    {
+        typedef typename approx_equal_uint<sizeof(U) / 2>::type H;
+        const typename simd_vector<H,W>::type h =
+            __builtin_convertvector(x, typename simd_vector<H,W>::type);
+        approx_equal_store<W,H>(h, eq);
+    }
+
+    // The criteria of vec_tolerance evaluated on W lanes at a time, in the
+    // same order, so that the masks are identical to the generic ones. Each
+    // comparison selects lanes of T holding the bit pattern 1, which are
+    // reinterpreted and combined as integers; combining the comparisons
+    // directly leads GCC to compare lane by lane for AVX-512. The ULP
+    // distance maps the bit patterns like vec_ulp_distance, in unsigned
+    // arithmetic which cannot overflow.
+    template <size_t W, typename T>
+    VEC_SIMD_INLINE void approx_equal_kernel(const T* l, const T* r, size_t n,
+                                             const vec_tolerance<T>& close,
+                                             unsigned char* eq)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        typedef decltype(V() == V()) M;
+        typedef typename approx_equal_uint<sizeof(T)>::type U;
+        typedef typename simd_vector<U,W>::type VU;
+        const U lowest = U(1) << (8 * sizeof(U) - 1);
+        const U ulps = U(std::min<uint64_t>(close.ulps,
+                                            std::numeric_limits<U>::max()));
+        V zero = {}, one = {}, abs = {}, rel = {};
+        VU nil = {}, vlowest = {}, magnitude = {}, vulps = {};
+        for (size_t j = 0; j < W; ++j) {
+            one[j] = std::numeric_limits<T>::denorm_min();
+            abs[j] = close.abs;
+            rel[j] = close.rel;
+            vlowest[j] = lowest;
+            magnitude[j] = ~lowest;
+            vulps[j] = ulps;
+        }
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V x = {}, y = {};
+            std::memcpy(&x, l + k, sizeof(V));
+            std::memcpy(&y, r + k, sizeof(V));
+            // |.| clears the sign bit
+            const V d = V(VU(x - y) & magnitude);
+            const V ax = V(VU(x) & magnitude), ay = V(VU(y) & magnitude);
+            const V t = rel * (ax < ay ? ay : ax);
+            VU e = VU(x == y ? one : zero)
+                | VU(d <= (abs < t ? t : abs) ? one : zero);
+            if (ulps) {
+                VU i = {}, j = {};
+                std::memcpy(&i, l + k, sizeof(VU));
+                std::memcpy(&j, r + k, sizeof(VU));
+                i = M(i) < 0 ? vlowest - i : i;
+                j = M(j) < 0 ? vlowest - j : j;
+                const VU dist = M(i) < M(j) ? j - i : i - j;
+                e |= VU(x == x ? one : zero) & VU(y == y ? one : zero)
+                    & (dist <= vulps ? VU(one) : nil);
+            }
+            approx_equal_store<W,U>(e, eq + k);
+        }
+        approx_equal_scalars_generic(l, r, k, n, close, eq);
+    }
+
+    // per-ISA entry points; the vector width is the register size in bytes
+    // divided by the size of the scalar type
+#define VEC_COMPARE_ENTRY_POINT(isa, target, bytes)                         \
+    template <typename T>                                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void approx_equal_scalars_##isa(const T* l, const T* r, size_t n,       \
+                                    const vec_tolerance<T>& close,          \
+                                    unsigned char* eq)                      \
+    {                                                                       \
+        approx_equal_kernel<bytes / sizeof(T)>(l, r, n, close, eq);         \
+    }
+
+    VEC_COMPARE_ENTRY_POINT(sse2, "sse2", 16)
+    VEC_COMPARE_ENTRY_POINT(avx2, "avx2", 32)
+    VEC_COMPARE_ENTRY_POINT(avx512, "avx512f", 64)
+#undef VEC_COMPARE_ENTRY_POINT
+#endif
+
+    // eq[k] = whether l[k] and r[k] compare equal
+    template <typename T>
+    typename std::enable_if<!approx_equal_simd<T>::value>::type
+    approx_equal_scalars(const T* l, const T* r, size_t n,
+                         const vec_tolerance<T>& close, unsigned char* eq)
+    {
+        approx_equal_scalars_generic(l, r, 0, n, close, eq);
+    }
+
+    template <typename T>
+    typename std::enable_if<approx_equal_simd<T>::value>::type
+    approx_equal_scalars(const T* l, const T* r, size_t n,
+                         const vec_tolerance<T>& close, unsigned char* eq)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return approx_equal_scalars_avx512(l, r, n, close, eq);
+        case simd_isa::avx2: return approx_equal_scalars_avx2(l, r, n, close, eq);
+        case simd_isa::sse2: return approx_equal_scalars_sse2(l, r, n, close, eq);
+        default: break;
+        }
+#endif
+        approx_equal_scalars_generic(l, r, 0, n, close, eq);
+    }
+
+    // calls visit(first, mask, len) for consecutive blocks as long as it
+    // returns true
+    template <size_t N, typename T, typename Visit>
+    void approx_equal_blocks(const vec_array<N,T>& lhs,
+                             const vec_array<N,T>& rhs,
+                             const tolerance& tol, Visit visit)
+    {
+        const vec_tolerance<T> close(tol);
+        unsigned char mask[vec_compare_batch], eq[vec_compare_batch];
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        for (size_t b = 0; b < n; b += vec_compare_batch) {
+            const size_t len = std::min(vec_compare_batch, n - b);
+            std::fill(mask, mask + len, 1);
+            for (size_t i = 0; i < N; ++i) {
+                approx_equal_scalars(lhs.component(i) + b, rhs.component(i) + b,
+                                     len, close, eq);
+                for (size_t k = 0; k < len; ++k)
+                    mask[k] &= eq[k];
+            }
+            if (!visit(b, mask, len))
+                return;
+        }
+    }
+
+    // the components of a block are compared as one flat array
+    template <size_t N, typename T, typename Visit>
+    void approx_equal_blocks(const std::vector<vec<N,T>>& lhs,
+                             const std::vector<vec<N,T>>& rhs,
+                             const tolerance& tol, Visit visit)
+    {
+        static_assert(sizeof(vec<N,T>) == N * sizeof(T),
+                      "vec<N,T> is expected to be tightly packed");
+        const vec_tolerance<T> close(tol);
+        unsigned char mask[vec_compare_batch];
+        std::vector<unsigned char> eq(vec_compare_batch * N);
+        const size_t n = lhs.size();
+        batch_check_size(n, rhs.size());
+        for (size_t b = 0; b < n; b += vec_compare_batch) {
+            const size_t len = std::min(vec_compare_batch, n - b);
+            approx_equal_scalars(&lhs[b][0], &rhs[b][0], len * N, close,
+                                 eq.data());
+            for (size_t k = 0; k < len; ++k) {
+                unsigned char m = 1;
+                for (size_t i = 0; i < N; ++i)
+                    m &= eq[k * N + i];
+                mask[k] = m;
+            }
+            if (!visit(b, mask, len))
+                return;
+        }
+    }
+
+    // number of vectors compared equal
+    template <typename Array>
+    size_t count_approx_equal(const Array& lhs, const Array& rhs,
+                              const tolerance& tol)
+    {
+        size_t count = 0;
+        approx_equal_blocks(lhs, rhs, tol,
+            [&count](size_t, const unsigned char* mask, size_t len) {
+                for (size_t k = 0; k < len; ++k)
+                    count += mask[k];
+                return true;
+            });
+        return count;
+    }
+
+    // whether all vectors compare equal; stops at the first block which
+    // does not
+    template <typename Array>
+    bool all_approx_equal(const Array& lhs, const Array& rhs,
+                          const tolerance& tol)
+    {
+        bool all = true;
+        approx_equal_blocks(lhs, rhs, tol,
+            [&all](size_t, const unsigned char* mask, size_t len) {
+                unsigned char eq = 1;
+                for (size_t k = 0; k < len; ++k)
+                    eq &= mask[k];
+                all = eq;
+                return all;
+            });
+        return all;
+    }
+
+    // ascending indices of the vectors which do not compare equal
+    template <typename Array>
+    std::vector<size_t> find_approx_unequal(const Array& lhs, const Array& rhs,
+                                            const tolerance& tol)
+    {
+        std::vector<size_t> res;
+        approx_equal_blocks(lhs, rhs, tol,
+            [&res](size_t first, const unsigned char* mask, size_t len) {
+                for (size_t k = 0; k < len; ++k)
+                    if (!mask[k])
+                        res.push_back(first + k);
+                return true;
+            });
+        return res;
+    }
+}
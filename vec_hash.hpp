@@ -0,0 +1,633 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+
+namespace Vec {
+    // Hashing, ordering and hash containers for integral vectors, e.g.
+    // lattice sites or k-points given by vec<3,int>.
+
+    // finalizer of MurmurHash3: each input bit affects each output bit
+    constexpr uint64_t vec_hash_mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // distinct key for component i (Weyl sequence of the golden ratio)
+    constexpr uint64_t vec_hash_key(size_t i)
+    {
+        return (i + 1) * 0x9e3779b97f4a7c15ull;
+    }
+
+    // component as unsigned 64 bit integer, sign extended
+    template <typename T>
+    constexpr uint64_t vec_hash_bits(T x)
+    {
+        return uint64_t(typename std::conditional<std::is_signed<T>::value,
+                                                  int64_t, uint64_t>::type(x));
+    }
+
+    constexpr uint64_t vec_hash_fold(uint64_t x)
+    {
+        return x ^ (x >> 29);
+    }
+
+    // keys of the components, as the right operand of vec_sum
+    struct vec_hash_keys {
+	constexpr uint64_t operator[](size_t i) const
+	{
+	    return vec_hash_key(i);
+	}
+    };
+
+    struct vec_hash_term {
+	template <typename T>
+	static constexpr uint64_t apply(T x, uint64_t key)
+	{
+	    return vec_hash_fold((vec_hash_bits(x) ^ key) * 0x9e3779b97f4a7c15ull);
+	}
+    };
+
+    // 64 bit hash of an integral vector. Each component is keyed and mixed
+    // on its own, so that the components are processed independently (and
+    // in parallel, given SIMD multiplication of 64 bit integers); the
+    // results are summed and mixed once more.
+    template <size_t N, typename T>
+    constexpr uint64_t hash64(const vec<N,T>& a)
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) <= 8,
+                      "hash64 requires integral components of up to 64 bits");
+        return vec_hash_mix(vec_sum<vec_hash_term>(uint64_t(N), a,
+                                                   vec_hash_keys(),
+                                                   vec_indices<N>()));
+    }
+
+    template <size_t N, typename T>
+    struct vec_hash {
+	size_t operator()(const vec<N,T>& a) const
+	{
+	    return size_t(hash64(a));
+	}
+    };
+
+    // std::hash is only enabled for integral components
+    template <size_t N, typename T, bool = std::is_integral<T>::value>
+    struct vec_std_hash : vec_hash<N,T> {};
+
+    template <size_t N, typename T>
+    struct vec_std_hash<N, T, false> {
+	vec_std_hash() = delete;
+	vec_std_hash(const vec_std_hash&) = delete;
+	vec_std_hash& operator=(const vec_std_hash&) = delete;
+    };
+
+
+    // lexicographic order of the components
+    struct lexicographic_less {
+	template <size_t N, typename T>
+	constexpr bool operator()(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    for (size_t i = 0; i < N; ++i) {
+		if (a[i] < b[i])
+		    return true;
+		if (b[i] < a[i])
+		    return false;
+	    }
+	    return false;
+	}
+    };
+
+    // component with the sign bit flipped, so that unsigned comparison of
+    // the results orders signed integers correctly
+    template <typename T>
+    constexpr typename std::make_unsigned<T>::type vec_morton_bits(T x)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        return std::is_signed<T>::value
+            ? U(U(x) ^ (U(1) << (std::numeric_limits<U>::digits - 1)))
+            : U(x);
+    }
+
+    // Order along the Z-order (Morton) curve, i.e. of the integers formed
+    // by interleaving the bits of the components, from the most significant
+    // bit down, with component 0 the most significant within each group of
+    // N bits. Negative coordinates precede nonnegative ones. The
+    // comparison finds the component whose difference has the highest set
+    // bit without interleaving anything (Chan's method), which works for
+    // any width and number of components.
+    struct morton_less {
+	template <size_t N, typename T>
+	constexpr bool operator()(const vec<N,T>& a, const vec<N,T>& b) const
+	{
+	    static_assert(std::is_integral<T>::value,
+			  "morton_less requires integral components");
+	    typedef typename std::make_unsigned<T>::type U;
+	    size_t d = 0;
+	    U msb = 0;
+	    for (size_t i = 0; i < N; ++i) {
+		const U x = U(vec_morton_bits(a[i]) ^ vec_morton_bits(b[i]));
+		// is the highest set bit of x above that of msb?
+		if (msb < x && msb < U(msb ^ x)) {
+		    d = i;
+		    msb = x;
+		}
+	    }
+	    return vec_morton_bits(a[d]) < vec_morton_bits(b[d]);
+	}
+    };
+
+
+    const size_t flat_hash_min_capacity = 16;
+
+    // Iterator over the occupied slots of a flat_hash_table.
+    template <typename Slot, typename Ref>
+    class flat_hash_iterator {
+	template <typename, typename> friend class flat_hash_iterator;
+	const uint8_t* ctrl;
+	const uint8_t* end;
+	Slot* slot;
+
+	void skip_empty()
+	{
+	    while (ctrl != end && !*ctrl) {
+		++ctrl;
+		++slot;
+	    }
+	}
+    public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef typename std::remove_reference<Ref>::type value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef Ref reference;
+
+	flat_hash_iterator() : ctrl(nullptr), end(nullptr), slot(nullptr) {}
+
+	flat_hash_iterator(const uint8_t* c, const uint8_t* e, Slot* s)
+	    : ctrl(c), end(e), slot(s)
+	{
+	    skip_empty();
+	}
+
+	// iterator to const_iterator
+	template <typename S, typename R>
+	flat_hash_iterator(const flat_hash_iterator<S,R>& it)
+	    : ctrl(it.ctrl), end(it.end), slot(it.slot)
+	{
+	}
+
+	Ref operator*() const
+	{
+	    return *slot;
+	}
+
+	pointer operator->() const
+	{
+	    return slot;
+	}
+
+	flat_hash_iterator& operator++()
+	{
+	    ++ctrl;
+	    ++slot;
+	    skip_empty();
+	    return *this;
+	}
+
+	flat_hash_iterator operator++(int)
+	{
+	    flat_hash_iterator it = *this;
+	    ++*this;
+	    return it;
+	}
+
+	friend bool operator==(const flat_hash_iterator& lhs,
+			       const flat_hash_iterator& rhs)
+	{
+	    return lhs.ctrl == rhs.ctrl;
+	}
+
+	friend bool operator!=(const flat_hash_iterator& lhs,
+			       const flat_hash_iterator& rhs)
+	{
+	    return lhs.ctrl != rhs.ctrl;
+	}
+    };
+
+    // Open addressing hash table with linear probing, the common part of
+    // flat_hash_map and flat_hash_set.
+    //
+    // The slots are kept in a single array whose size is a power of two,
+    // alongside an array of control bytes: 0 marks an empty slot, otherwise
+    // the byte holds the top 7 bits of the hash, so that most slots along
+    // a probe sequence are ruled out without comparing keys. Erasure moves
+    // later entries of the probe sequence back instead of leaving
+    // tombstones. The table grows by a factor of two once it is 3/4 full.
+    //
+    // Insertions may invalidate all iterators and references, erasures
+    // those to the entries after the erased one.
+    template <typename Key, typename Slot, typename KeyOf,
+              typename Hash, typename Eq>
+    class flat_hash_table {
+    protected:
+	std::vector<Slot> slots;
+	std::vector<uint8_t> ctrl;
+	size_t used;
+	Hash hash_fn;
+	Eq key_eq_fn;
+
+	static uint8_t tag(size_t h)
+	{
+	    return uint8_t(0x80 | (uint64_t(h) >> 57));
+	}
+
+	size_t mask() const
+	{
+	    return slots.size() - 1;
+	}
+
+	// index of the key, or of the empty slot where it belongs
+	template <typename K>
+	std::pair<size_t, bool> probe(const K& k, size_t h) const
+	{
+	    const uint8_t t = tag(h);
+	    size_t i = h & mask();
+	    while (ctrl[i]) {
+		if (ctrl[i] == t && key_eq_fn(KeyOf::key(slots[i]), k))
+		    return {i, true};
+		i = (i + 1) & mask();
+	    }
+	    return {i, false};
+	}
+
+	void rehash(size_t n)
+	{
+	    std::vector<Slot> old_slots(n);
+	    std::vector<uint8_t> old_ctrl(n);
+	    slots.swap(old_slots);
+	    ctrl.swap(old_ctrl);
+	    for (size_t j = 0; j < old_slots.size(); ++j) {
+		if (!old_ctrl[j])
+		    continue;
+		size_t i = hash_fn(KeyOf::key(old_slots[j])) & mask();
+		while (ctrl[i])
+		    i = (i + 1) & mask();
+		slots[i] = std::move(old_slots[j]);
+		ctrl[i] = old_ctrl[j];
+	    }
+	}
+
+	// the slot of the key, which is inserted (as a default constructed
+	// slot with the key set by init) if it is not present yet
+	template <typename Init>
+	std::pair<size_t, bool> find_or_insert(const Key& k, Init init)
+	{
+	    const size_t h = hash_fn(k);
+	    std::pair<size_t, bool> p(0, false);
+	    if (!slots.empty()) {
+		p = probe(k, h);
+		if (p.second)
+		    return {p.first, false};
+	    }
+	    if (4 * (used + 1) > 3 * slots.size()) {
+		rehash(slots.empty() ? flat_hash_min_capacity : 2 * slots.size());
+		p = probe(k, h);
+	    }
+	    init(slots[p.first]);
+	    ctrl[p.first] = tag(h);
+	    ++used;
+	    return {p.first, true};
+	}
+
+	void erase_at(size_t i)
+	{
+	    // shift back the entries whose home slot does not lie in
+	    // (i, j], which would otherwise be cut off from it
+	    for (size_t j = (i + 1) & mask(); ctrl[j]; j = (j + 1) & mask()) {
+		const size_t home = hash_fn(KeyOf::key(slots[j])) & mask();
+		if (((j - home) & mask()) >= ((j - i) & mask())) {
+		    slots[i] = std::move(slots[j]);
+		    ctrl[i] = ctrl[j];
+		    i = j;
+		}
+	    }
+	    slots[i] = Slot();
+	    ctrl[i] = 0;
+	    --used;
+	}
+
+	template <typename K>
+	size_t find_index(const K& k) const
+	{
+	    if (!used)
+		return slots.size();
+	    std::pair<size_t, bool> p = probe(k, hash_fn(k));
+	    return p.second ? p.first : slots.size();
+	}
+    public:
+	typedef Key key_type;
+	typedef Hash hasher;
+	typedef Eq key_equal;
+
+	explicit flat_hash_table(size_t n = 0, const Hash& hash = Hash(),
+				 const Eq& eq = Eq())
+	    : used(0), hash_fn(hash), key_eq_fn(eq)
+	{
+	    reserve(n);
+	}
+
+	size_t size() const
+	{
+	    return used;
+	}
+
+	bool empty() const
+	{
+	    return !used;
+	}
+
+	// number of slots
+	size_t capacity() const
+	{
+	    return slots.size();
+	}
+
+	double load_factor() const
+	{
+	    return slots.empty() ? 0. : double(used) / slots.size();
+	}
+
+	// make room for n entries without rehashing
+	void reserve(size_t n)
+	{
+	    size_t c = flat_hash_min_capacity;
+	    while (4 * n > 3 * c)
+		c *= 2;
+	    if (c > slots.size())
+		rehash(c);
+	}
+
+	void clear()
+	{
+	    slots.clear();
+	    ctrl.clear();
+	    used = 0;
+	}
+
+	size_t count_key(const Key& k) const
+	{
+	    return find_index(k) != slots.size();
+	}
+
+	size_t erase(const Key& k)
+	{
+	    const size_t i = find_index(k);
+	    if (i == slots.size())
+		return 0;
+	    erase_at(i);
+	    return 1;
+	}
+
+	void swap(flat_hash_table& other)
+	{
+	    using std::swap;
+	    slots.swap(other.slots);
+	    ctrl.swap(other.ctrl);
+	    swap(used, other.used);
+	    swap(hash_fn, other.hash_fn);
+	    swap(key_eq_fn, other.key_eq_fn);
+	}
+    };
+
+    template <typename K, typename V>
+    struct flat_hash_map_key {
+	static const K& key(const std::pair<K,V>& slot)
+	{
+	    return slot.first;
+	}
+    };
+
+    template <typename K>
+    struct flat_hash_set_key {
+	static const K& key(const K& slot)
+	{
+	    return slot;
+	}
+    };
+
+    // Hash map with open addressing, see flat_hash_table. Keys and values
+    // have to be default constructible and move assignable. The entries are
+    // std::pair<Key,Value>, whose keys must not be modified through
+    // iterators.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>,
+              typename Eq = std::equal_to<Key>>
+    class flat_hash_map
+        : public flat_hash_table<Key, std::pair<Key,Value>,
+                                 flat_hash_map_key<Key,Value>, Hash, Eq> {
+	typedef flat_hash_table<Key, std::pair<Key,Value>,
+				flat_hash_map_key<Key,Value>, Hash, Eq> base;
+    public:
+	typedef Value mapped_type;
+	typedef std::pair<Key,Value> value_type;
+	typedef flat_hash_iterator<value_type, value_type&> iterator;
+	typedef flat_hash_iterator<const value_type, const value_type&>
+	    const_iterator;
+
+	using base::base;
+
+	iterator begin()
+	{
+	    return {this->ctrl.data(), this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data()};
+	}
+
+	iterator end()
+	{
+	    const uint8_t* e = this->ctrl.data() + this->ctrl.size();
+	    return {e, e, this->slots.data() + this->slots.size()};
+	}
+
+	const_iterator begin() const
+	{
+	    return {this->ctrl.data(), this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data()};
+	}
+
+	const_iterator end() const
+	{
+	    const uint8_t* e = this->ctrl.data() + this->ctrl.size();
+	    return {e, e, this->slots.data() + this->slots.size()};
+	}
+
+	iterator find(const Key& k)
+	{
+	    const size_t i = this->find_index(k);
+	    return i == this->slots.size() ? end() : at_index(i);
+	}
+
+	const_iterator find(const Key& k) const
+	{
+	    const size_t i = this->find_index(k);
+	    return i == this->slots.size() ? end() : at_index(i);
+	}
+
+	size_t count(const Key& k) const
+	{
+	    return this->count_key(k);
+	}
+
+	Value& at(const Key& k)
+	{
+	    const size_t i = this->find_index(k);
+	    if (i == this->slots.size())
+		throw std::out_of_range("key not in flat_hash_map");
+	    return this->slots[i].second;
+	}
+
+	const Value& at(const Key& k) const
+	{
+	    const size_t i = this->find_index(k);
+	    if (i == this->slots.size())
+		throw std::out_of_range("key not in flat_hash_map");
+	    return this->slots[i].second;
+	}
+
+	// inserts a value constructed from args unless the key is present
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(const Key& k, Args&&... args)
+	{
+	    std::pair<size_t, bool> p = this->find_or_insert(k,
+		[&](value_type& slot) {
+		    slot.first = k;
+		    slot.second = Value(std::forward<Args>(args)...);
+		});
+	    return {at_index(p.first), p.second};
+	}
+
+	std::pair<iterator, bool> insert(const value_type& kv)
+	{
+	    return try_emplace(kv.first, kv.second);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& kv)
+	{
+	    return try_emplace(kv.first, std::move(kv.second));
+	}
+
+	Value& operator[](const Key& k)
+	{
+	    std::pair<size_t, bool> p = this->find_or_insert(k,
+		[&](value_type& slot) { slot.first = k; });
+	    return this->slots[p.first].second;
+	}
+
+	friend void swap(flat_hash_map& lhs, flat_hash_map& rhs)
+	{
+	    lhs.swap(rhs);
+	}
+    private:
+	iterator at_index(size_t i)
+	{
+	    return {this->ctrl.data() + i,
+		    this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data() + i};
+	}
+
+	const_iterator at_index(size_t i) const
+	{
+	    return {this->ctrl.data() + i,
+		    this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data() + i};
+	}
+    };
+
+    // Hash set with open addressing, see flat_hash_table.
+    template <typename Key, typename Hash = std::hash<Key>,
+              typename Eq = std::equal_to<Key>>
+    class flat_hash_set
+        : public flat_hash_table<Key, Key, flat_hash_set_key<Key>, Hash, Eq> {
+	typedef flat_hash_table<Key, Key, flat_hash_set_key<Key>, Hash, Eq>
+	    base;
+    public:
+	typedef Key value_type;
+	typedef flat_hash_iterator<const Key, const Key&> const_iterator;
+	typedef const_iterator iterator;
+
+	using base::base;
+
+	const_iterator begin() const
+	{
+	    return {this->ctrl.data(), this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data()};
+	}
+
+	const_iterator end() const
+	{
+	    const uint8_t* e = this->ctrl.data() + this->ctrl.size();
+	    return {e, e, this->slots.data() + this->slots.size()};
+	}
+
+	const_iterator find(const Key& k) const
+	{
+	    const size_t i = this->find_index(k);
+	    if (i == this->slots.size())
+		return end();
+	    return {this->ctrl.data() + i,
+		    this->ctrl.data() + this->ctrl.size(),
+		    this->slots.data() + i};
+	}
+
+	size_t count(const Key& k) const
+	{
+	    return this->count_key(k);
+	}
+
+	std::pair<const_iterator, bool> insert(const Key& k)
+	{
+	    std::pair<size_t, bool> p = this->find_or_insert(k,
+		[&](Key& slot) { slot = k; });
+	    return {const_iterator(this->ctrl.data() + p.first,
+				   this->ctrl.data() + this->ctrl.size(),
+				   this->slots.data() + p.first),
+		    p.second};
+	}
+
+	friend void swap(flat_hash_set& lhs, flat_hash_set& rhs)
+	{
+	    lhs.swap(rhs);
+	}
+    };
+}
+
+namespace std {
+    template <size_t N, typename T>
+    struct hash<Vec::vec<N,T>> : Vec::vec_std_hash<N,T> {};
+}
@@ -0,0 +1,486 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+#include "vec_aligned.hpp"
+#include "vec_parallel.hpp"
+
+// asserts that the iterations of the following loop are independent, which
+// holds for component-wise loops even if the output is also an operand
+#if defined(__clang__)
+#define VEC_HEAP_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define VEC_HEAP_IVDEP _Pragma("GCC ivdep")
+#else
+#define VEC_HEAP_IVDEP
+#endif
+
+namespace Vec {
+    // Vectors of many components, e.g. wavefunction amplitudes
+    // vec<512,std::complex<double>>, with storage on the heap.
+    //
+    // Unlike vec, which keeps its components in place and whose copies are
+    // copies of the whole array, heap_vec owns an aligned buffer which moves
+    // along when the vector is moved. Through vec_expr, it takes part in the
+    // expression templates of vec: `c = a + 2.*b` is evaluated in a single
+    // loop without temporaries. Operators on rvalue heap_vecs additionally
+    // reuse their buffer, e.g. `f(x) + y` adds y to the result of f in
+    // place and returns it.
+    //
+    // Component-wise loops are vectorized without alias checks: in a single
+    // loop over all components, or in blocks of heap_vec_block components
+    // where the bounds are only known at run time. Dot products and norms
+    // accumulate eight partial sums to hide the latency of the additions,
+    // so that their results may differ from those of vec in the last bits.
+    // Vectors of heap_vec_parallel_size or more components are processed in
+    // chunks of heap_vec_grain_size on the global thread_pool (link with
+    // -pthread); the chunking of reductions does not depend on the number of
+    // threads, so neither do their results.
+    //
+    // A moved-from heap_vec has no storage; it may only be assigned to or
+    // destroyed.
+    const size_t heap_vec_block = 32;
+    const size_t heap_vec_parallel_size = 1 << 18;
+    const size_t heap_vec_grain_size = 1 << 15;
+
+    // f(i) for i in [first, last), in blocks of constant length, which the
+    // compiler vectorizes even where it would not version the whole loop
+    template <typename F>
+    void heap_vec_blocked(size_t first, size_t last, F f)
+    {
+        const size_t blocks = (last - first) / heap_vec_block;
+        for (size_t k = 0; k < blocks; ++k) {
+            const size_t b = first + k * heap_vec_block;
+            VEC_HEAP_IVDEP
+            for (size_t j = 0; j < heap_vec_block; ++j)
+                f(b + j);
+        }
+        VEC_HEAP_IVDEP
+        for (size_t i = first + blocks * heap_vec_block; i < last; ++i)
+            f(i);
+    }
+
+    // f(i) for i in [0, N); long ranges are split into chunks for the
+    // global thread pool, short ones run in a single loop of constant length
+    template <size_t N, typename F>
+    void heap_vec_for(F f)
+    {
+        if (N >= heap_vec_parallel_size) {
+            thread_pool::global().parallel_for(N, [f](size_t b, size_t e) {
+                heap_vec_blocked(b, e, f);
+            }, heap_vec_grain_size);
+        } else {
+            VEC_HEAP_IVDEP
+            for (size_t i = 0; i < N; ++i)
+                f(i);
+        }
+    }
+
+    // sum of f(begin, end) over chunks of [0, n), added up in order
+    template <typename C, typename F>
+    C heap_vec_reduce(size_t n, F f)
+    {
+        if (n < heap_vec_parallel_size)
+            return f(size_t(0), n);
+        const size_t m = (n + heap_vec_grain_size - 1) / heap_vec_grain_size;
+        std::vector<C> partial(m);
+        thread_pool::global().parallel_for(m, [&](size_t b, size_t e) {
+            for (size_t c = b; c < e; ++c)
+                partial[c] = f(c * heap_vec_grain_size,
+                               std::min(n, (c + 1) * heap_vec_grain_size));
+        }, 1);
+        C sum = partial[0];
+        for (size_t c = 1; c < m; ++c)
+            sum += partial[c];
+        return sum;
+    }
+
+    // sum of Term::apply(a[i], b[i]) over [first, last) in eight partial
+    // sums, which are independent and kept in registers, combined pairwise
+    template <typename C, typename Term, typename A, typename B>
+    C heap_vec_sum(const A* a, const B* b, size_t first, size_t last)
+    {
+        C s0 = C(), s1 = C(), s2 = C(), s3 = C();
+        C s4 = C(), s5 = C(), s6 = C(), s7 = C();
+        size_t i = first;
+        for (; i + 8 <= last; i += 8) {
+            s0 += Term::apply(a[i], b[i]);
+            s1 += Term::apply(a[i + 1], b[i + 1]);
+            s2 += Term::apply(a[i + 2], b[i + 2]);
+            s3 += Term::apply(a[i + 3], b[i + 3]);
+            s4 += Term::apply(a[i + 4], b[i + 4]);
+            s5 += Term::apply(a[i + 5], b[i + 5]);
+            s6 += Term::apply(a[i + 6], b[i + 6]);
+            s7 += Term::apply(a[i + 7], b[i + 7]);
+        }
+        for (; i < last; ++i)
+            s0 += Term::apply(a[i], b[i]);
+        return ((s0 + s4) + (s2 + s6)) + ((s1 + s5) + (s3 + s7));
+    }
+
+    // conj(a) * b expanded by hand, which unlike the complex product does
+    // not guard against NaN and inf (identical results for finite data)
+    struct heap_vec_cdot_term {
+	template <typename S>
+	static std::complex<S> apply(const std::complex<S>& a,
+				     const std::complex<S>& b)
+	{
+	    return {a.real() * b.real() + a.imag() * b.imag(),
+		    a.real() * b.imag() - a.imag() * b.real()};
+	}
+    };
+
+
+    template <size_t N, typename T = double, size_t Align = 64>
+    class heap_vec : public vec_expr<heap_vec<N,T,Align>, N, T> {
+	static_assert(N > 0, "vec may not be zero-dimensional");
+	static_assert(std::is_trivially_copyable<T>::value
+		      && std::is_trivially_destructible<T>::value,
+		      "heap_vec requires trivially copyable components");
+    private:
+	typedef aligned_allocator<T, Align> allocator;
+
+	T* data_;
+
+	// data_[i] = Op::apply(data_[i], e[i]) for all components; data_ may
+	// be uninitialized for vec_assign
+	template <typename Op, typename E>
+	void apply(const E& e)
+	{
+	    T* p = data_;
+	    heap_vec_for<N>([p, &e](size_t i) {
+		p[i] = Op::apply(p[i], T(e[i]));
+	    });
+	}
+
+	template <typename Op>
+	void apply_scalar(const T& val)
+	{
+	    apply<Op>(vec_scalar<N,T>(val));
+	}
+    public:
+	// constructors
+	heap_vec() : data_(allocator().allocate(N))
+	{
+	    apply_scalar<vec_assign>(T());
+	}
+
+	heap_vec(const T& val) : data_(allocator().allocate(N))
+	{
+	    apply_scalar<vec_assign>(val);
+	}
+
+	heap_vec(const T* p) : data_(allocator().allocate(N))
+	{
+	    std::copy(p, p + N, data_);
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	heap_vec(const vec_expr<E, N, T2>& x) : data_(allocator().allocate(N))
+	{
+	    apply<vec_assign>(x.self());
+	}
+
+	heap_vec(std::initializer_list<T> il) : data_(allocator().allocate(N))
+	{
+	    const size_t n = std::min(il.size(), N);
+	    std::copy(il.begin(), il.begin() + n, data_);
+	    std::fill(data_ + n, data_ + N, T());
+	}
+
+	heap_vec(const heap_vec& o) : data_(allocator().allocate(N))
+	{
+	    apply<vec_assign>(o);
+	}
+
+	heap_vec(heap_vec&& o) noexcept : data_(o.data_)
+	{
+	    o.data_ = nullptr;
+	}
+
+	~heap_vec()
+	{
+	    if (data_)
+		allocator().deallocate(data_, N);
+	}
+
+
+	// assignment operators
+	heap_vec& operator=(const heap_vec& o)
+	{
+	    if (this != &o) {
+		if (!data_)
+		    data_ = allocator().allocate(N);
+		apply<vec_assign>(o);
+	    }
+	    return *this;
+	}
+
+	// swaps the buffers; the previous one is released along with o
+	heap_vec& operator=(heap_vec&& o) noexcept
+	{
+	    std::swap(data_, o.data_);
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	heap_vec& operator=(const vec_expr<E, N, T2>& x)
+	{
+	    if (!data_)
+		data_ = allocator().allocate(N);
+	    apply<vec_assign>(x.self());
+	    return *this;
+	}
+
+	void swap(heap_vec& o) noexcept
+	{
+	    std::swap(data_, o.data_);
+	}
+
+
+	// element access
+	const T& operator[](size_t i) const
+	{
+	    return data_[i];
+	}
+
+	T& operator[](size_t i)
+	{
+	    return data_[i];
+	}
+
+	// contiguous storage aligned to Align bytes
+	const T* data() const
+	{
+	    return data_;
+	}
+
+	T* data()
+	{
+	    return data_;
+	}
+
+	static constexpr size_t size()
+	{
+	    return N;
+	}
+
+
+	// compound assignment
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	heap_vec& operator+= (const vec_expr<E, N, T2>& rhs)
+	{
+	    apply<vec_plus>(rhs.self());
+	    return *this;
+	}
+
+	template <typename E, typename T2,
+		    typename = typename std::enable_if<
+			std::is_convertible<T2, T>::value, T2>::type>
+	heap_vec& operator-= (const vec_expr<E, N, T2>& rhs)
+	{
+	    apply<vec_minus>(rhs.self());
+	    return *this;
+	}
+
+	heap_vec& operator*= (const T& val)
+	{
+	    apply_scalar<vec_multiplies>(val);
+	    return *this;
+	}
+
+	heap_vec& operator/= (const T& val)
+	{
+	    apply_scalar<vec_divides>(val);
+	    return *this;
+	}
+
+	// flips the sign in place
+	void negate()
+	{
+	    T* p = data_;
+	    heap_vec_for<N>([p](size_t i) { p[i] = -p[i]; });
+	}
+
+
+	// norm
+	typename norm_type<T>::type norm2_sq() const;
+
+	typename norm_type<T>::type norm() const
+	{
+	    return std::sqrt(norm2_sq());
+	}
+
+	template <typename..., typename S = T>
+	typename std::enable_if<is_complex<S>::value, void>::type
+	conj()
+	{
+	    T* p = data_;
+	    heap_vec_for<N>([p](size_t i) { p[i] = std::conj(p[i]); });
+	}
+    };
+
+    // heap vecs are captured by reference in expressions, like vecs
+    template <size_t N, typename T, size_t Align>
+    struct vec_expr_ref<heap_vec<N,T,Align>> {
+	typedef const heap_vec<N,T,Align>& type;
+    };
+
+    template <size_t N, typename T, size_t Align>
+    void swap(heap_vec<N,T,Align>& a, heap_vec<N,T,Align>& b) noexcept
+    {
+        a.swap(b);
+    }
+
+
+    // dot products and norms
+    template <size_t N, typename A, typename B, size_t Align,
+              typename C = decltype(A()*B())>
+    typename std::enable_if<std::is_arithmetic<A>::value, C>::type
+    operator*(const heap_vec<N,A,Align>& lhs, const heap_vec<N,B,Align>& rhs)
+    {
+        const A* a = lhs.data();
+        const B* b = rhs.data();
+        return heap_vec_reduce<C>(N, [a, b](size_t first, size_t last) {
+            return heap_vec_sum<C, vec_dot_term>(a, b, first, last);
+        });
+    }
+
+    template <size_t N, typename S, size_t Align>
+    std::complex<S> operator*(const heap_vec<N,std::complex<S>,Align>& lhs,
+                              const heap_vec<N,std::complex<S>,Align>& rhs)
+    {
+        typedef std::complex<S> C;
+        const C* a = lhs.data();
+        const C* b = rhs.data();
+        return heap_vec_reduce<C>(N, [a, b](size_t first, size_t last) {
+            return heap_vec_sum<C, heap_vec_cdot_term>(a, b, first, last);
+        });
+    }
+
+    template <size_t N, typename T, size_t Align>
+    typename norm_type<T>::type heap_vec<N,T,Align>::norm2_sq() const
+    {
+        typedef typename norm_type<T>::type R;
+        typedef typename std::conditional<is_complex<T>::value,
+                                          vec_norm2_term, vec_dot_term>::type
+            term;
+        const T* a = data_;
+        return heap_vec_reduce<R>(N, [a](size_t first, size_t last) {
+            return heap_vec_sum<R, term>(a, a, first, last);
+        });
+    }
+
+
+    // Operators on rvalues evaluate into the rvalue's buffer and return it,
+    // so that chains of calls like `f(x) + g(y) - z` need no new buffers.
+    // Expressions of lvalues remain lazy.
+    template <size_t N, typename T, size_t Align>
+    heap_vec<N,T,Align> operator- (heap_vec<N,T,Align>&& rhs)
+    {
+        rhs.negate();
+        return std::move(rhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename E, typename B>
+    heap_vec<N,T,Align> operator+ (heap_vec<N,T,Align>&& lhs,
+                                   const vec_expr<E,N,B>& rhs)
+    {
+        lhs += rhs;
+        return std::move(lhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename E, typename A>
+    heap_vec<N,T,Align> operator+ (const vec_expr<E,N,A>& lhs,
+                                   heap_vec<N,T,Align>&& rhs)
+    {
+        rhs += lhs;
+        return std::move(rhs);
+    }
+
+    template <size_t N, typename T, size_t Align>
+    heap_vec<N,T,Align> operator+ (heap_vec<N,T,Align>&& lhs,
+                                   heap_vec<N,T,Align>&& rhs)
+    {
+        lhs += rhs;
+        return std::move(lhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename E, typename B>
+    heap_vec<N,T,Align> operator- (heap_vec<N,T,Align>&& lhs,
+                                   const vec_expr<E,N,B>& rhs)
+    {
+        lhs -= rhs;
+        return std::move(lhs);
+    }
+
+    template <size_t N, typename T, size_t Align>
+    heap_vec<N,T,Align> operator- (heap_vec<N,T,Align>&& lhs,
+                                   heap_vec<N,T,Align>&& rhs)
+    {
+        lhs -= rhs;
+        return std::move(lhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type>
+    heap_vec<N,T,Align> operator* (const S& val, heap_vec<N,T,Align>&& rhs)
+    {
+        rhs *= T(val);
+        return std::move(rhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type>
+    heap_vec<N,T,Align> operator* (heap_vec<N,T,Align>&& lhs, const S& val)
+    {
+        lhs *= T(val);
+        return std::move(lhs);
+    }
+
+    template <size_t N, typename T, size_t Align, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value>::type>
+    heap_vec<N,T,Align> operator/ (heap_vec<N,T,Align>&& lhs, const S& val)
+    {
+        lhs /= T(val);
+        return std::move(lhs);
+    }
+
+
+    // complex conjugation
+    template <size_t N, typename T, size_t Align>
+    typename std::enable_if<is_complex<T>::value, heap_vec<N,T,Align>>::type
+    conj(heap_vec<N,T,Align> c)
+    {
+        c.conj();
+        return c;
+    }
+}
@@ -0,0 +1,362 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VEC_IO_MMAP
+#endif
+
+namespace Vec {
+    // Binary format for contiguous sequences of vec<N,T>: a 32 byte header
+    // followed by the raw components in native layout. Since the header
+    // size is a multiple of the alignment of any scalar type, a mapped file
+    // can be viewed as an array of vec<N,T> in place.
+    struct vec_file_header {
+	char magic[4];          // "VEC\0"
+	uint8_t version;
+	uint8_t byte_order;     // 1: little endian, 2: big endian
+	uint8_t type;           // vec_type_tag of the scalar type
+	uint8_t scalar_size;    // sizeof(T)
+	uint32_t dim;           // N
+	uint32_t reserved;
+	uint64_t count;         // number of vectors; unknown_count if unknown
+	uint64_t reserved2;
+
+	static const uint64_t unknown_count = ~uint64_t(0);
+    };
+
+    static_assert(sizeof(vec_file_header) == 32, "header layout");
+
+    inline uint8_t vec_byte_order()
+    {
+        const uint16_t probe = 1;
+        uint8_t low;
+        std::memcpy(&low, &probe, 1);
+        return low ? 1 : 2;
+    }
+
+    // type tags of the supported scalar types; integers are identified by
+    // their width and signedness, so that e.g. long and long long match
+    template <typename T, typename = void>
+    struct vec_type_tag;
+
+    template <typename T>
+    struct vec_type_tag<T, typename std::enable_if<
+                               std::is_integral<T>::value>::type> {
+	static const uint8_t value = (sizeof(T) == 1 ? 1 : sizeof(T) == 2 ? 3
+				       : sizeof(T) == 4 ? 5 : 7)
+	    + std::is_unsigned<T>::value;
+    };
+
+    template <> struct vec_type_tag<float> {
+	static const uint8_t value = 9;
+    };
+
+    template <> struct vec_type_tag<double> {
+	static const uint8_t value = 10;
+    };
+
+    template <> struct vec_type_tag<long double> {
+	static const uint8_t value = 11;
+    };
+
+    template <typename S>
+    struct vec_type_tag<std::complex<S>> {
+	static_assert(std::is_floating_point<S>::value,
+		      "only complex floating point types are supported");
+	static const uint8_t value = vec_type_tag<S>::value + 16;
+    };
+
+    template <size_t N, typename T>
+    vec_file_header make_vec_file_header(uint64_t count)
+    {
+        static_assert(sizeof(vec<N,T>) == N * sizeof(T),
+                      "vec must not be padded for binary I/O");
+        vec_file_header h = {{'V', 'E', 'C', '\0'}, 1, vec_byte_order(),
+                             vec_type_tag<T>::value, uint8_t(sizeof(T)),
+                             uint32_t(N), 0, count, 0};
+        return h;
+    }
+
+    // throws std::runtime_error unless the header describes vec<N,T>
+    template <size_t N, typename T>
+    void check_vec_file_header(const vec_file_header& h)
+    {
+        const vec_file_header ref = make_vec_file_header<N,T>(0);
+        if (std::memcmp(h.magic, ref.magic, sizeof(h.magic)) != 0)
+            throw std::runtime_error("not a vec file");
+        if (h.version != ref.version)
+            throw std::runtime_error("unsupported vec file version");
+        if (h.byte_order != ref.byte_order)
+            throw std::runtime_error("vec file has foreign byte order");
+        if (h.type != ref.type || h.scalar_size != ref.scalar_size)
+            throw std::runtime_error("vec file has different scalar type");
+        if (h.dim != ref.dim)
+            throw std::runtime_error("vec file has different dimension");
+    }
+
+
+    // Streaming writer. The count in the header is filled in by close() (or
+    // the destructor) if the stream is seekable; otherwise it is left
+    // unknown and readers infer it from the file size.
+    template <size_t N, typename T>
+    class vec_writer {
+    private:
+	std::unique_ptr<std::ofstream> file;
+	std::ostream* os;
+	std::streampos start;
+	uint64_t count;
+    public:
+	explicit vec_writer(std::ostream& o) : os(&o), count(0)
+	{
+	    write_header();
+	}
+
+	explicit vec_writer(const std::string& path)
+	    : file(new std::ofstream(path, std::ios::binary | std::ios::trunc)),
+	      os(file.get()), count(0)
+	{
+	    if (!*file)
+		throw std::runtime_error("cannot open " + path);
+	    write_header();
+	}
+
+	vec_writer(const vec_writer&) = delete;
+	vec_writer& operator=(const vec_writer&) = delete;
+
+	~vec_writer()
+	{
+	    if (os) {
+		try {
+		    close();
+		} catch (...) {}
+	    }
+	}
+
+	void write(const vec<N,T>& v)
+	{
+	    write(&v, 1);
+	}
+
+	void write(const vec<N,T>* v, size_t n)
+	{
+	    os->write(reinterpret_cast<const char*>(v), n * sizeof(vec<N,T>));
+	    if (!*os)
+		throw std::runtime_error("writing vec file failed");
+	    count += n;
+	}
+
+	template <typename InputIt>
+	void write(InputIt first, InputIt last)
+	{
+	    for (; first != last; ++first)
+		write(vec<N,T>(*first));
+	}
+
+	uint64_t size() const
+	{
+	    return count;
+	}
+
+	// patch the count into the header and flush
+	void close()
+	{
+	    if (!os)
+		return;
+	    std::ostream& o = *os;
+	    os = nullptr;
+	    if (start != std::streampos(-1)) {
+		const std::streampos end = o.tellp();
+		o.seekp(start + std::streamoff(offsetof(vec_file_header, count)));
+		o.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		o.seekp(end);
+	    }
+	    o.flush();
+	    if (file)
+		file->close();
+	    if (!o)
+		throw std::runtime_error("writing vec file failed");
+	}
+    private:
+	void write_header()
+	{
+	    start = os->tellp();
+	    const vec_file_header h = make_vec_file_header<N,T>(
+		vec_file_header::unknown_count);
+	    os->write(reinterpret_cast<const char*>(&h), sizeof(h));
+	    if (!*os)
+		throw std::runtime_error("writing vec file failed");
+	}
+    };
+
+
+    // reads a whole vec file from a stream into memory
+    template <size_t N, typename T>
+    std::vector<vec<N,T>> read_vecs(std::istream& is)
+    {
+        vec_file_header h;
+        if (!is.read(reinterpret_cast<char*>(&h), sizeof(h)))
+            throw std::runtime_error("not a vec file");
+        check_vec_file_header<N,T>(h);
+        std::vector<vec<N,T>> res;
+        if (h.count != vec_file_header::unknown_count) {
+            // The count is not trusted with an allocation: a seekable
+            // stream must hold that many vectors, any other is read in
+            // chunks until it ends.
+            const std::streampos pos = is.tellg();
+            if (pos != std::streampos(-1) && is.seekg(0, std::ios::end)) {
+                const std::streamoff avail = is.tellg() - pos;
+                is.seekg(pos);
+                if (avail < 0 || uint64_t(avail) / sizeof(vec<N,T>) < h.count)
+                    throw std::runtime_error("vec file is truncated");
+            }
+            is.clear();
+            const uint64_t chunk = uint64_t(1) << 16;
+            while (res.size() < h.count) {
+                const size_t k = res.size();
+                res.resize(k + size_t(std::min(chunk, h.count - k)));
+                const size_t bytes = (res.size() - k) * sizeof(vec<N,T>);
+                is.read(reinterpret_cast<char*>(res.data() + k), bytes);
+                if (size_t(is.gcount()) != bytes)
+                    throw std::runtime_error("vec file is truncated");
+            }
+        } else {
+            vec<N,T> v;
+            while (is.read(reinterpret_cast<char*>(&v), sizeof(v)))
+                res.push_back(v);
+        }
+        return res;
+    }
+
+#ifdef VEC_IO_MMAP
+    // Read-only memory mapping of a vec file. The elements are vec<N,T>
+    // living directly on the mapped pages; nothing is copied and pages are
+    // only read from disk when accessed.
+    template <size_t N, typename T>
+    class vec_mapped_file {
+    private:
+	void* addr;
+	size_t length;
+	const vec<N,T>* first;
+	size_t count;
+    public:
+	typedef vec<N,T> value_type;
+	typedef const vec<N,T>* const_iterator;
+
+	explicit vec_mapped_file(const std::string& path)
+	    : addr(nullptr), length(0), first(nullptr), count(0)
+	{
+	    const int fd = ::open(path.c_str(), O_RDONLY);
+	    if (fd < 0)
+		throw std::runtime_error("cannot open " + path);
+	    struct stat st;
+	    if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(vec_file_header)) {
+		::close(fd);
+		throw std::runtime_error("not a vec file: " + path);
+	    }
+	    length = size_t(st.st_size);
+	    addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	    ::close(fd);
+	    if (addr == MAP_FAILED) {
+		addr = nullptr;
+		throw std::runtime_error("cannot map " + path);
+	    }
+	    try {
+		const vec_file_header& h = *static_cast<const vec_file_header*>(addr);
+		check_vec_file_header<N,T>(h);
+		const size_t avail = (length - sizeof(h)) / sizeof(vec<N,T>);
+		if (h.count == vec_file_header::unknown_count)
+		    count = avail;
+		else if (h.count <= avail)
+		    count = size_t(h.count);
+		else
+		    throw std::runtime_error("vec file is truncated");
+	    } catch (...) {
+		::munmap(addr, length);
+		throw;
+	    }
+	    first = reinterpret_cast<const vec<N,T>*>(
+		static_cast<const char*>(addr) + sizeof(vec_file_header));
+	}
+
+	vec_mapped_file(vec_mapped_file&& o)
+	    : addr(o.addr), length(o.length), first(o.first), count(o.count)
+	{
+	    o.addr = nullptr;
+	}
+
+	vec_mapped_file& operator=(vec_mapped_file&& o)
+	{
+	    std::swap(addr, o.addr);
+	    std::swap(length, o.length);
+	    std::swap(first, o.first);
+	    std::swap(count, o.count);
+	    return *this;
+	}
+
+	~vec_mapped_file()
+	{
+	    if (addr)
+		::munmap(addr, length);
+	}
+
+	size_t size() const
+	{
+	    return count;
+	}
+
+	const vec<N,T>* data() const
+	{
+	    return first;
+	}
+
+	const vec<N,T>& operator[](size_t k) const
+	{
+	    return first[k];
+	}
+
+	const_iterator begin() const
+	{
+	    return first;
+	}
+
+	const_iterator end() const
+	{
+	    return first + count;
+	}
+    };
+#endif
+}
@@ -0,0 +1,542 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+#include "vec_parallel.hpp"
+#include "vec_simd.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VEC_LLG_INLINE inline __attribute__((always_inline))
+#else
+#define VEC_LLG_INLINE inline
+#endif
+#define VEC_LLG_NO_CONTRACT VEC_SIMD_NO_CONTRACT
+
+namespace Vec {
+    // Landau-Lifshitz-Gilbert dynamics of unit spins s_k, in the
+    // Landau-Lifshitz form
+    //
+    //     ds/dt = -gamma / (1 + alpha^2) (s x h + alpha s x (s x h))
+    //
+    // with the gyromagnetic ratio gamma, the Gilbert damping alpha and the
+    // effective field h_k, which is supplied by the caller. Two schemes of
+    // second order are available, each evaluating the field twice per step:
+    //
+    //  - heun: the predictor s + dt f(s) and the corrector s + dt/2 (f(s) +
+    //    f(p)) are projected back onto the unit sphere.
+    //  - midpoint: the semi-implicit scheme of Mentink et al. (J. Phys.:
+    //    Condens. Matter 22, 176001 (2010)). Writing the right hand side as
+    //    s x a(s, h), each stage solves s' = s + dt (s + s') / 2 x a for s'
+    //    in closed form, which is a rotation of s and thus conserves |s|;
+    //    the predictor only provides the midpoint at which the corrector
+    //    evaluates a. Without damping, the energy of spins in a static field
+    //    is conserved up to rounding.
+    //
+    // Each stage is a single pass over the spins, which fuses both cross
+    // products, the damping term and the renormalization, and is
+    // distributed over a thread_pool. The pass loads the spins W at a time,
+    // with the x, y and z components in separate vectors, so that the
+    // arithmetic is vectorized across the spins with the instruction set
+    // selected in vec_simd.hpp; only the square roots of the
+    // renormalization are taken one by one. As all lanes do the same
+    // operations in the same order, results depend neither on the
+    // instruction set nor on the number of threads.
+    enum class llg_scheme { heun, midpoint };
+
+    const size_t llg_grain_size = 1 << 12;
+
+    template <typename T>
+    struct llg_coeffs {
+	T g;        // gamma / (1 + alpha^2)
+	T alpha;
+	T dt;
+    };
+
+    // W spins in parallel: a GCC vector for W > 1, otherwise the scalar
+    template <typename T, size_t W>
+    struct llg_vector;
+
+    template <typename T>
+    struct llg_vector<T,1> {
+	typedef T type;
+    };
+
+#ifdef VEC_SIMD_X86
+    template <typename T, size_t W>
+    struct llg_vector {
+	typedef typename simd_vector<T,W>::type type;
+    };
+#endif
+
+    // The arrays a stage works on: the spins s, the field h and the scratch
+    // arrays f and p, each of them as vec<3,T>.
+    enum llg_array { llg_s, llg_h, llg_f, llg_p, llg_arrays };
+
+    // the W spins at src, with component i of spin l in lane l of v[i]
+    template <size_t W, typename V, typename T>
+    VEC_LLG_INLINE void llg_load(const T* src, V (&v)[3])
+    {
+        T t[3][W];
+        for (size_t l = 0; l < W; ++l)
+            for (size_t i = 0; i < 3; ++i)
+                t[i][l] = src[l*3+i];
+        for (size_t i = 0; i < 3; ++i)
+            std::memcpy(&v[i], t[i], sizeof(V));
+    }
+
+    template <size_t W, typename V, typename T>
+    VEC_LLG_INLINE void llg_store(const V (&v)[3], T* dst)
+    {
+        T t[3][W];
+        for (size_t i = 0; i < 3; ++i)
+            std::memcpy(t[i], &v[i], sizeof(V));
+        for (size_t l = 0; l < W; ++l)
+            for (size_t i = 0; i < 3; ++i)
+                dst[l*3+i] = t[i][l];
+    }
+
+#if defined(VEC_SIMD_X86) && !defined(__clang__)
+    // With GCC, the components are gathered from, and scattered to, the
+    // three vectors of 3 W consecutive scalars by pairs of shuffles: the
+    // first one of each pair combines two of the vectors, the second one
+    // fills in the lanes from the third.
+    template <typename T, size_t W>
+    struct llg_shuffle {
+	typedef typename std::conditional<sizeof(T) == 8, long long,
+					  int>::type I;
+	typedef typename simd_vector<I,W>::type mask;
+
+	// lane l of component i is scalar 3 l + i
+	static constexpr I gather(size_t i, bool first, size_t l)
+	{
+	    return I(3 * l + i < 2 * W ? (first ? 3 * l + i : l)
+		     : (first ? 0 : 3 * l + i - W));
+	}
+
+	// lane l of vector j is component (j W + l) % 3 of spin (j W + l) / 3
+	static constexpr I scatter(size_t j, bool first, size_t l)
+	{
+	    return I((j * W + l) % 3 == 2 ? (first ? 0 : W + (j * W + l) / 3)
+		     : (first ? (j * W + l) % 3 * W + (j * W + l) / 3 : l));
+	}
+
+	template <typename V, size_t... L>
+	static VEC_LLG_INLINE void load(const V (&r)[3], size_t i, V& v,
+					std::index_sequence<L...>)
+	{
+	    const mask m1 = {gather(i, true, L)...};
+	    const mask m2 = {gather(i, false, L)...};
+	    v = __builtin_shuffle(__builtin_shuffle(r[0], r[1], m1), r[2], m2);
+	}
+
+	template <typename V, size_t... L>
+	static VEC_LLG_INLINE void store(const V (&v)[3], size_t j, V& r,
+					 std::index_sequence<L...>)
+	{
+	    const mask m1 = {scatter(j, true, L)...};
+	    const mask m2 = {scatter(j, false, L)...};
+	    r = __builtin_shuffle(__builtin_shuffle(v[0], v[1], m1), v[2], m2);
+	}
+    };
+
+    template <size_t W, typename T>
+    VEC_LLG_INLINE void llg_load(const T* src,
+                                 typename simd_vector<T,W>::type (&v)[3])
+    {
+        typedef llg_shuffle<T,W> S;
+        typename simd_vector<T,W>::type r[3];
+        std::memcpy(&r[0], src, sizeof(r[0]));
+        std::memcpy(&r[1], src + W, sizeof(r[1]));
+        std::memcpy(&r[2], src + 2 * W, sizeof(r[2]));
+        S::load(r, 0, v[0], std::make_index_sequence<W>());
+        S::load(r, 1, v[1], std::make_index_sequence<W>());
+        S::load(r, 2, v[2], std::make_index_sequence<W>());
+    }
+
+    template <size_t W, typename T>
+    VEC_LLG_INLINE void llg_store(const typename simd_vector<T,W>::type (&v)[3],
+                                  T* dst)
+    {
+        typedef llg_shuffle<T,W> S;
+        typename simd_vector<T,W>::type r[3];
+        S::store(v, 0, r[0], std::make_index_sequence<W>());
+        S::store(v, 1, r[1], std::make_index_sequence<W>());
+        S::store(v, 2, r[2], std::make_index_sequence<W>());
+        std::memcpy(dst, &r[0], sizeof(r[0]));
+        std::memcpy(dst + W, &r[1], sizeof(r[1]));
+        std::memcpy(dst + 2 * W, &r[2], sizeof(r[2]));
+    }
+#endif
+
+    // the arrays in mask, at spin k; the arrays are spelled out rather than
+    // looped over, which the optimizer does not unroll at -O2
+    template <size_t W, typename V, typename T>
+    VEC_LLG_INLINE void llg_load(unsigned mask, T* const* x, size_t k,
+                                 V (&v)[llg_arrays][3])
+    {
+        if (mask & 1 << llg_s) llg_load<W>(x[llg_s] + k * 3, v[llg_s]);
+        if (mask & 1 << llg_h) llg_load<W>(x[llg_h] + k * 3, v[llg_h]);
+        if (mask & 1 << llg_f) llg_load<W>(x[llg_f] + k * 3, v[llg_f]);
+        if (mask & 1 << llg_p) llg_load<W>(x[llg_p] + k * 3, v[llg_p]);
+    }
+
+    template <size_t W, typename V, typename T>
+    VEC_LLG_INLINE void llg_store(const V (&v)[llg_arrays][3], unsigned mask,
+                                  T* const* x, size_t k)
+    {
+        if (mask & 1 << llg_s) llg_store<W>(v[llg_s], x[llg_s] + k * 3);
+        if (mask & 1 << llg_h) llg_store<W>(v[llg_h], x[llg_h] + k * 3);
+        if (mask & 1 << llg_f) llg_store<W>(v[llg_f], x[llg_f] + k * 3);
+        if (mask & 1 << llg_p) llg_store<W>(v[llg_p], x[llg_p] + k * 3);
+    }
+
+    template <typename V>
+    VEC_LLG_INLINE void llg_cross(const V (&a)[3], const V (&b)[3],
+                                  V (&c)[3])
+    {
+        c[0] = a[1] * b[2] - a[2] * b[1];
+        c[1] = a[2] * b[0] - a[0] * b[2];
+        c[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    // ds/dt = -g (s x h + alpha s x (s x h))
+    template <typename T, typename V>
+    VEC_LLG_INLINE void llg_rhs(const llg_coeffs<T>& c, const V (&s)[3],
+                                const V (&h)[3], V (&f)[3])
+    {
+        V sh[3], ssh[3];
+        llg_cross(s, h, sh);
+        llg_cross(s, sh, ssh);
+        f[0] = -c.g * (sh[0] + c.alpha * ssh[0]);
+        f[1] = -c.g * (sh[1] + c.alpha * ssh[1]);
+        f[2] = -c.g * (sh[2] + c.alpha * ssh[2]);
+    }
+
+    // u = dt/2 a with a = -g (h + alpha s x h), such that s x a is the
+    // right hand side
+    template <typename T, typename V>
+    VEC_LLG_INLINE void llg_rotation(const llg_coeffs<T>& c, const V (&s)[3],
+                                     const V (&h)[3], V (&u)[3])
+    {
+        V sh[3];
+        llg_cross(s, h, sh);
+        const T f = -c.g * c.dt / T(2);
+        u[0] = f * (h[0] + c.alpha * sh[0]);
+        u[1] = f * (h[1] + c.alpha * sh[1]);
+        u[2] = f * (h[2] + c.alpha * sh[2]);
+    }
+
+    // the solution s' of s' = s + (s + s') x u, a rotation of s
+    template <typename T, typename V>
+    VEC_LLG_INLINE void llg_cayley(const V (&s)[3], const V (&u)[3],
+                                   V (&res)[3])
+    {
+        V b[3], bu[3];
+        llg_cross(s, u, bu);
+        b[0] = s[0] + bu[0];
+        b[1] = s[1] + bu[1];
+        b[2] = s[2] + bu[2];
+        llg_cross(b, u, bu);
+        const V ub = u[0] * b[0] + u[1] * b[1] + u[2] * b[2];
+        const V inv = T(1) / (T(1) + (u[0] * u[0] + u[1] * u[1]
+                                      + u[2] * u[2]));
+        res[0] = (b[0] + bu[0] + u[0] * ub) * inv;
+        res[1] = (b[1] + bu[1] + u[1] * ub) * inv;
+        res[2] = (b[2] + bu[2] + u[2] * ub) * inv;
+    }
+
+
+    // The stages: `reads` and `writes` are masks of the arrays to load and
+    // store, `normalized` the array to project onto the unit sphere after
+    // run has been applied to x, which holds W spins of each array.
+
+    // f = f(s), p = s + dt f normalized
+    struct llg_heun_predict {
+	static const unsigned reads = 1 << llg_s | 1 << llg_h;
+	static const unsigned writes = 1 << llg_f | 1 << llg_p;
+	static const llg_array normalized = llg_p;
+
+	template <typename T, typename V>
+	static VEC_LLG_INLINE void run(const llg_coeffs<T>& c,
+				       V (&x)[llg_arrays][3])
+	{
+	    llg_rhs(c, x[llg_s], x[llg_h], x[llg_f]);
+	    const V (&s)[3] = x[llg_s];
+	    const V (&f)[3] = x[llg_f];
+	    V (&p)[3] = x[llg_p];
+	    p[0] = s[0] + c.dt * f[0];
+	    p[1] = s[1] + c.dt * f[1];
+	    p[2] = s[2] + c.dt * f[2];
+	}
+    };
+
+    // s = s + dt/2 (f + f(p)) normalized
+    struct llg_heun_correct {
+	static const unsigned reads = 1 << llg_s | 1 << llg_h | 1 << llg_f
+	    | 1 << llg_p;
+	static const unsigned writes = 1 << llg_s;
+	static const llg_array normalized = llg_s;
+
+	template <typename T, typename V>
+	static VEC_LLG_INLINE void run(const llg_coeffs<T>& c,
+				       V (&x)[llg_arrays][3])
+	{
+	    V fp[3];
+	    llg_rhs(c, x[llg_p], x[llg_h], fp);
+	    const T half = c.dt / T(2);
+	    V (&s)[3] = x[llg_s];
+	    const V (&f)[3] = x[llg_f];
+	    s[0] = s[0] + half * (f[0] + fp[0]);
+	    s[1] = s[1] + half * (f[1] + fp[1]);
+	    s[2] = s[2] + half * (f[2] + fp[2]);
+	}
+    };
+
+    // p = (s + s') / 2 with the implicit step s' from s, at the field of s
+    struct llg_midpoint_predict {
+	static const unsigned reads = 1 << llg_s | 1 << llg_h;
+	static const unsigned writes = 1 << llg_p;
+	static const llg_array normalized = llg_arrays;
+
+	template <typename T, typename V>
+	static VEC_LLG_INLINE void run(const llg_coeffs<T>& c,
+				       V (&x)[llg_arrays][3])
+	{
+	    V u[3];
+	    llg_rotation(c, x[llg_s], x[llg_h], u);
+	    llg_cayley<T>(x[llg_s], u, x[llg_p]);
+	    const V (&s)[3] = x[llg_s];
+	    V (&p)[3] = x[llg_p];
+	    p[0] = (s[0] + p[0]) * T(0.5);
+	    p[1] = (s[1] + p[1]) * T(0.5);
+	    p[2] = (s[2] + p[2]) * T(0.5);
+	}
+    };
+
+    // s = s' from s, at the midpoint p and its field; the renormalization
+    // only removes the rounding errors accumulated over many steps
+    struct llg_midpoint_correct {
+	static const unsigned reads = 1 << llg_s | 1 << llg_h | 1 << llg_p;
+	static const unsigned writes = 1 << llg_s;
+	static const llg_array normalized = llg_s;
+
+	template <typename T, typename V>
+	static VEC_LLG_INLINE void run(const llg_coeffs<T>& c,
+				       V (&x)[llg_arrays][3])
+	{
+	    V u[3], s[3];
+	    llg_rotation(c, x[llg_p], x[llg_h], u);
+	    llg_cayley<T>(x[llg_s], u, s);
+	    x[llg_s][0] = s[0];
+	    x[llg_s][1] = s[1];
+	    x[llg_s][2] = s[2];
+	}
+    };
+
+    // x = 1 / sqrt(x), lane by lane
+    template <typename T>
+    VEC_LLG_INLINE void llg_rsqrt(T& x)
+    {
+        x = T(1) / std::sqrt(x);
+    }
+
+#ifdef VEC_SIMD_X86
+    template <typename T, typename V>
+    VEC_LLG_INLINE typename std::enable_if<!std::is_same<T,V>::value>::type
+    llg_rsqrt(V& x)
+    {
+        for (size_t l = 0; l < sizeof(V) / sizeof(T); ++l)
+            x[l] = T(1) / std::sqrt(x[l]);
+    }
+#endif
+
+    // the stage on the W spins starting at x[a] + 3 k of each array a
+    template <typename Stage, size_t W, typename T>
+    VEC_LLG_INLINE void llg_stage_spins(const llg_coeffs<T>& c, T* const* x,
+                                        size_t k)
+    {
+        typedef typename llg_vector<T,W>::type V;
+        V v[llg_arrays][3];
+        llg_load<W>(Stage::reads, x, k, v);
+
+        Stage::run(c, v);
+
+        const llg_array a = Stage::normalized;
+        if (a != llg_arrays) {
+            V inv = v[a][0] * v[a][0] + v[a][1] * v[a][1]
+                + v[a][2] * v[a][2];
+            llg_rsqrt<T>(inv);
+            v[a][0] = v[a][0] * inv;
+            v[a][1] = v[a][1] * inv;
+            v[a][2] = v[a][2] * inv;
+        }
+
+        llg_store<W>(v, Stage::writes, x, k);
+    }
+
+    // the stage on the spins [first, last) of the arrays x
+    template <typename Stage, size_t W, typename T>
+    VEC_LLG_INLINE void llg_stage_kernel(const llg_coeffs<T>& c, T* const* x,
+                                         size_t first, size_t last)
+    {
+        VEC_LLG_NO_CONTRACT
+        size_t k = first;
+        for (; k + W <= last; k += W)
+            llg_stage_spins<Stage,W>(c, x, k);
+        if (k == last)
+            return;
+
+        // the remainder, padded with unit spins which keep it finite
+        const size_t len = last - k;
+        T pad[llg_arrays][3*W];
+        T* y[llg_arrays];
+        for (size_t a = 0; a < llg_arrays; ++a) {
+            y[a] = pad[a];
+            const bool read = Stage::reads >> a & 1;
+            for (size_t j = 0; j < 3*W; ++j)
+                pad[a][j] = read && j < 3*len ? x[a][k*3+j] : T(j % 3 == 0);
+        }
+        llg_stage_spins<Stage,W>(c, y, 0);
+        for (size_t a = 0; a < llg_arrays; ++a)
+            if (Stage::writes >> a & 1)
+                std::copy(pad[a], pad[a] + 3*len, x[a] + k * 3);
+    }
+
+    // no FMAs here either, or the scalar path would round differently from
+    // the entry points below
+    template <typename Stage, typename T>
+    VEC_SIMD_STRICT
+    void llg_stage_scalar(const llg_coeffs<T>& c, T* const* x, size_t first,
+                          size_t last)
+    {
+        llg_stage_kernel<Stage,1>(c, x, first, last);
+    }
+
+#ifdef VEC_SIMD_X86
+#define VEC_LLG_ENTRY_POINT(isa, target, bytes)                             \
+    template <typename Stage, typename T>                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void llg_stage_##isa(const llg_coeffs<T>& c, T* const* x, size_t first, \
+                         size_t last)                                       \
+    {                                                                       \
+        llg_stage_kernel<Stage, bytes / sizeof(T)>(c, x, first, last);      \
+    }
+
+    VEC_LLG_ENTRY_POINT(sse2, "sse2", 16)
+    VEC_LLG_ENTRY_POINT(avx2, "avx2", 32)
+    VEC_LLG_ENTRY_POINT(avx512, "avx512f", 64)
+#undef VEC_LLG_ENTRY_POINT
+#endif
+
+    template <typename Stage, typename T>
+    void llg_stage(const llg_coeffs<T>& c, T* const* x, size_t first,
+                   size_t last)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return llg_stage_avx512<Stage>(c, x, first, last);
+        case simd_isa::avx2: return llg_stage_avx2<Stage>(c, x, first, last);
+        case simd_isa::sse2: return llg_stage_sse2<Stage>(c, x, first, last);
+        default: break;
+        }
+#endif
+        llg_stage_scalar<Stage>(c, x, first, last);
+    }
+
+
+    // Integrator for spins std::vector<vec<3,T>>, e.g.
+    //
+    //     llg_integrator<double> llg(1., .1);
+    //     for (int t = 0; t < steps; ++t)
+    //         llg.step(s, dt, [&](const std::vector<vec<3>>& s,
+    //                             std::vector<vec<3>>& h) {
+    //             for (size_t k = 0; k < s.size(); ++k)
+    //                 h[k] = b + J * (s[left(k)] + s[right(k)]);
+    //         });
+    //
+    // The field is called twice per step, with the spins at which to
+    // evaluate it (not necessarily of unit length) and an array of the same
+    // size to write it to. It may also assign a new vector of that size to
+    // the array; step throws std::length_error if the size differs.
+    template <typename T = double>
+    class llg_integrator {
+	static_assert(std::is_floating_point<T>::value,
+		      "llg_integrator requires floating point spins");
+    private:
+	T gamma, alpha;
+	llg_scheme scheme;
+	thread_pool* pool;
+	std::vector<vec<3,T>> h, f, p;
+
+	template <typename Field>
+	void evaluate(Field& field, const std::vector<vec<3,T>>& at)
+	{
+	    field(at, h);
+	    if (h.size() != at.size())
+		throw std::length_error("field changed the number of spins");
+	}
+
+	// The arrays are looked up anew for each stage, as the field may
+	// have replaced the buffer of h.
+	template <typename Stage>
+	void stage(const llg_coeffs<T>& c, std::vector<vec<3,T>>& s)
+	{
+	    T* const x[] = {simd_data(s), simd_data(h), simd_data(f),
+			    simd_data(p)};
+	    pool->parallel_for(s.size(), [&c, &x](size_t first, size_t last) {
+		llg_stage<Stage>(c, x, first, last);
+	    }, llg_grain_size);
+	}
+    public:
+	llg_integrator(T gamma_ratio, T damping,
+		       llg_scheme sch = llg_scheme::midpoint,
+		       thread_pool& tp = thread_pool::global())
+	    : gamma(gamma_ratio), alpha(damping), scheme(sch), pool(&tp) {}
+
+	// advances the unit spins s by dt
+	template <typename Field>
+	void step(std::vector<vec<3,T>>& s, T dt, Field field)
+	{
+	    const size_t n = s.size();
+	    h.resize(n);
+	    p.resize(n);
+	    if (scheme == llg_scheme::heun)
+		f.resize(n);
+	    const llg_coeffs<T> c = {gamma / (1 + alpha * alpha), alpha, dt};
+	    const std::vector<vec<3,T>>& cs = s;
+	    const std::vector<vec<3,T>>& cp = p;
+	    evaluate(field, cs);
+	    if (scheme == llg_scheme::heun) {
+		stage<llg_heun_predict>(c, s);
+		evaluate(field, cp);
+		stage<llg_heun_correct>(c, s);
+	    } else {
+		stage<llg_midpoint_predict>(c, s);
+		evaluate(field, cp);
+		stage<llg_midpoint_correct>(c, s);
+	    }
+	}
+    };
+}
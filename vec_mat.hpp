@@ -0,0 +1,444 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+
+namespace Vec {
+    // product of a matrix element and a vector component; complex products
+    // are spelled out to avoid the NaN/inf recovery of std::complex, which
+    // would prevent vectorization
+    template <typename A, typename B>
+    constexpr auto mat_term(const A& a, const B& b) -> decltype(a * b)
+    {
+        return a * b;
+    }
+
+    template <typename T>
+    constexpr std::complex<T> mat_term(const std::complex<T>& a,
+                                       const std::complex<T>& b)
+    {
+        return {a.real() * b.real() - a.imag() * b.imag(),
+                a.real() * b.imag() + a.imag() * b.real()};
+    }
+
+    // sum_j a[j] x[j], fully unrolled for short rows and accumulated from
+    // left to right either way
+    template <size_t J, typename C>
+    struct mat_row_dot {
+	template <typename A, typename X>
+	static constexpr C apply(const A& a, const X& x)
+	{
+	    return mat_row_dot<J-1,C>::apply(a, x) + mat_term(a[J-1], x[J-1]);
+	}
+    };
+
+    template <typename C>
+    struct mat_row_dot<1,C> {
+	template <typename A, typename X>
+	static constexpr C apply(const A& a, const X& x)
+	{
+	    return mat_term(a[0], x[0]);
+	}
+    };
+
+    template <size_t M, typename C, typename A, typename X>
+    constexpr typename std::enable_if<(M <= 4), C>::type
+    row_dot(const A& a, const X& x)
+    {
+        return mat_row_dot<M,C>::apply(a, x);
+    }
+
+    template <size_t M, typename C, typename A, typename X>
+    constexpr typename std::enable_if<(M > 4), C>::type
+    row_dot(const A& a, const X& x)
+    {
+        C sum = mat_term(a[0], x[0]);
+        for (size_t j = 1; j < M; ++j)
+            sum += mat_term(a[j], x[j]);
+        return sum;
+    }
+
+
+    // N x M matrix stored as N rows of type vec<M,T>
+    template <size_t N, size_t M, typename T = double>
+    class mat {
+	static_assert(N > 0 && M > 0, "mat may not be zero-dimensional");
+    private:
+	vec<M,T> rows[N];
+    public:
+	typedef T value_type;
+
+	// constructors
+	constexpr mat() : rows{} {}
+
+	constexpr mat(std::initializer_list<vec<M,T>> il) : rows{}
+	{
+	    size_t i = 0;
+	    const vec<M,T>* it = il.begin();
+	    for (; it != il.end() && i < N; ++i, ++it)
+		rows[i] = *it;
+	}
+
+	template <typename T2, typename = typename std::enable_if<
+				  std::is_convertible<T2, T>::value, T2>::type>
+	constexpr mat(const mat<N,M,T2>& m) : rows{}
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i] = m[i];
+	}
+
+	static constexpr mat identity()
+	{
+	    static_assert(N == M, "identity matrix must be square");
+	    mat res;
+	    for (size_t i = 0; i < N; ++i)
+		res.rows[i][i] = T(1);
+	    return res;
+	}
+
+	static constexpr mat diagonal(const vec<N,T>& d)
+	{
+	    static_assert(N == M, "diagonal matrix must be square");
+	    mat res;
+	    for (size_t i = 0; i < N; ++i)
+		res.rows[i][i] = d[i];
+	    return res;
+	}
+
+	// element access
+	constexpr vec<M,T>& operator[](size_t i)
+	{
+	    return rows[i];
+	}
+
+	constexpr const vec<M,T>& operator[](size_t i) const
+	{
+	    return rows[i];
+	}
+
+	constexpr T& operator()(size_t i, size_t j)
+	{
+	    return rows[i][j];
+	}
+
+	constexpr const T& operator()(size_t i, size_t j) const
+	{
+	    return rows[i][j];
+	}
+
+	constexpr vec<N,T> col(size_t j) const
+	{
+	    vec<N,T> res;
+	    for (size_t i = 0; i < N; ++i)
+		res[i] = rows[i][j];
+	    return res;
+	}
+
+	// compound assignment
+	template <typename T2>
+	constexpr mat& operator+= (const mat<N,M,T2>& m)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i] += m[i];
+	    return *this;
+	}
+
+	template <typename T2>
+	constexpr mat& operator-= (const mat<N,M,T2>& m)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i] -= m[i];
+	    return *this;
+	}
+
+	constexpr mat& operator*= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i] *= val;
+	    return *this;
+	}
+
+	constexpr mat& operator/= (const T& val)
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i] /= val;
+	    return *this;
+	}
+
+	template <typename..., typename S = T>
+	typename std::enable_if<is_complex<S>::value, void>::type
+	conj()
+	{
+	    for (size_t i = 0; i < N; ++i)
+		rows[i].conj();
+	}
+    };
+
+    template <typename S> struct is_mat : std::false_type {};
+    template <size_t N, size_t M, typename T>
+    struct is_mat<mat<N,M,T>> : std::true_type {};
+
+
+    // transpose and Hermitian adjoint
+    template <size_t N, size_t M, typename T>
+    constexpr mat<M,N,T> transpose(const mat<N,M,T>& m)
+    {
+        mat<M,N,T> res;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                res(j, i) = m(i, j);
+        return res;
+    }
+
+    template <size_t N, size_t M, typename T>
+    constexpr typename std::enable_if<!is_complex<T>::value, mat<M,N,T>>::type
+    adjoint(const mat<N,M,T>& m)
+    {
+        return transpose(m);
+    }
+
+    template <size_t N, size_t M, typename T>
+    typename std::enable_if<is_complex<T>::value, mat<M,N,T>>::type
+    adjoint(const mat<N,M,T>& m)
+    {
+        mat<M,N,T> res;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                res(j, i) = std::conj(m(i, j));
+        return res;
+    }
+
+    template <size_t N, size_t M, typename T>
+    typename std::enable_if<is_complex<T>::value, mat<N,M,T>>::type
+    conj(const mat<N,M,T>& m)
+    {
+        mat<N,M,T> res(m);
+        res.conj();
+        return res;
+    }
+
+
+    // inverse by Gauss-Jordan elimination with partial pivoting; singular
+    // matrices yield non-finite entries
+    template <size_t N, typename T>
+    mat<N,N,T> inverse(mat<N,N,T> m)
+    {
+        mat<N,N,T> inv = mat<N,N,T>::identity();
+        for (size_t c = 0; c < N; ++c) {
+            size_t p = c;
+            for (size_t i = c + 1; i < N; ++i)
+                if (std::abs(m(i, c)) > std::abs(m(p, c)))
+                    p = i;
+            std::swap(m[c], m[p]);
+            std::swap(inv[c], inv[p]);
+            const T d = m(c, c);
+            m[c] /= d;
+            inv[c] /= d;
+            for (size_t i = 0; i < N; ++i) {
+                if (i == c)
+                    continue;
+                const T f = m(i, c);
+                m[i] -= f * m[c];
+                inv[i] -= f * inv[c];
+            }
+        }
+        return inv;
+    }
+
+
+    // matrix-vector product
+    template <size_t N, size_t M, typename A, typename E, typename B,
+              typename C = decltype(A()*B())>
+    constexpr vec<N,C> operator* (const mat<N,M,A>& m,
+                                  const vec_expr<E,M,B>& x)
+    {
+        const vec<M,B> v(x);
+        vec<N,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = row_dot<M,C>(m[i], v);
+        return res;
+    }
+
+    // matrix-matrix product
+    template <size_t N, size_t K, size_t M, typename A, typename B,
+              typename C = decltype(A()*B())>
+    constexpr mat<N,M,C> operator* (const mat<N,K,A>& lhs,
+                                    const mat<K,M,B>& rhs)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                res(i, j) = row_dot<K,C>(lhs[i], rhs.col(j));
+        return res;
+    }
+
+
+    // unary minus
+    template <size_t N, size_t M, typename T>
+    constexpr mat<N,M,T> operator- (const mat<N,M,T>& m)
+    {
+        mat<N,M,T> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = -m[i];
+        return res;
+    }
+
+
+    // scalar multiplication
+    template <size_t N, size_t M, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value &&
+                                                 !is_mat<S>::value>::type,
+              typename C = decltype(S()*T())>
+    constexpr mat<N,M,C> operator* (const S& val, const mat<N,M,T>& m)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = val * m[i];
+        return res;
+    }
+
+    template <size_t N, size_t M, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value &&
+                                                 !is_mat<S>::value>::type,
+              typename C = decltype(S()*T())>
+    constexpr mat<N,M,C> operator* (const mat<N,M,T>& m, const S& val)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = m[i] * val;
+        return res;
+    }
+
+    template <size_t N, size_t M, typename T, typename S,
+              typename = typename std::enable_if<!is_vec_expr<S>::value &&
+                                                 !is_mat<S>::value>::type,
+              typename C = decltype(T()/S())>
+    constexpr mat<N,M,C> operator/ (const mat<N,M,T>& m, const S& val)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = m[i] / val;
+        return res;
+    }
+
+
+    // addition and subtraction
+    template <size_t N, size_t M, typename A, typename B,
+              typename C = decltype(A()+B())>
+    constexpr mat<N,M,C> operator+ (const mat<N,M,A>& lhs,
+                                    const mat<N,M,B>& rhs)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = lhs[i] + rhs[i];
+        return res;
+    }
+
+    template <size_t N, size_t M, typename A, typename B,
+              typename C = decltype(A()-B())>
+    constexpr mat<N,M,C> operator- (const mat<N,M,A>& lhs,
+                                    const mat<N,M,B>& rhs)
+    {
+        mat<N,M,C> res;
+        for (size_t i = 0; i < N; ++i)
+            res[i] = lhs[i] - rhs[i];
+        return res;
+    }
+
+
+    // comparison
+    template <size_t N, size_t M, typename A, typename B>
+    constexpr bool operator== (const mat<N,M,A>& lhs, const mat<N,M,B>& rhs)
+    {
+        for (size_t i = 0; i < N; ++i)
+            if (lhs[i] != rhs[i])
+                return false;
+        return true;
+    }
+
+    template <size_t N, size_t M, typename A, typename B>
+    constexpr bool operator!= (const mat<N,M,A>& lhs, const mat<N,M,B>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+
+    // output: rows in the format of vec
+    template <size_t N, size_t M, typename T>
+    std::ostream& operator<< (std::ostream& os, const mat<N,M,T>& rhs)
+    {
+        os << "(" << rhs[0];
+        for (size_t i = 1; i < N; ++i)
+            os << ", " << rhs[i];
+        os << ")";
+        return os;
+    }
+
+
+    // batched matrix-vector products y[k] = m * x[k]; y may be x
+    template <size_t N, size_t M, typename A, typename B, typename C>
+    void apply(const mat<N,M,A>& m, const vec<M,B>* x, vec<N,C>* y, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k) {
+            const vec<M,B> xk = x[k];
+            for (size_t i = 0; i < N; ++i)
+                y[k][i] = row_dot<M,C>(m[i], xk);
+        }
+    }
+
+    template <size_t N, size_t M, typename A, typename B,
+              typename C = decltype(A()*B())>
+    std::vector<vec<N,C>> apply(const mat<N,M,A>& m,
+                                const std::vector<vec<M,B>>& x)
+    {
+        std::vector<vec<N,C>> res(x.size());
+        apply(m, x.data(), res.data(), x.size());
+        return res;
+    }
+
+    // the structure-of-arrays layout vectorizes across the vectors
+    template <size_t N, size_t M, typename A, typename B,
+              typename C = decltype(A()*B())>
+    vec_array<N,C> apply(const mat<N,M,A>& m, const vec_array<M,B>& x)
+    {
+        const size_t n = x.size();
+        vec_array<N,C> res(n);
+        for (size_t i = 0; i < N; ++i) {
+            C* out = res.component(i);
+            const B* in = x.component(0);
+            const A a0 = m(i, 0);
+            for (size_t k = 0; k < n; ++k)
+                out[k] = mat_term(a0, in[k]);
+            for (size_t j = 1; j < M; ++j) {
+                in = x.component(j);
+                const A a = m(i, j);
+                for (size_t k = 0; k < n; ++k)
+                    out[k] += mat_term(a, in[k]);
+            }
+        }
+        return res;
+    }
+}
@@ -0,0 +1,298 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "vec.hpp"
+
+namespace Vec {
+    // Work-stealing thread pool for data-parallel loops.
+    //
+    // parallel_for splits a range into chunks and deals out contiguous runs
+    // of chunks to the workers, each of which processes its own run front to
+    // back. Idle workers steal chunks from the back of other runs. Without
+    // imbalance, a thread thus always touches the same part of the data,
+    // which keeps pages first touched by a thread local to its NUMA node.
+    // The calling thread takes part in the work rather than blocking.
+    class thread_pool {
+    private:
+	typedef std::function<void()> task;
+
+	struct queue {
+	    std::mutex m;
+	    std::deque<task> tasks;
+	};
+
+	std::vector<std::unique_ptr<queue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex sleep_m;
+	std::condition_variable sleep_cv;
+	std::atomic<size_t> queued;
+	bool stop;
+
+	// a parallel_for in flight
+	struct job {
+	    std::mutex m;
+	    std::condition_variable cv;
+	    size_t remaining;
+	    std::exception_ptr error;
+	};
+    public:
+	// `threads` in total, including the calling thread; 0: one per
+	// hardware thread
+	explicit thread_pool(unsigned threads = 0) : queued(0), stop(false)
+	{
+	    if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	    for (unsigned w = 0; w + 1 < threads; ++w)
+		queues.emplace_back(new queue);
+	    for (unsigned w = 0; w + 1 < threads; ++w)
+		workers.emplace_back([this, w] { work(w); });
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	~thread_pool()
+	{
+	    {
+		std::lock_guard<std::mutex> lock(sleep_m);
+		stop = true;
+	    }
+	    sleep_cv.notify_all();
+	    for (std::thread& t : workers)
+		t.join();
+	}
+
+	// number of threads working on a parallel_for
+	unsigned concurrency() const
+	{
+	    return unsigned(workers.size()) + 1;
+	}
+
+	// the pool used by default, with one thread per hardware thread
+	static thread_pool& global()
+	{
+	    static thread_pool pool;
+	    return pool;
+	}
+
+	// f(begin, end) on chunks of at least `grain` elements covering
+	// [0, n); returns once all chunks are done and rethrows the first
+	// exception thrown by f, if any
+	template <typename F>
+	void parallel_for(size_t n, F f, size_t grain = 1 << 12)
+	{
+	    grain = std::max<size_t>(grain, 1);
+	    const size_t nw = queues.size();
+	    // a few chunks per thread give stealing room to balance the load
+	    const size_t chunks = std::min((n + grain - 1) / grain,
+					   4 * (nw + 1));
+	    if (nw == 0 || chunks <= 1) {
+		if (n)
+		    f(size_t(0), n);
+		return;
+	    }
+
+	    job j;
+	    j.remaining = chunks;
+	    {
+		// count before pushing so that queued never drops below zero
+		std::lock_guard<std::mutex> lock(sleep_m);
+		queued += chunks;
+	    }
+	    for (size_t c = 0; c < chunks; ++c) {
+		const size_t b = n * c / chunks, e = n * (c + 1) / chunks;
+		queue& q = *queues[c * nw / chunks];
+		std::lock_guard<std::mutex> lock(q.m);
+		q.tasks.emplace_back([&j, &f, b, e] {
+		    std::exception_ptr error;
+		    try {
+			f(b, e);
+		    } catch (...) {
+			error = std::current_exception();
+		    }
+		    // the caller may return as soon as remaining drops to
+		    // zero, so j must not be touched after releasing m
+		    std::lock_guard<std::mutex> lock(j.m);
+		    if (error && !j.error)
+			j.error = error;
+		    if (--j.remaining == 0)
+			j.cv.notify_all();
+		});
+	    }
+	    sleep_cv.notify_all();
+
+	    // help out until nothing is left to steal, then wait
+	    for (;;) {
+		{
+		    std::lock_guard<std::mutex> lock(j.m);
+		    if (j.remaining == 0)
+			break;
+		}
+		if (!run_one(nw))
+		    break;
+	    }
+	    std::unique_lock<std::mutex> lock(j.m);
+	    j.cv.wait(lock, [&j] { return j.remaining == 0; });
+	    if (j.error)
+		std::rethrow_exception(j.error);
+	}
+
+    private:
+	// pop a task from the front of queue `own`, or else steal one from the
+	// back of another queue, and run it
+	bool run_one(size_t own)
+	{
+	    const size_t nq = queues.size();
+	    task t;
+	    for (size_t i = 0; i < nq && !t; ++i) {
+		const size_t w = (own + i) % nq;
+		queue& q = *queues[w];
+		std::lock_guard<std::mutex> lock(q.m);
+		if (q.tasks.empty())
+		    continue;
+		if (w == own) {
+		    t = std::move(q.tasks.front());
+		    q.tasks.pop_front();
+		} else {
+		    t = std::move(q.tasks.back());
+		    q.tasks.pop_back();
+		}
+	    }
+	    if (!t)
+		return false;
+	    --queued;
+	    t();
+	    return true;
+	}
+
+	void work(size_t w)
+	{
+	    for (;;) {
+		if (run_one(w))
+		    continue;
+		std::unique_lock<std::mutex> lock(sleep_m);
+		sleep_cv.wait(lock, [this] { return stop || queued > 0; });
+		if (stop)
+		    return;
+	    }
+	}
+    };
+
+
+    // Batch transforms over contiguous vectors, e.g.
+    //
+    //     vec_map(x, [](const vec<3>& v) { return v / v.norm(); });
+    //     vec_zip(x, b, y, [](const vec<3>& v, const vec<3>& f) {
+    //         return cross(v, f);
+    //     });
+    //
+    // The out-of-place versions write f(in[k]) or f(a[k], b[k]) to out[k],
+    // the in-place versions overwrite their first argument.
+
+    const size_t vec_map_grain_size = 1 << 12;
+
+    template <typename A, typename B, typename F>
+    void vec_map(const A* in, B* out, size_t n, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(n, [in, out, &f](size_t b, size_t e) {
+            for (size_t k = b; k < e; ++k)
+                out[k] = f(in[k]);
+        }, vec_map_grain_size);
+    }
+
+    template <typename A, typename F>
+    void vec_map(A* x, size_t n, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(n, [x, &f](size_t b, size_t e) {
+            for (size_t k = b; k < e; ++k)
+                x[k] = f(x[k]);
+        }, vec_map_grain_size);
+    }
+
+    template <typename A, typename B, typename F>
+    void vec_map(const std::vector<A>& in, std::vector<B>& out, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        out.resize(in.size());
+        vec_map(in.data(), out.data(), in.size(), f, pool);
+    }
+
+    template <typename A, typename F>
+    void vec_map(std::vector<A>& x, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        vec_map(x.data(), x.size(), f, pool);
+    }
+
+    template <typename A, typename B, typename C, typename F>
+    void vec_zip(const A* a, const B* b, C* out, size_t n, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(n, [a, b, out, &f](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k)
+                out[k] = f(a[k], b[k]);
+        }, vec_map_grain_size);
+    }
+
+    template <typename A, typename B, typename F>
+    void vec_zip(A* a, const B* b, size_t n, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(n, [a, b, &f](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k)
+                a[k] = f(a[k], b[k]);
+        }, vec_map_grain_size);
+    }
+
+    inline void vec_zip_check_size(size_t n, size_t m)
+    {
+        if (n != m)
+            throw std::invalid_argument("vec_zip operands differ in size");
+    }
+
+    template <typename A, typename B, typename C, typename F>
+    void vec_zip(const std::vector<A>& a, const std::vector<B>& b,
+                 std::vector<C>& out, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        vec_zip_check_size(a.size(), b.size());
+        out.resize(a.size());
+        vec_zip(a.data(), b.data(), out.data(), a.size(), f, pool);
+    }
+
+    template <typename A, typename B, typename F>
+    void vec_zip(std::vector<A>& a, const std::vector<B>& b, F f,
+                 thread_pool& pool = thread_pool::global())
+    {
+        vec_zip_check_size(a.size(), b.size());
+        vec_zip(a.data(), b.data(), a.size(), f, pool);
+    }
+}
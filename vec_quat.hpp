@@ -0,0 +1,342 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+#include "vec_mat.hpp"
+
+namespace Vec {
+    // Quaternions q = w + x i + y j + z k, stored as the scalar part w and
+    // the vector part v = (x, y, z). Unit quaternions represent rotations of
+    // vec<3,T>: rotate(q, a) = q a q*, and q1 * q2 rotates by q2, then q1.
+    template <typename T = double>
+    class quat {
+	static_assert(std::is_floating_point<T>::value,
+		      "quat requires a floating point type");
+    public:
+	typedef T value_type;
+
+	T w;
+	vec<3,T> v;
+
+	// constructors; the default is the identity rotation
+	constexpr quat() : w(1), v() {}
+
+	constexpr quat(const T& w_, const vec<3,T>& v_) : w(w_), v(v_) {}
+
+	static constexpr quat identity()
+	{
+	    return quat();
+	}
+
+	// rotation by `angle` about `axis` (right-handed), which need not be
+	// normalized; a zero axis gives the identity
+	static quat from_axis_angle(const vec<3,T>& axis, T angle)
+	{
+	    const T n = axis.norm();
+	    if (n == 0)
+		return quat();
+	    const T s = std::sin(angle / 2) / n;
+	    return quat(std::cos(angle / 2), vec<3,T>(s * axis));
+	}
+
+	// rotation by |r| about r, e.g. r = omega dt for an angular velocity
+	static quat from_rotation_vector(const vec<3,T>& r)
+	{
+	    return from_axis_angle(r, r.norm());
+	}
+
+	// rotation angle in [0, 2 pi] and unit axis of a unit quaternion; the
+	// axis of the identity is arbitrarily taken to be (1, 0, 0)
+	T angle() const
+	{
+	    return 2 * std::atan2(v.norm(), w);
+	}
+
+	vec<3,T> axis() const
+	{
+	    const T n = v.norm();
+	    return n == 0 ? vec<3,T>{1, 0, 0} : vec<3,T>(v / n);
+	}
+
+	// norms
+	constexpr T norm2_sq() const
+	{
+	    return w * w + v.norm2_sq();
+	}
+
+	T norm() const
+	{
+	    return std::sqrt(norm2_sq());
+	}
+
+	quat& normalize()
+	{
+	    *this /= norm();
+	    return *this;
+	}
+
+	// compound assignment
+	constexpr quat& operator+= (const quat& q)
+	{
+	    w += q.w;
+	    v += q.v;
+	    return *this;
+	}
+
+	constexpr quat& operator-= (const quat& q)
+	{
+	    w -= q.w;
+	    v -= q.v;
+	    return *this;
+	}
+
+	constexpr quat& operator*= (const T& val)
+	{
+	    w *= val;
+	    v *= val;
+	    return *this;
+	}
+
+	constexpr quat& operator/= (const T& val)
+	{
+	    w /= val;
+	    v /= val;
+	    return *this;
+	}
+
+	// Hamilton product *this = *this * q
+	constexpr quat& operator*= (const quat& q);
+    };
+
+
+    // Hamilton product; written out in components
+    template <typename T>
+    constexpr quat<T> operator* (const quat<T>& p, const quat<T>& q)
+    {
+        return {p.w * q.w - p.v[0] * q.v[0] - p.v[1] * q.v[1] - p.v[2] * q.v[2],
+                {p.w * q.v[0] + p.v[0] * q.w + p.v[1] * q.v[2] - p.v[2] * q.v[1],
+                 p.w * q.v[1] + p.v[1] * q.w + p.v[2] * q.v[0] - p.v[0] * q.v[2],
+                 p.w * q.v[2] + p.v[2] * q.w + p.v[0] * q.v[1] - p.v[1] * q.v[0]}};
+    }
+
+    template <typename T>
+    constexpr quat<T>& quat<T>::operator*= (const quat<T>& q)
+    {
+        return *this = *this * q;
+    }
+
+    template <typename T>
+    constexpr quat<T> operator- (const quat<T>& q)
+    {
+        return {-q.w, vec<3,T>(-q.v)};
+    }
+
+    template <typename T>
+    constexpr quat<T> operator+ (quat<T> lhs, const quat<T>& rhs)
+    {
+        return lhs += rhs;
+    }
+
+    template <typename T>
+    constexpr quat<T> operator- (quat<T> lhs, const quat<T>& rhs)
+    {
+        return lhs -= rhs;
+    }
+
+    template <typename T>
+    constexpr quat<T> operator* (const typename quat<T>::value_type& val,
+                                 quat<T> q)
+    {
+        return q *= val;
+    }
+
+    template <typename T>
+    constexpr quat<T> operator* (quat<T> q,
+                                 const typename quat<T>::value_type& val)
+    {
+        return q *= val;
+    }
+
+    template <typename T>
+    constexpr quat<T> operator/ (quat<T> q,
+                                 const typename quat<T>::value_type& val)
+    {
+        return q /= val;
+    }
+
+    template <typename T>
+    constexpr bool operator== (const quat<T>& lhs, const quat<T>& rhs)
+    {
+        return lhs.w == rhs.w && lhs.v == rhs.v;
+    }
+
+    template <typename T>
+    constexpr bool operator!= (const quat<T>& lhs, const quat<T>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    // four-dimensional dot product
+    template <typename T>
+    constexpr T dot(const quat<T>& p, const quat<T>& q)
+    {
+        return p.w * q.w + p.v * q.v;
+    }
+
+    // conjugate, the inverse rotation for unit quaternions
+    template <typename T>
+    constexpr quat<T> conj(const quat<T>& q)
+    {
+        return {q.w, vec<3,T>(-q.v)};
+    }
+
+    template <typename T>
+    constexpr quat<T> inverse(const quat<T>& q)
+    {
+        return conj(q) / q.norm2_sq();
+    }
+
+    template <typename T>
+    quat<T> normalize(quat<T> q)
+    {
+        return q.normalize();
+    }
+
+    // output: (w, (x, y, z))
+    template <typename T>
+    std::ostream& operator<< (std::ostream& os, const quat<T>& q)
+    {
+        os << "(" << q.w << ", " << q.v << ")";
+        return os;
+    }
+
+
+    // rotation of a by the unit quaternion q via
+    //     t = 2 v x a,  a' = a + w t + v x t,
+    // written out in components rather than using cross() and temporaries
+    template <typename T>
+    constexpr vec<3,T> rotate(const quat<T>& q, const vec<3,T>& a)
+    {
+        const T x = q.v[0], y = q.v[1], z = q.v[2];
+        const T t0 = 2 * (y * a[2] - z * a[1]);
+        const T t1 = 2 * (z * a[0] - x * a[2]);
+        const T t2 = 2 * (x * a[1] - y * a[0]);
+        return {a[0] + q.w * t0 + (y * t2 - z * t1),
+                a[1] + q.w * t1 + (z * t0 - x * t2),
+                a[2] + q.w * t2 + (x * t1 - y * t0)};
+    }
+
+    // the rotation matrix of a unit quaternion
+    template <typename T>
+    constexpr mat<3,3,T> rotation_matrix(const quat<T>& q)
+    {
+        const T w = q.w, x = q.v[0], y = q.v[1], z = q.v[2];
+        return {{1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)},
+                {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+                {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)}};
+    }
+
+    // spherical linear interpolation between unit quaternions along the
+    // shorter arc, t in [0, 1]; nearly parallel inputs are interpolated
+    // linearly and normalized, which avoids dividing by sin(theta) ~ 0
+    template <typename T>
+    quat<T> slerp(const quat<T>& q0, quat<T> q1, T t)
+    {
+        T c = dot(q0, q1);
+        if (c < 0) {
+            q1 = -q1;
+            c = -c;
+        }
+        if (c > T(0.9995))
+            return normalize((1 - t) * q0 + t * q1);
+        const T theta = std::acos(c);
+        const T s = std::sin(theta);
+        return (std::sin((1 - t) * theta) / s) * q0
+            + (std::sin(t * theta) / s) * q1;
+    }
+
+
+    // Batched rotations y[k] = rotate(q, x[k]) of many vectors by the same
+    // unit quaternion, applying its rotation matrix. The output may be the
+    // input; in the structure-of-arrays layout, the loop vectorizes across
+    // the vectors.
+    template <typename T>
+    void rotate(const quat<T>& q, const vec<3,T>* x, vec<3,T>* y, size_t n)
+    {
+        const mat<3,3,T> m = rotation_matrix(q);
+        for (size_t k = 0; k < n; ++k) {
+            const T a0 = x[k][0], a1 = x[k][1], a2 = x[k][2];
+            for (size_t i = 0; i < 3; ++i)
+                y[k][i] = m(i, 0) * a0 + m(i, 1) * a1 + m(i, 2) * a2;
+        }
+    }
+
+    template <typename T>
+    void rotate(const quat<T>& q, const std::vector<vec<3,T>>& x,
+                std::vector<vec<3,T>>& y)
+    {
+        y.resize(x.size());
+        rotate(q, x.data(), y.data(), x.size());
+    }
+
+    template <typename T>
+    std::vector<vec<3,T>> rotate(const quat<T>& q,
+                                 const std::vector<vec<3,T>>& x)
+    {
+        std::vector<vec<3,T>> res(x.size());
+        rotate(q, x.data(), res.data(), x.size());
+        return res;
+    }
+
+    template <typename T>
+    void rotate(const quat<T>& q, const vec_array<3,T>& x, vec_array<3,T>& y)
+    {
+        const mat<3,3,T> m = rotation_matrix(q);
+        const T m00 = m(0, 0), m01 = m(0, 1), m02 = m(0, 2);
+        const T m10 = m(1, 0), m11 = m(1, 1), m12 = m(1, 2);
+        const T m20 = m(2, 0), m21 = m(2, 1), m22 = m(2, 2);
+        const size_t n = x.size();
+        if (&y != &x)
+            y.resize(n);
+        const T* x0 = x.component(0);
+        const T* x1 = x.component(1);
+        const T* x2 = x.component(2);
+        T* y0 = y.component(0);
+        T* y1 = y.component(1);
+        T* y2 = y.component(2);
+        for (size_t k = 0; k < n; ++k) {
+            const T a0 = x0[k], a1 = x1[k], a2 = x2[k];
+            y0[k] = m00 * a0 + m01 * a1 + m02 * a2;
+            y1[k] = m10 * a0 + m11 * a1 + m12 * a2;
+            y2[k] = m20 * a0 + m21 * a1 + m22 * a2;
+        }
+    }
+
+    template <typename T>
+    vec_array<3,T> rotate(const quat<T>& q, const vec_array<3,T>& x)
+    {
+        vec_array<3,T> res(x.size());
+        rotate(q, x, res);
+        return res;
+    }
+}
@@ -0,0 +1,479 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_array.hpp"
+
+namespace Vec {
+    // Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1,
+    // 2, 3", SC'11): a bijection of a 128 bit counter, keyed by 64 bits,
+    // which passes BigCrush for distinct counters
+    struct philox4x32 {
+	static const uint32_t M0 = 0xD2511F53;
+	static const uint32_t M1 = 0xCD9E8D57;
+	static const uint32_t W0 = 0x9E3779B9;
+	static const uint32_t W1 = 0xBB67AE85;
+
+	static void round(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3,
+			  uint32_t k0, uint32_t k1)
+	{
+	    const uint64_t p0 = uint64_t(M0) * c0;
+	    const uint64_t p1 = uint64_t(M1) * c2;
+	    c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+	    c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+	    c1 = uint32_t(p1);
+	    c3 = uint32_t(p0);
+	}
+
+	// the rounds are spelled out to keep the state in registers
+	static void apply(uint32_t c[4], uint32_t k0, uint32_t k1)
+	{
+	    uint32_t c0 = c[0], c1 = c[1], c2 = c[2], c3 = c[3];
+	    round(c0, c1, c2, c3, k0, k1);
+	    round(c0, c1, c2, c3, k0 + 1 * W0, k1 + 1 * W1);
+	    round(c0, c1, c2, c3, k0 + 2 * W0, k1 + 2 * W1);
+	    round(c0, c1, c2, c3, k0 + 3 * W0, k1 + 3 * W1);
+	    round(c0, c1, c2, c3, k0 + 4 * W0, k1 + 4 * W1);
+	    round(c0, c1, c2, c3, k0 + 5 * W0, k1 + 5 * W1);
+	    round(c0, c1, c2, c3, k0 + 6 * W0, k1 + 6 * W1);
+	    round(c0, c1, c2, c3, k0 + 7 * W0, k1 + 7 * W1);
+	    round(c0, c1, c2, c3, k0 + 8 * W0, k1 + 8 * W1);
+	    round(c0, c1, c2, c3, k0 + 9 * W0, k1 + 9 * W1);
+	    c[0] = c0;
+	    c[1] = c1;
+	    c[2] = c2;
+	    c[3] = c3;
+	}
+    };
+
+
+    // Counter-based source of random vectors. The random bits of sample k
+    // depend on nothing but the seed, the stream and k, so a batch may be
+    // split among threads by giving each a copy seeked to the start of its
+    // part, with results identical to those of a single thread. Streams
+    // with the same seed are independent.
+    class counter_rng {
+    private:
+	uint32_t key[2];
+	uint32_t strm;
+	uint64_t pos;
+    public:
+	explicit counter_rng(uint64_t seed = 0, uint32_t stream = 0)
+	    : key{uint32_t(seed), uint32_t(seed >> 32)}, strm(stream), pos(0) {}
+
+	uint64_t seed() const
+	{
+	    return key[0] | uint64_t(key[1]) << 32;
+	}
+
+	uint32_t stream() const
+	{
+	    return strm;
+	}
+
+	// index of the next sample; advanced by each batch
+	uint64_t position() const
+	{
+	    return pos;
+	}
+
+	void seek(uint64_t k)
+	{
+	    pos = k;
+	}
+
+	void discard(uint64_t n)
+	{
+	    pos += n;
+	}
+
+	// four random words for draw j of sample k
+	void bits(uint64_t k, uint32_t j, uint32_t out[4]) const
+	{
+	    out[0] = uint32_t(k);
+	    out[1] = uint32_t(k >> 32);
+	    out[2] = j;
+	    out[3] = strm;
+	    philox4x32::apply(out, key[0], key[1]);
+	}
+    };
+
+
+    // uniform numbers in [0, 1) with the full precision of R, or in (0, 1)
+    // with one bit less if `open`, from two random words (float uses the
+    // first only)
+    template <typename R>
+    R random_uniform(uint32_t a, uint32_t b, bool open)
+    {
+        const uint64_t m = uint64_t(a) << 21 | b >> 11;
+        return open ? (R(int64_t(m >> 1)) + R(0.5)) * R(1.0 / 4503599627370496.0)
+            : R(int64_t(m)) * R(1.0 / 9007199254740992.0);
+    }
+
+    template <>
+    inline float random_uniform<float>(uint32_t a, uint32_t, bool open)
+    {
+        return open ? (float(a >> 9) + 0.5f) * (1.f / 8388608.f)
+            : float(a >> 8) * (1.f / 16777216.f);
+    }
+
+    // number of real scalars per component
+    template <typename T>
+    struct random_scalars : std::integral_constant<size_t, 1> {};
+
+    template <typename S>
+    struct random_scalars<std::complex<S>> : std::integral_constant<size_t, 2> {};
+
+    const size_t random_block = 64;
+
+    // The samples are generated in blocks of random_block: the distribution
+    // writes the real scalars of a block as x[s * random_block + b] for
+    // scalar s of sample b. Each draw is evaluated across the block in one
+    // loop, which vectorizes the generator. Draws are tagged with an id per
+    // distribution so that different distributions use different counters.
+    template <typename R>
+    void random_uniform_block(const counter_rng& rng, uint64_t first,
+                              size_t len, uint32_t draw, bool open,
+                              R* u0, R* u1)
+    {
+        for (size_t b = 0; b < len; ++b) {
+            uint32_t w[4];
+            rng.bits(first + b, draw, w);
+            u0[b] = random_uniform<R>(w[0], w[1], open);
+            u1[b] = random_uniform<R>(w[2], w[3], open);
+        }
+    }
+
+    // uniform in the box [lo, hi) per real scalar
+    template <typename R>
+    struct random_box_dist {
+	static const uint32_t id = 1 << 24;
+	std::vector<R> lo, width;
+
+	void operator()(const counter_rng& rng, uint64_t first, size_t len,
+			R* x) const
+	{
+	    const size_t m = lo.size();
+	    for (size_t s = 0; s < m; s += 2) {
+		R* x0 = x + s * random_block;
+		R* x1 = x + (s + 1 < m ? s + 1 : s) * random_block;
+		random_uniform_block(rng, first, len, id | uint32_t(s / 2),
+				     false, x0, x1);
+		for (size_t b = 0; b < len; ++b)
+		    x0[b] = lo[s] + width[s] * x0[b];
+		if (s + 1 < m)
+		    for (size_t b = 0; b < len; ++b)
+			x1[b] = lo[s + 1] + width[s + 1] * x1[b];
+	    }
+	}
+    };
+
+    // independent normal deviates by Marsaglia's polar method, which needs
+    // neither sine nor cosine: for (u, v) uniform in the unit disk and
+    // q = u^2 + v^2, u f and v f with f = sqrt(-2 ln(q) / q) are normal. As
+    // for the sphere below, the first attempt for a pair of scalars is made
+    // across the block, rejected samples (21 %) are retried one by one.
+    template <typename R>
+    struct random_gaussian_dist {
+	static const uint32_t id = 2 << 24;
+	size_t m;
+	R sigma;
+
+	bool attempt(R u, R v, R& x, R& y) const
+	{
+	    u = 2 * u - 1;
+	    v = 2 * v - 1;
+	    const R q = u * u + v * v;
+	    const bool ok = q < 1 && q > 0;
+	    const R qq = ok ? q : R(0.5);
+	    const R f = sigma * std::sqrt(-2 * std::log(qq) / qq);
+	    x = u * f;
+	    y = v * f;
+	    return ok;
+	}
+
+	void operator()(const counter_rng& rng, uint64_t first, size_t len,
+			R* x) const
+	{
+	    R u0[random_block], u1[random_block], y[random_block];
+	    bool ok[random_block];
+	    for (size_t s = 0; s < m; s += 2) {
+		const uint32_t draw = id | uint32_t(s / 2) << 12;
+		R* x0 = x + s * random_block;
+		R* x1 = s + 1 < m ? x + (s + 1) * random_block : y;
+		random_uniform_block(rng, first, len, draw, false, u0, u1);
+		for (size_t b = 0; b < len; ++b)
+		    ok[b] = attempt(u0[b], u1[b], x0[b], x1[b]);
+		for (size_t b = 0; b < len; ++b)
+		    for (uint32_t j = 1; !ok[b]; ++j) {
+			uint32_t w[4];
+			rng.bits(first + b, draw | j, w);
+			ok[b] = attempt(random_uniform<R>(w[0], w[1], false),
+					random_uniform<R>(w[2], w[3], false),
+					x0[b], x1[b]);
+		    }
+	    }
+	}
+    };
+
+    // uniform on the unit sphere in three dimensions by Marsaglia's method
+    // (Ann. Math. Stat. 43, 645 (1972)): the first attempt is made across
+    // the block, rejected samples (21 %) are retried one by one
+    template <typename R>
+    struct random_sphere3_dist {
+	static const uint32_t id = 3 << 24;
+	size_t m;
+
+	static bool attempt(R u, R v, R& x, R& y, R& z)
+	{
+	    u = 2 * u - 1;
+	    v = 2 * v - 1;
+	    const R s = u * u + v * v;
+	    const R t = 2 * std::sqrt(std::max(R(0), 1 - s));
+	    x = u * t;
+	    y = v * t;
+	    z = 1 - 2 * s;
+	    return s < 1 && s > 0;
+	}
+
+	void operator()(const counter_rng& rng, uint64_t first, size_t len,
+			R* x) const
+	{
+	    R* x0 = x;
+	    R* x1 = x + random_block;
+	    R* x2 = x + 2 * random_block;
+	    R u0[random_block], u1[random_block];
+	    bool ok[random_block];
+	    random_uniform_block(rng, first, len, id, false, u0, u1);
+	    for (size_t b = 0; b < len; ++b)
+		ok[b] = attempt(u0[b], u1[b], x0[b], x1[b], x2[b]);
+	    for (size_t b = 0; b < len; ++b)
+		for (uint32_t j = 1; !ok[b]; ++j) {
+		    uint32_t w[4];
+		    rng.bits(first + b, id | j, w);
+		    ok[b] = attempt(random_uniform<R>(w[0], w[1], false),
+				    random_uniform<R>(w[2], w[3], false),
+				    x0[b], x1[b], x2[b]);
+		}
+	}
+    };
+
+    // uniform on the unit sphere in any dimension: normalized Gaussians
+    template <typename R>
+    struct random_sphere_dist {
+	size_t m;
+
+	void operator()(const counter_rng& rng, uint64_t first, size_t len,
+			R* x) const
+	{
+	    random_gaussian_dist<R>{m, R(1)}(rng, first, len, x);
+	    R norm2[random_block] = {};
+	    for (size_t s = 0; s < m; ++s)
+		for (size_t b = 0; b < len; ++b)
+		    norm2[b] += x[s * random_block + b] * x[s * random_block + b];
+	    for (size_t b = 0; b < len; ++b)
+		norm2[b] = 1 / std::sqrt(norm2[b]);
+	    for (size_t s = 0; s < m; ++s)
+		for (size_t b = 0; b < len; ++b)
+		    x[s * random_block + b] *= norm2[b];
+	}
+    };
+
+
+    // component i of sample b from the scratch block
+    template <typename T, typename R>
+    typename std::enable_if<!is_complex<T>::value, T>::type
+    random_component(const R* x, size_t i, size_t b)
+    {
+        return T(x[i * random_block + b]);
+    }
+
+    template <typename T, typename R>
+    typename std::enable_if<is_complex<T>::value, T>::type
+    random_component(const R* x, size_t i, size_t b)
+    {
+        return T(x[2 * i * random_block + b], x[(2 * i + 1) * random_block + b]);
+    }
+
+    // real scalars of a component
+    template <typename R>
+    void random_flatten(const R& x, R* out)
+    {
+        out[0] = x;
+    }
+
+    template <typename R>
+    void random_flatten(const std::complex<R>& x, R* out)
+    {
+        out[0] = x.real();
+        out[1] = x.imag();
+    }
+
+    template <typename T, typename R = typename norm_type<T>::type>
+    struct random_real {
+	static_assert(std::is_same<T, R>::value ||
+		      std::is_same<T, std::complex<R>>::value,
+		      "random vectors require floating point components");
+	typedef R type;
+    };
+
+    // n samples from the current position on, which is then advanced by n
+    template <size_t N, typename T, typename Dist>
+    void random_generate(counter_rng& rng, const Dist& dist, vec<N,T>* out,
+                         size_t n)
+    {
+        typedef typename random_real<T>::type R;
+        std::vector<R> x(N * random_scalars<T>::value * random_block);
+        for (size_t b = 0; b < n; b += random_block) {
+            const size_t len = std::min(random_block, n - b);
+            dist(rng, rng.position() + b, len, x.data());
+            for (size_t k = 0; k < len; ++k)
+                for (size_t i = 0; i < N; ++i)
+                    out[b + k][i] = random_component<T>(x.data(), i, k);
+        }
+        rng.discard(n);
+    }
+
+    template <size_t N, typename T, typename Dist>
+    void random_generate(counter_rng& rng, const Dist& dist,
+                         vec_array<N,T>& out)
+    {
+        typedef typename random_real<T>::type R;
+        std::vector<R> x(N * random_scalars<T>::value * random_block);
+        const size_t n = out.size();
+        for (size_t b = 0; b < n; b += random_block) {
+            const size_t len = std::min(random_block, n - b);
+            dist(rng, rng.position() + b, len, x.data());
+            for (size_t i = 0; i < N; ++i) {
+                T* c = out.component(i) + b;
+                for (size_t k = 0; k < len; ++k)
+                    c[k] = random_component<T>(x.data(), i, k);
+            }
+        }
+        rng.discard(n);
+    }
+
+
+    // Batch sampling into arrays of vec<N,T> for floating point or complex
+    // T, given as pointer and count, std::vector or vec_array, e.g.
+    //
+    //     counter_rng rng(seed);
+    //     std::vector<vec<3>> spins(n);
+    //     random_sphere(rng, spins);
+
+    // uniform in the box [lo, hi); complex components have their real and
+    // imaginary parts uniform in the respective intervals
+    template <size_t N, typename T,
+              typename R = typename random_real<T>::type>
+    random_box_dist<R> make_random_box(const vec<N,T>& lo, const vec<N,T>& hi)
+    {
+        const size_t m = N * random_scalars<T>::value;
+        random_box_dist<R> dist{std::vector<R>(m), std::vector<R>(m)};
+        for (size_t i = 0; i < N; ++i) {
+            random_flatten(lo[i], &dist.lo[i * random_scalars<T>::value]);
+            random_flatten(T(hi[i] - lo[i]),
+                           &dist.width[i * random_scalars<T>::value]);
+        }
+        return dist;
+    }
+
+    template <size_t N, typename T>
+    void random_box(counter_rng& rng, vec<N,T>* out, size_t n,
+                    const vec<N,T>& lo, const vec<N,T>& hi)
+    {
+        random_generate(rng, make_random_box(lo, hi), out, n);
+    }
+
+    template <size_t N, typename T>
+    void random_box(counter_rng& rng, std::vector<vec<N,T>>& out,
+                    const vec<N,T>& lo, const vec<N,T>& hi)
+    {
+        random_generate(rng, make_random_box(lo, hi), out.data(), out.size());
+    }
+
+    template <size_t N, typename T>
+    void random_box(counter_rng& rng, vec_array<N,T>& out,
+                    const vec<N,T>& lo, const vec<N,T>& hi)
+    {
+        random_generate(rng, make_random_box(lo, hi), out);
+    }
+
+    // isotropic Gaussian with zero mean and standard deviation sigma per
+    // real component; complex components are circularly symmetric with
+    // E|z|^2 = sigma^2
+    template <size_t N, typename T,
+              typename R = typename random_real<T>::type>
+    random_gaussian_dist<R> make_random_gaussian(R sigma)
+    {
+        return {N * random_scalars<T>::value,
+                is_complex<T>::value ? sigma / std::sqrt(R(2)) : sigma};
+    }
+
+    template <size_t N, typename T>
+    void random_gaussian(counter_rng& rng, vec<N,T>* out, size_t n,
+                         typename norm_type<T>::type sigma = 1)
+    {
+        random_generate(rng, make_random_gaussian<N,T>(sigma), out, n);
+    }
+
+    template <size_t N, typename T>
+    void random_gaussian(counter_rng& rng, std::vector<vec<N,T>>& out,
+                         typename norm_type<T>::type sigma = 1)
+    {
+        random_generate(rng, make_random_gaussian<N,T>(sigma), out.data(),
+                        out.size());
+    }
+
+    template <size_t N, typename T>
+    void random_gaussian(counter_rng& rng, vec_array<N,T>& out,
+                         typename norm_type<T>::type sigma = 1)
+    {
+        random_generate(rng, make_random_gaussian<N,T>(sigma), out);
+    }
+
+    // uniform on the unit sphere, for real T; Marsaglia's method for N = 3
+    template <size_t N, typename T>
+    using random_sphere_dist_for = typename std::conditional<N == 3,
+        random_sphere3_dist<T>, random_sphere_dist<T>>::type;
+
+    template <size_t N, typename T>
+    void random_sphere(counter_rng& rng, vec<N,T>* out, size_t n)
+    {
+        static_assert(!is_complex<T>::value, "sphere requires real vectors");
+        random_generate(rng, random_sphere_dist_for<N,T>{N}, out, n);
+    }
+
+    template <size_t N, typename T>
+    void random_sphere(counter_rng& rng, std::vector<vec<N,T>>& out)
+    {
+        random_sphere(rng, out.data(), out.size());
+    }
+
+    template <size_t N, typename T>
+    void random_sphere(counter_rng& rng, vec_array<N,T>& out)
+    {
+        static_assert(!is_complex<T>::value, "sphere requires real vectors");
+        random_generate(rng, random_sphere_dist_for<N,T>{N}, out);
+    }
+}
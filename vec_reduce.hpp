@@ -0,0 +1,265 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.hpp"
+#include "vec_accumulate.hpp"
+
+namespace Vec {
+    // Reductions over ranges of vec<N,T> (any random access range whose
+    // elements act like vec<N,T>, e.g. std::vector<vec<N,T>> or vec_array).
+    //
+    // The range is split into blocks which are reduced concurrently using
+    // compensated (Neumaier) summation; the partial results are then
+    // combined pairwise in a fixed order. By default, there is one block per
+    // thread. In reproducible mode, the block size is fixed instead, so that
+    // the result is bit-identical regardless of the number of threads.
+    struct reduce_policy {
+	unsigned threads;   // 0: one per hardware thread
+	bool reproducible;
+
+	static reduce_policy serial()
+	{
+	    return {1, false};
+	}
+
+	static reduce_policy parallel(unsigned threads = 0)
+	{
+	    return {threads, false};
+	}
+
+	static reduce_policy reproducible_parallel(unsigned threads = 0)
+	{
+	    return {threads, true};
+	}
+    };
+
+    const size_t reduce_block_size = 4096;
+
+    // minimum number of elements per thread worth the spawning
+    const size_t reduce_grain_size = 1 << 14;
+
+
+    // Reduce [first, first + n) by applying `block(it, len)` to consecutive
+    // blocks, possibly concurrently, and combining the partial results
+    // pairwise via `combine(lhs, rhs)`.
+    template <typename Acc, typename RandomIt, typename Block, typename Combine>
+    Acc reduce_blocks(RandomIt first, size_t n, reduce_policy policy,
+                      Block block, Combine combine)
+    {
+        unsigned threads = policy.threads ? policy.threads
+            : std::max(1u, std::thread::hardware_concurrency());
+        threads = unsigned(std::max<size_t>(1, std::min<size_t>(
+            threads, n / reduce_grain_size)));
+        size_t bs = policy.reproducible ? reduce_block_size
+            : (n + threads - 1) / threads;
+        bs = std::max<size_t>(bs, 1);
+        const size_t m = n ? (n + bs - 1) / bs : 0;
+        if (m == 0)
+            return Acc();
+        threads = unsigned(std::min<size_t>(threads, m));
+
+        std::vector<Acc> partial(m);
+        auto work = [&](size_t t) {
+            for (size_t b = t; b < m; b += threads)
+                partial[b] = block(first + b * bs, std::min(bs, n - b * bs));
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+            pool.emplace_back(work, t);
+        work(0);
+        for (std::thread& t : pool)
+            t.join();
+
+        // pairwise combination in a fixed order
+        for (size_t stride = 1; stride < m; stride *= 2)
+            for (size_t b = 0; b + stride < m; b += 2 * stride)
+                partial[b] = combine(partial[b], partial[b + stride]);
+        return partial[0];
+    }
+
+    template <typename V> struct vec_traits;
+
+    template <size_t N_, typename T>
+    struct vec_traits<vec<N_,T>> {
+	static const size_t N = N_;
+	typedef T value_type;
+	// type of averages: integers are averaged in double precision
+	typedef typename std::conditional<std::is_integral<T>::value,
+					  double, T>::type mean_type;
+	typedef decltype(vec<N_,T>().norm2_sq()) norm2_sq_type;
+	typedef decltype(std::sqrt(norm2_sq_type())) norm_type;
+    };
+
+    // the vec type of a range's elements
+    template <typename RandomIt>
+    using range_vec = typename std::iterator_traits<RandomIt>::value_type;
+
+
+    // sum of all vectors in the range, with the components converted to S
+    // before they are added
+    template <typename S, typename RandomIt, typename V = range_vec<RandomIt>,
+              size_t N = vec_traits<V>::N>
+    vec<N,S> reduce_sum(RandomIt first, RandomIt last, reduce_policy policy)
+    {
+        typedef compensated<vec<N,S>> acc;
+        return reduce_blocks<acc>(first, size_t(last - first), policy,
+            [](RandomIt it, size_t len) {
+                acc a;
+                for (size_t k = 0; k < len; ++k, ++it)
+                    a.add(*it);
+                return a;
+            },
+            [](acc lhs, const acc& rhs) {
+                lhs.merge(rhs);
+                return lhs;
+            }).value();
+    }
+
+    // sum of all vectors in the range; the accumulation policy chooses the
+    // type the components are added in, e.g. sum<accumulate_wide> adds
+    // float in double (the summation itself is always compensated)
+    template <typename Policy = void, typename RandomIt,
+              typename V = range_vec<RandomIt>,
+              typename S = typename accumulator_for<
+                  Policy, typename vec_traits<V>::value_type>::type>
+    vec<vec_traits<V>::N, S>
+    sum(RandomIt first, RandomIt last,
+        reduce_policy policy = reduce_policy::parallel())
+    {
+        return reduce_sum<S>(first, last, policy);
+    }
+
+
+    // arithmetic mean of a nonempty range, summed in the mean type, so that
+    // e.g. integers are added in double precision rather than overflowing
+    template <typename Policy = void, typename RandomIt,
+              typename V = range_vec<RandomIt>,
+              typename S = typename accumulator_for<
+                  Policy, typename vec_traits<V>::value_type>::type,
+              typename M = typename vec_traits<
+                  vec<vec_traits<V>::N, S>>::mean_type>
+    vec<vec_traits<V>::N, M>
+    mean(RandomIt first, RandomIt last,
+         reduce_policy policy = reduce_policy::parallel())
+    {
+        typedef decltype(std::abs(M())) R;
+        vec<vec_traits<V>::N, M> res = reduce_sum<M>(first, last, policy);
+        res /= M(R(last - first));
+        return res;
+    }
+
+    // centroid of the points in a nonempty range
+    template <typename Policy = void, typename RandomIt,
+              typename V = range_vec<RandomIt>,
+              typename S = typename accumulator_for<
+                  Policy, typename vec_traits<V>::value_type>::type,
+              typename M = typename vec_traits<
+                  vec<vec_traits<V>::N, S>>::mean_type>
+    vec<vec_traits<V>::N, M>
+    centroid(RandomIt first, RandomIt last,
+             reduce_policy policy = reduce_policy::parallel())
+    {
+        return mean<Policy>(first, last, policy);
+    }
+
+    // weighted centroid, e.g. centre of mass, with the weights given by the
+    // range starting at `weights`
+    template <typename Policy = void, typename RandomIt, typename WeightIt,
+              typename V = range_vec<RandomIt>,
+              typename W = typename std::iterator_traits<WeightIt>::value_type,
+              typename M = typename accumulator_for<Policy,
+                  decltype(W() * typename vec_traits<V>::value_type())>::type>
+    vec<vec_traits<V>::N, M>
+    centroid(RandomIt first, RandomIt last, WeightIt weights,
+             reduce_policy policy = reduce_policy::parallel())
+    {
+        const size_t N = vec_traits<V>::N;
+        typedef std::pair<compensated<vec<N,M>>, compensated<M>> acc;
+        const RandomIt begin = first;
+        acc res = reduce_blocks<acc>(first, size_t(last - first), policy,
+            [begin, weights](RandomIt it, size_t len) {
+                acc a;
+                WeightIt w = weights + (it - begin);
+                for (size_t k = 0; k < len; ++k, ++it, ++w) {
+                    vec<N,M> x = *it;
+                    x *= M(*w);
+                    a.first.add(x);
+                    a.second.add(M(*w));
+                }
+                return a;
+            },
+            [](acc lhs, const acc& rhs) {
+                lhs.first.merge(rhs.first);
+                lhs.second.merge(rhs.second);
+                return lhs;
+            });
+        vec<N,M> c = res.first.value();
+        c /= res.second.value();
+        return c;
+    }
+
+    // smallest and largest 2-norm in a nonempty range
+    template <typename RandomIt, typename V = range_vec<RandomIt>,
+              typename R = typename vec_traits<V>::norm_type>
+    std::pair<R,R> minmax_norm(RandomIt first, RandomIt last,
+                               reduce_policy policy = reduce_policy::parallel())
+    {
+        typedef typename vec_traits<V>::norm2_sq_type S;
+        typedef std::pair<S,S> acc;
+        // compare squared norms and only take the roots of the extrema
+        acc res = reduce_blocks<acc>(first, size_t(last - first), policy,
+            [](RandomIt it, size_t len) {
+                S n2 = V(*it).norm2_sq();
+                acc a(n2, n2);
+                for (size_t k = 1; k < len; ++k) {
+                    n2 = V(*++it).norm2_sq();
+                    a.first = std::min(a.first, n2);
+                    a.second = std::max(a.second, n2);
+                }
+                return a;
+            },
+            [](const acc& lhs, const acc& rhs) {
+                return acc(std::min(lhs.first, rhs.first),
+                           std::max(lhs.second, rhs.second));
+            });
+        return {std::sqrt(res.first), std::sqrt(res.second)};
+    }
+
+    template <typename RandomIt, typename V = range_vec<RandomIt>,
+              typename R = typename vec_traits<V>::norm_type>
+    R min_norm(RandomIt first, RandomIt last,
+               reduce_policy policy = reduce_policy::parallel())
+    {
+        return minmax_norm(first, last, policy).first;
+    }
+
+    template <typename RandomIt, typename V = range_vec<RandomIt>,
+              typename R = typename vec_traits<V>::norm_type>
+    R max_norm(RandomIt first, RandomIt last,
+               reduce_policy policy = reduce_policy::parallel())
+    {
+        return minmax_norm(first, last, policy).second;
+    }
+}
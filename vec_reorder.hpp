@@ -0,0 +1,549 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+#include "vec_parallel.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define VEC_REORDER_X86 1
+#define VEC_REORDER_BMI2 __attribute__((target("bmi2")))
+#endif
+
+namespace Vec {
+    // Reordering of point sets along space-filling curves (SFCs), so that
+    // points close in space end up close in memory, e.g. to restore the
+    // cache locality of neighbour loops after particles have diffused.
+    //
+    // Coordinates are quantized on a cubic grid of 2^sfc_bits<N> cells per
+    // axis spanning the bounding box; the cell of each point is mapped to
+    // its index along the Morton (Z-order) or Hilbert curve. The Hilbert
+    // curve only ever steps to an adjacent cell and so preserves locality
+    // somewhat better, at a higher cost per key. The points are then sorted
+    // by key with a parallel radix sort, which returns the permutation to
+    // apply to data associated with the points.
+    enum class sfc_curve { morton, hilbert };
+
+    // bits per coordinate: 2 x 32 or 3 x 21 bits fill a 64 bit key
+    template <size_t N>
+    constexpr unsigned sfc_bits()
+    {
+        static_assert(N == 2 || N == 3, "SFC keys are provided for N = 2, 3");
+        return N == 2 ? 32 : 21;
+    }
+
+    // every N-th bit, starting with the least significant one
+    template <size_t N>
+    constexpr uint64_t morton_mask()
+    {
+        return N == 2 ? 0x5555555555555555ull : 0x1249249249249249ull;
+    }
+
+    // spread the bits of x to every N-th position
+    template <size_t N>
+    constexpr uint64_t morton_spread(uint64_t x)
+    {
+        if (N == 2) {
+            x &= 0xffffffffull;
+            x = (x | x << 16) & 0x0000ffff0000ffffull;
+            x = (x | x << 8) & 0x00ff00ff00ff00ffull;
+            x = (x | x << 4) & 0x0f0f0f0f0f0f0f0full;
+            x = (x | x << 2) & 0x3333333333333333ull;
+            x = (x | x << 1) & 0x5555555555555555ull;
+        } else {
+            x &= 0x1fffffull;
+            x = (x | x << 32) & 0x001f00000000ffffull;
+            x = (x | x << 16) & 0x001f0000ff0000ffull;
+            x = (x | x << 8) & 0x100f00f00f00f00full;
+            x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+            x = (x | x << 2) & 0x1249249249249249ull;
+        }
+        return x;
+    }
+
+    // inverse of morton_spread
+    template <size_t N>
+    constexpr uint64_t morton_compact(uint64_t x)
+    {
+        if (N == 2) {
+            x &= 0x5555555555555555ull;
+            x = (x | x >> 1) & 0x3333333333333333ull;
+            x = (x | x >> 2) & 0x0f0f0f0f0f0f0f0full;
+            x = (x | x >> 4) & 0x00ff00ff00ff00ffull;
+            x = (x | x >> 8) & 0x0000ffff0000ffffull;
+            x = (x | x >> 16) & 0x00000000ffffffffull;
+        } else {
+            x &= 0x1249249249249249ull;
+            x = (x | x >> 2) & 0x10c30c30c30c30c3ull;
+            x = (x | x >> 4) & 0x100f00f00f00f00full;
+            x = (x | x >> 8) & 0x001f0000ff0000ffull;
+            x = (x | x >> 16) & 0x001f00000000ffffull;
+            x = (x | x >> 32) & 0x00000000001fffffull;
+        }
+        return x;
+    }
+
+    // Morton code of a grid cell: the bits of the coordinates interleaved,
+    // with component 0 the most significant in each group of N bits, which
+    // is the order of morton_less in vec_hash.hpp
+    template <size_t N, typename U>
+    constexpr uint64_t morton_encode(const vec<N,U>& a)
+    {
+        static_assert(std::is_unsigned<U>::value,
+                      "morton_encode requires unsigned coordinates");
+        uint64_t code = 0;
+        for (size_t i = 0; i < N; ++i)
+            code |= morton_spread<N>(a[i]) << (N - 1 - i);
+        return code;
+    }
+
+    template <size_t N>
+    constexpr vec<N,uint32_t> morton_decode(uint64_t code)
+    {
+        vec<N,uint32_t> a;
+        for (size_t i = 0; i < N; ++i)
+            a[i] = uint32_t(morton_compact<N>(code >> (N - 1 - i)));
+        return a;
+    }
+
+#ifdef VEC_REORDER_X86
+    // the same with the BMI2 bit deposit/extract instructions
+    template <size_t N, typename U>
+    VEC_REORDER_BMI2 inline uint64_t morton_encode_bmi2(const vec<N,U>& a)
+    {
+        uint64_t code = 0;
+        for (size_t i = 0; i < N; ++i)
+            code |= _pdep_u64(a[i], morton_mask<N>() << (N - 1 - i));
+        return code;
+    }
+
+    template <size_t N>
+    VEC_REORDER_BMI2 inline vec<N,uint32_t> morton_decode_bmi2(uint64_t code)
+    {
+        vec<N,uint32_t> a;
+        for (size_t i = 0; i < N; ++i)
+            a[i] = uint32_t(_pext_u64(code, morton_mask<N>() << (N - 1 - i)));
+        return a;
+    }
+#endif
+
+    // one step of the inverse undo of the Hilbert transpose: invert the
+    // bits p of x0 if bit q of xi is set, otherwise exchange them between
+    // x0 and xi (for xi = x0, nothing but the inversion happens); the
+    // branch of the original algorithm is unpredictable and so replaced by
+    // masks
+    template <typename U>
+    constexpr void hilbert_undo(U& x0, U& xi, U q)
+    {
+        const U p = q - 1;
+        const U set = U(0) - U((xi & q) != 0);
+        const U t = (x0 ^ xi) & p & ~set;
+        x0 ^= (p & set) ^ t;
+        xi ^= t;
+    }
+
+    template <size_t N, typename U, size_t... I>
+    constexpr void hilbert_undo(vec<N,U>& x, U q, std::index_sequence<I...>)
+    {
+        int expand[] = {(hilbert_undo(x[0], x[I], q), 0)...};
+        (void) expand;
+    }
+
+    // Hilbert transpose of a cell with coordinates below 2^bits (Skilling,
+    // AIP Conf. Proc. 707, 381 (2004)): interleaving the bits of the result
+    // as by morton_encode gives the index along the Hilbert curve
+    template <size_t N, typename U>
+    constexpr vec<N,U> hilbert_transpose(vec<N,U> x, unsigned bits)
+    {
+        const U m = U(1) << (bits - 1);
+        for (U q = m; q > 1; q >>= 1)
+            hilbert_undo(x, q, std::make_index_sequence<N>());
+        // Gray encode
+        for (size_t i = 1; i < N; ++i)
+            x[i] ^= x[i - 1];
+        U t = 0;
+        for (U q = m; q > 1; q >>= 1)
+            t ^= (q - 1) & (U(0) - U((x[N - 1] & q) != 0));
+        for (size_t i = 0; i < N; ++i)
+            x[i] ^= t;
+        return x;
+    }
+
+    template <size_t N, typename U>
+    constexpr uint64_t hilbert_encode(const vec<N,U>& a,
+                                      unsigned bits = sfc_bits<N>())
+    {
+        return morton_encode(hilbert_transpose(a, bits));
+    }
+
+
+    // Cubic grid of 2^sfc_bits<N> cells per axis covering a box; points
+    // outside are assigned to the nearest cell. Positions are scaled in
+    // double precision, since float cannot represent the top cell index
+    // 2^32 - 1 for N = 2.
+    template <size_t N, typename T>
+    class sfc_grid {
+	static_assert(std::is_floating_point<T>::value,
+		      "sfc_grid requires floating point coordinates");
+	vec<N,T> lo;
+	double scale;
+    public:
+	static constexpr unsigned bits = sfc_bits<N>();
+
+	sfc_grid(const vec<N,T>& l, const vec<N,T>& h) : lo(l), scale(0)
+	{
+	    double extent = 0;
+	    for (size_t i = 0; i < N; ++i)
+		extent = std::max(extent, double(h[i]) - double(l[i]));
+	    if (extent > 0)
+		scale = double((uint64_t(1) << bits) - 1) / extent;
+	}
+
+	// the grid over the bounding box of a nonempty set of points
+	static sfc_grid bounding(const vec<N,T>* x, size_t n)
+	{
+	    vec<N,T> l = x[0], h = x[0];
+	    for (size_t k = 1; k < n; ++k)
+		for (size_t i = 0; i < N; ++i) {
+		    l[i] = std::min(l[i], x[k][i]);
+		    h[i] = std::max(h[i], x[k][i]);
+		}
+	    return sfc_grid(l, h);
+	}
+
+	vec<N,uint32_t> cell(const vec<N,T>& x) const
+	{
+	    const double top = double((uint64_t(1) << bits) - 1);
+	    vec<N,uint32_t> c;
+	    for (size_t i = 0; i < N; ++i) {
+		const double u = (double(x[i]) - double(lo[i])) * scale;
+		// also maps NaN to cell 0
+		c[i] = u > 0 ? uint32_t(std::min(u, top)) : 0;
+	    }
+	    return c;
+	}
+    };
+
+    template <size_t N, typename T>
+    constexpr unsigned sfc_grid<N,T>::bits;
+
+    // use the BMI2 kernels if the CPU supports them. pdep/pext are slow on
+    // AMD processors before Zen 3, where sfc_select_bmi2(false) may be
+    // preferable.
+    inline bool sfc_detect_bmi2()
+    {
+#ifdef VEC_REORDER_X86
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2");
+#else
+        return false;
+#endif
+    }
+
+    inline bool& sfc_bmi2_current()
+    {
+        static bool bmi2 = sfc_detect_bmi2();
+        return bmi2;
+    }
+
+    inline bool sfc_bmi2_active()
+    {
+        return sfc_bmi2_current();
+    }
+
+    inline void sfc_select_bmi2(bool enable)
+    {
+        sfc_bmi2_current() = enable && sfc_detect_bmi2();
+    }
+
+    template <size_t N, typename T>
+    void sfc_keys_portable(const vec<N,T>* x, size_t first, size_t last,
+                           const sfc_grid<N,T>& grid, sfc_curve curve,
+                           uint64_t* keys)
+    {
+        const unsigned bits = sfc_grid<N,T>::bits;
+        if (curve == sfc_curve::morton)
+            for (size_t k = first; k < last; ++k)
+                keys[k] = morton_encode(grid.cell(x[k]));
+        else
+            for (size_t k = first; k < last; ++k)
+                keys[k] = morton_encode(hilbert_transpose(grid.cell(x[k]),
+                                                          bits));
+    }
+
+#ifdef VEC_REORDER_X86
+    template <size_t N, typename T>
+    VEC_REORDER_BMI2
+    void sfc_keys_bmi2(const vec<N,T>* x, size_t first, size_t last,
+                       const sfc_grid<N,T>& grid, sfc_curve curve,
+                       uint64_t* keys)
+    {
+        const unsigned bits = sfc_grid<N,T>::bits;
+        if (curve == sfc_curve::morton)
+            for (size_t k = first; k < last; ++k)
+                keys[k] = morton_encode_bmi2(grid.cell(x[k]));
+        else
+            for (size_t k = first; k < last; ++k)
+                keys[k] = morton_encode_bmi2(hilbert_transpose(
+                    grid.cell(x[k]), bits));
+    }
+#endif
+
+    // keys along the curve of the points x[0], ..., x[n-1]
+    template <size_t N, typename T>
+    void sfc_keys(const vec<N,T>* x, size_t n, const sfc_grid<N,T>& grid,
+                  sfc_curve curve, uint64_t* keys,
+                  thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(n, [=, &grid](size_t b, size_t e) {
+#ifdef VEC_REORDER_X86
+            if (sfc_bmi2_active())
+                return sfc_keys_bmi2(x, b, e, grid, curve, keys);
+#endif
+            sfc_keys_portable(x, b, e, grid, curve, keys);
+        });
+    }
+
+    template <size_t N, typename T>
+    std::vector<uint64_t> sfc_keys(const std::vector<vec<N,T>>& x,
+                                   sfc_curve curve,
+                                   thread_pool& pool = thread_pool::global())
+    {
+        std::vector<uint64_t> keys(x.size());
+        if (!x.empty())
+            sfc_keys(x.data(), x.size(),
+                     sfc_grid<N,T>::bounding(x.data(), x.size()), curve,
+                     keys.data(), pool);
+        return keys;
+    }
+
+
+    struct radix_item {
+	uint64_t key;
+	size_t index;
+    };
+
+    // digits of the passes in cache, and of the first pass over all keys
+    const unsigned radix_digit_bits = 8;
+    const unsigned radix_top_bits = 11;
+
+    // ranges of up to this many keys are sorted in cache right away
+    const size_t radix_cache_size = 1 << 14;
+
+    // minimum number of keys per thread worth the synchronization
+    const size_t radix_grain_size = 1 << 16;
+
+    // number of significant bits
+    inline unsigned radix_width(uint64_t x)
+    {
+        unsigned w = 0;
+        for (; x; x >>= 1)
+            ++w;
+        return w;
+    }
+
+    // stable sort of a[0, n) by the lowest `bits` bits of the keys (the
+    // others being equal), least significant digit first, using tmp as
+    // scratch space
+    inline void radix_sort_lsd(radix_item* a, radix_item* tmp, size_t n,
+                               unsigned bits)
+    {
+        const size_t buckets = size_t(1) << radix_digit_bits;
+        if (n <= 32) {
+            // insertion sort
+            for (size_t k = 1; k < n; ++k) {
+                const radix_item x = a[k];
+                size_t j = k;
+                for (; j > 0 && a[j - 1].key > x.key; --j)
+                    a[j] = a[j - 1];
+                a[j] = x;
+            }
+            return;
+        }
+        // histograms of all digits in a single pass
+        const unsigned passes = (bits + radix_digit_bits - 1) / radix_digit_bits;
+        size_t hist[64 / radix_digit_bits][buckets];
+        std::fill(hist[0], hist[passes], 0);
+        for (size_t k = 0; k < n; ++k)
+            for (unsigned p = 0; p < passes; ++p)
+                ++hist[p][(a[k].key >> (p * radix_digit_bits)) & (buckets - 1)];
+        radix_item* in = a;
+        radix_item* out = tmp;
+        for (unsigned p = 0; p < passes; ++p) {
+            size_t* h = hist[p];
+            if (*std::max_element(h, h + buckets) == n)
+                continue;
+            size_t offset = 0;
+            for (size_t d = 0; d < buckets; ++d) {
+                const size_t count = h[d];
+                h[d] = offset;
+                offset += count;
+            }
+            const unsigned shift = p * radix_digit_bits;
+            for (size_t k = 0; k < n; ++k)
+                out[h[(in[k].key >> shift) & (buckets - 1)]++] = in[k];
+            std::swap(in, out);
+        }
+        if (in != a)
+            std::copy(in, in + n, a);
+    }
+
+    // Sorts the keys with a radix sort and returns the permutation: after
+    // the call, keys[k] is the key formerly at perm[k]. The sort is stable,
+    // so equal keys keep their relative order.
+    //
+    // Only the bits in which the keys differ are sorted by. A first pass
+    // distributes the keys by the top radix_top_bits of those into buckets
+    // small enough to be sorted in cache, least significant digit first,
+    // unlike the keys as a whole, whose passes would each have to stream
+    // all keys through memory. For the first pass, the keys are split into
+    // one contiguous chunk per thread, which are histogrammed and then
+    // scattered to offsets ordered by digit, then by chunk; the buckets are
+    // then sorted concurrently.
+    inline std::vector<size_t>
+    radix_sort_permutation(std::vector<uint64_t>& keys,
+                           thread_pool& pool = thread_pool::global())
+    {
+        const size_t n = keys.size();
+        std::vector<radix_item> a(n), b(n);
+        uint64_t any = 0, all = ~uint64_t(0);
+        for (size_t k = 0; k < n; ++k) {
+            a[k] = {keys[k], k};
+            any |= keys[k];
+            all &= keys[k];
+        }
+        const unsigned width = n ? radix_width(any ^ all) : 0;
+
+        if (n <= radix_cache_size || width <= radix_top_bits) {
+            radix_sort_lsd(a.data(), b.data(), n, width);
+            a.swap(b);
+        } else {
+            const unsigned shift = width - radix_top_bits;
+            const size_t buckets = size_t(1) << radix_top_bits;
+            const size_t chunks = std::max<size_t>(1, std::min<size_t>(
+                pool.concurrency(), n / radix_grain_size));
+            std::vector<size_t> hist(chunks * buckets), start(buckets + 1);
+            auto digit = [shift](uint64_t key) {
+                return size_t(key >> shift) & (buckets - 1);
+            };
+            pool.parallel_for(chunks, [&](size_t cb, size_t ce) {
+                for (size_t c = cb; c < ce; ++c) {
+                    size_t* h = &hist[c * buckets];
+                    for (size_t k = n * c / chunks; k < n * (c + 1) / chunks;
+                         ++k)
+                        ++h[digit(a[k].key)];
+                }
+            }, 1);
+            size_t offset = 0;
+            for (size_t d = 0; d < buckets; ++d) {
+                start[d] = offset;
+                for (size_t c = 0; c < chunks; ++c) {
+                    const size_t count = hist[c * buckets + d];
+                    hist[c * buckets + d] = offset;
+                    offset += count;
+                }
+            }
+            start[buckets] = n;
+            pool.parallel_for(chunks, [&](size_t cb, size_t ce) {
+                for (size_t c = cb; c < ce; ++c) {
+                    size_t* h = &hist[c * buckets];
+                    for (size_t k = n * c / chunks; k < n * (c + 1) / chunks;
+                         ++k)
+                        b[h[digit(a[k].key)]++] = a[k];
+                }
+            }, 1);
+            pool.parallel_for(buckets, [&](size_t db, size_t de) {
+                for (size_t d = db; d < de; ++d)
+                    radix_sort_lsd(&b[start[d]], &a[start[d]],
+                                   start[d + 1] - start[d], shift);
+            }, 16);
+        }
+
+        std::vector<size_t> perm(n);
+        for (size_t k = 0; k < n; ++k) {
+            keys[k] = b[k].key;
+            perm[k] = b[k].index;
+        }
+        return perm;
+    }
+
+    // data[k] = old data[perm[k]]
+    template <typename U>
+    void apply_permutation(const std::vector<size_t>& perm,
+                           std::vector<U>& data,
+                           thread_pool& pool = thread_pool::global())
+    {
+        if (perm.size() != data.size())
+            throw std::invalid_argument("permutation and data differ in size");
+        std::vector<U> out(data.size());
+        pool.parallel_for(perm.size(), [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k)
+                out[k] = std::move(data[perm[k]]);
+        });
+        data.swap(out);
+    }
+
+    // inv[perm[k]] = k, e.g. to translate indices into the old order into
+    // indices into the new one
+    inline std::vector<size_t> invert_permutation(const std::vector<size_t>& perm)
+    {
+        std::vector<size_t> inv(perm.size());
+        for (size_t k = 0; k < perm.size(); ++k)
+            inv[perm[k]] = k;
+        return inv;
+    }
+
+    // the order of the points along the curve, as a permutation
+    template <size_t N, typename T>
+    std::vector<size_t> sfc_order(const std::vector<vec<N,T>>& x,
+                                  sfc_curve curve = sfc_curve::hilbert,
+                                  thread_pool& pool = thread_pool::global())
+    {
+        std::vector<uint64_t> keys = sfc_keys(x, curve, pool);
+        return radix_sort_permutation(keys, pool);
+    }
+
+    template <typename U>
+    void sfc_check_size(size_t n, const std::vector<U>& payload)
+    {
+        if (payload.size() != n)
+            throw std::invalid_argument("payload and points differ in size");
+    }
+
+    // Sorts the points along the curve, along with any number of payload
+    // vectors of the same length (velocities, charges, ...), and returns
+    // the permutation applied: the point now at k was at perm[k].
+    template <size_t N, typename T, typename... Payload>
+    std::vector<size_t> sfc_reorder(std::vector<vec<N,T>>& x,
+                                    sfc_curve curve, Payload&... payload)
+    {
+        int check[] = {0, (sfc_check_size(x.size(), payload), 0)...};
+        (void) check;
+        std::vector<size_t> perm = sfc_order(x, curve);
+        apply_permutation(perm, x);
+        int apply[] = {0, (apply_permutation(perm, payload), 0)...};
+        (void) apply;
+        return perm;
+    }
+}
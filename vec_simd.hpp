@@ -0,0 +1,795 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "vec.hpp"
+
+// products must not be fused into FMAs, which the scalar operators don't use;
+// VEC_SIMD_STRICT marks the portable scalar kernels, VEC_SIMD_NO_CONTRACT
+// opens the body of every kernel
+#ifdef __clang__
+#define VEC_SIMD_STRICT
+#define VEC_SIMD_NO_CONTRACT _Pragma("clang fp contract(off)")
+#elif defined(__GNUC__)
+#define VEC_SIMD_STRICT __attribute__((optimize("fp-contract=off")))
+#define VEC_SIMD_NO_CONTRACT
+#else
+#define VEC_SIMD_STRICT
+#define VEC_SIMD_NO_CONTRACT
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define VEC_SIMD_X86 1
+#define VEC_SIMD_INLINE inline __attribute__((always_inline))
+#ifdef __clang__
+#define VEC_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VEC_SIMD_TARGET(isa) \
+    __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+#endif
+
+namespace Vec {
+    // Explicit SIMD kernels for batches of vec<N,T> with T = float or double.
+    //
+    // The kernels operate on contiguous arrays of vectors, vectorizing across
+    // the elements of the array rather than across the (few) components of
+    // a single vector. Each vector occupies S scalars in memory (S = N for a
+    // plain array of vec<N,T>); passing S = 4 for N = 3 processes data padded
+    // to four lanes. The instruction set is selected at runtime based on the
+    // capabilities of the CPU. Every lane performs the same operations in the
+    // same order as the scalar operators in vec.hpp, and no kernel fuses a
+    // product and a sum into an FMA, so results are the same for every
+    // instruction set. They are bit-identical to those of the operators only
+    // if the code using the operators is compiled with -ffp-contract=off:
+    // GCC otherwise contracts them into FMAs whenever the target has them,
+    // e.g. with -march=native.
+    enum class simd_isa { scalar, sse2, avx2, avx512 };
+
+    inline simd_isa simd_detect()
+    {
+#ifdef VEC_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return simd_isa::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return simd_isa::avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return simd_isa::sse2;
+#endif
+        return simd_isa::scalar;
+    }
+
+    inline simd_isa& simd_current()
+    {
+        static simd_isa isa = simd_detect();
+        return isa;
+    }
+
+    // instruction set used by the kernels
+    inline simd_isa simd_active()
+    {
+        return simd_current();
+    }
+
+    // restrict the kernels to a given instruction set, e.g. to compare
+    // against the scalar path; requests beyond the CPU's capabilities are
+    // capped
+    inline void simd_select(simd_isa isa)
+    {
+        simd_isa max = simd_detect();
+        simd_current() = isa < max ? isa : max;
+    }
+
+
+    // portable scalar kernels, which also handle the remainder of the
+    // vectorized loops
+    template <size_t N, size_t S, typename T>
+    VEC_SIMD_STRICT
+    void simd_dot_scalar(const T* a, const T* b, T* out, size_t first,
+                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k) {
+            T sum = T();
+            for (size_t i = 0; i < N; ++i)
+                sum += a[k*S+i] * b[k*S+i];
+            out[k] = sum;
+        }
+    }
+
+    template <size_t S, typename T>
+    VEC_SIMD_STRICT
+    void simd_cross_scalar(const T* a, const T* b, T* out, size_t first,
+                           size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k) {
+            const T* l = a + k*S;
+            const T* r = b + k*S;
+            out[k*S+0] = l[1] * r[2] - l[2] * r[1];
+            out[k*S+1] = l[2] * r[0] - l[0] * r[2];
+            out[k*S+2] = l[0] * r[1] - l[1] * r[0];
+        }
+    }
+
+    template <typename T>
+    VEC_SIMD_STRICT
+    void simd_axpy_scalar(T alpha, const T* x, T* y, size_t first, size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k)
+            y[k] += x[k] * alpha;
+    }
+
+    template <typename T>
+    VEC_SIMD_STRICT
+    void simd_add_scalar(const T* a, const T* b, T* out, size_t first,
+                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k)
+            out[k] = a[k] + b[k];
+    }
+
+    template <typename T>
+    VEC_SIMD_STRICT
+    void simd_sub_scalar(const T* a, const T* b, T* out, size_t first,
+                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k)
+            out[k] = a[k] - b[k];
+    }
+
+    template <typename T>
+    VEC_SIMD_STRICT
+    void simd_scale_scalar(T alpha, const T* x, T* out, size_t first,
+                           size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k)
+            out[k] = x[k] * alpha;
+    }
+
+    // Hermitian products of complex vectors whose components are addressed
+    // through separate real and imaginary pointers: component i of element k
+    // lives at re[(k*S+i)*Step] and im[(k*S+i)*Step], i.e. Step = 1 for split
+    // storage and Step = 2 for interleaved std::complex data. The results are
+    // written with the same Step. Expanding the complex products by hand
+    // avoids the NaN/inf recovery of complex multiplication (which prevents
+    // vectorization) and gives the same results for finite data, except that
+    // GCC's vectorizer may fuse the complex products of the operators into
+    // FMAs even with -ffp-contract=off; those then differ by rounding.
+    template <size_t N, size_t S, size_t Step, typename T>
+    VEC_SIMD_STRICT
+    void simd_cdot_scalar(const T* are, const T* aim, const T* bre,
+                          const T* bim, T* ore, T* oim, size_t first,
+                          size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k) {
+            T sr = T(), si = T();
+            for (size_t i = 0; i < N; ++i) {
+                const size_t idx = (k*S+i)*Step;
+                sr += are[idx] * bre[idx] + aim[idx] * bim[idx];
+                si += are[idx] * bim[idx] - aim[idx] * bre[idx];
+            }
+            ore[k*Step] = sr;
+            oim[k*Step] = si;
+        }
+    }
+
+    // squared norms only accumulate re^2 + im^2; out is contiguous
+    template <size_t N, size_t S, size_t Step, typename T>
+    VEC_SIMD_STRICT
+    void simd_cnorm2_sq_scalar(const T* re, const T* im, T* out,
+                               size_t first, size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        for (size_t k = first; k < n; ++k) {
+            T sum = T();
+            for (size_t i = 0; i < N; ++i) {
+                const size_t idx = (k*S+i)*Step;
+                sum += re[idx] * re[idx] + im[idx] * im[idx];
+            }
+            out[k] = sum;
+        }
+    }
+
+
+#ifdef VEC_SIMD_X86
+    // Generic vector kernels for W lanes, written with GCC vector
+    // extensions. They are force-inlined into the per-ISA entry points
+    // below and thereby compiled for the respective target.
+    template <typename T, size_t W>
+    struct simd_vector {
+	typedef T type __attribute__((vector_size(W * sizeof(T))));
+    };
+
+    template <size_t W, size_t N, size_t S, typename T>
+    VEC_SIMD_INLINE void simd_dot_kernel(const T* a, const T* b, T* out,
+                                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V sum = {};
+            for (size_t i = 0; i < N; ++i) {
+                V x = {}, y = {};
+                for (size_t j = 0; j < W; ++j) {
+                    x[j] = a[(k+j)*S+i];
+                    y[j] = b[(k+j)*S+i];
+                }
+                sum += x * y;
+            }
+            std::memcpy(out + k, &sum, sizeof(V));
+        }
+        simd_dot_scalar<N,S>(a, b, out, k, n);
+    }
+
+    template <size_t W, size_t S, typename T>
+    VEC_SIMD_INLINE void simd_cross_kernel(const T* a, const T* b, T* out,
+                                           size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V l0 = {}, l1 = {}, l2 = {}, r0 = {}, r1 = {}, r2 = {};
+            for (size_t j = 0; j < W; ++j) {
+                const T* l = a + (k+j)*S;
+                const T* r = b + (k+j)*S;
+                l0[j] = l[0]; l1[j] = l[1]; l2[j] = l[2];
+                r0[j] = r[0]; r1[j] = r[1]; r2[j] = r[2];
+            }
+            V o0 = l1 * r2 - l2 * r1;
+            V o1 = l2 * r0 - l0 * r2;
+            V o2 = l0 * r1 - l1 * r0;
+            for (size_t j = 0; j < W; ++j) {
+                T* o = out + (k+j)*S;
+                o[0] = o0[j]; o[1] = o1[j]; o[2] = o2[j];
+            }
+        }
+        simd_cross_scalar<S>(a, b, out, k, n);
+    }
+
+    template <size_t W, typename T>
+    VEC_SIMD_INLINE void simd_axpy_kernel(T alpha, const T* x, T* y,
+                                          size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        V va = {};
+        for (size_t j = 0; j < W; ++j)
+            va[j] = alpha;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V vx = {}, vy = {};
+            std::memcpy(&vx, x + k, sizeof(V));
+            std::memcpy(&vy, y + k, sizeof(V));
+            vy += vx * va;
+            std::memcpy(y + k, &vy, sizeof(V));
+        }
+        simd_axpy_scalar(alpha, x, y, k, n);
+    }
+
+    template <size_t W, typename T>
+    VEC_SIMD_INLINE void simd_add_kernel(const T* a, const T* b, T* out,
+                                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V va = {}, vb = {};
+            std::memcpy(&va, a + k, sizeof(V));
+            std::memcpy(&vb, b + k, sizeof(V));
+            va += vb;
+            std::memcpy(out + k, &va, sizeof(V));
+        }
+        simd_add_scalar(a, b, out, k, n);
+    }
+
+    template <size_t W, typename T>
+    VEC_SIMD_INLINE void simd_sub_kernel(const T* a, const T* b, T* out,
+                                         size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V va = {}, vb = {};
+            std::memcpy(&va, a + k, sizeof(V));
+            std::memcpy(&vb, b + k, sizeof(V));
+            va -= vb;
+            std::memcpy(out + k, &va, sizeof(V));
+        }
+        simd_sub_scalar(a, b, out, k, n);
+    }
+
+    template <size_t W, typename T>
+    VEC_SIMD_INLINE void simd_scale_kernel(T alpha, const T* x, T* out,
+                                           size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        V va = {};
+        for (size_t j = 0; j < W; ++j)
+            va[j] = alpha;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V vx = {};
+            std::memcpy(&vx, x + k, sizeof(V));
+            vx *= va;
+            std::memcpy(out + k, &vx, sizeof(V));
+        }
+        simd_scale_scalar(alpha, x, out, k, n);
+    }
+
+    template <size_t W, size_t N, size_t S, size_t Step, typename T>
+    VEC_SIMD_INLINE void simd_cdot_kernel(const T* are, const T* aim,
+                                          const T* bre, const T* bim,
+                                          T* ore, T* oim, size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V sr = {}, si = {};
+            for (size_t i = 0; i < N; ++i) {
+                V xr = {}, xi = {}, yr = {}, yi = {};
+                for (size_t j = 0; j < W; ++j) {
+                    const size_t idx = ((k+j)*S+i)*Step;
+                    xr[j] = are[idx];
+                    xi[j] = aim[idx];
+                    yr[j] = bre[idx];
+                    yi[j] = bim[idx];
+                }
+                sr += xr * yr + xi * yi;
+                si += xr * yi - xi * yr;
+            }
+            for (size_t j = 0; j < W; ++j) {
+                ore[(k+j)*Step] = sr[j];
+                oim[(k+j)*Step] = si[j];
+            }
+        }
+        simd_cdot_scalar<N,S,Step>(are, aim, bre, bim, ore, oim, k, n);
+    }
+
+    template <size_t W, size_t N, size_t S, size_t Step, typename T>
+    VEC_SIMD_INLINE void simd_cnorm2_sq_kernel(const T* re, const T* im,
+                                               T* out, size_t n)
+    {
+        VEC_SIMD_NO_CONTRACT
+        typedef typename simd_vector<T,W>::type V;
+        const size_t m = n - n % W;
+        size_t k = 0;
+        for (; k < m; k += W) {
+            V sum = {};
+            for (size_t i = 0; i < N; ++i) {
+                V xr = {}, xi = {};
+                for (size_t j = 0; j < W; ++j) {
+                    const size_t idx = ((k+j)*S+i)*Step;
+                    xr[j] = re[idx];
+                    xi[j] = im[idx];
+                }
+                sum += xr * xr + xi * xi;
+            }
+            std::memcpy(out + k, &sum, sizeof(V));
+        }
+        simd_cnorm2_sq_scalar<N,S,Step>(re, im, out, k, n);
+    }
+
+    // per-ISA entry points; the vector width is the register size in bytes
+    // divided by the size of the scalar type
+#define VEC_SIMD_ENTRY_POINTS(isa, target, bytes)                           \
+    template <size_t N, size_t S, typename T>                               \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_dot_##isa(const T* a, const T* b, T* out, size_t n)           \
+    {                                                                       \
+        simd_dot_kernel<bytes / sizeof(T), N, S>(a, b, out, n);             \
+    }                                                                       \
+                                                                            \
+    template <size_t S, typename T>                                         \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_cross_##isa(const T* a, const T* b, T* out, size_t n)         \
+    {                                                                       \
+        simd_cross_kernel<bytes / sizeof(T), S>(a, b, out, n);              \
+    }                                                                       \
+                                                                            \
+    template <typename T>                                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_axpy_##isa(T alpha, const T* x, T* y, size_t n)               \
+    {                                                                       \
+        simd_axpy_kernel<bytes / sizeof(T)>(alpha, x, y, n);                \
+    }                                                                       \
+                                                                            \
+    template <typename T>                                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_add_##isa(const T* a, const T* b, T* out, size_t n)           \
+    {                                                                       \
+        simd_add_kernel<bytes / sizeof(T)>(a, b, out, n);                   \
+    }                                                                       \
+                                                                            \
+    template <typename T>                                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_sub_##isa(const T* a, const T* b, T* out, size_t n)           \
+    {                                                                       \
+        simd_sub_kernel<bytes / sizeof(T)>(a, b, out, n);                   \
+    }                                                                       \
+                                                                            \
+    template <typename T>                                                   \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_scale_##isa(T alpha, const T* x, T* out, size_t n)            \
+    {                                                                       \
+        simd_scale_kernel<bytes / sizeof(T)>(alpha, x, out, n);             \
+    }                                                                       \
+                                                                            \
+    template <size_t N, size_t S, size_t Step, typename T>                  \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_cdot_##isa(const T* are, const T* aim, const T* bre,          \
+                         const T* bim, T* ore, T* oim, size_t n)            \
+    {                                                                       \
+        simd_cdot_kernel<bytes / sizeof(T), N, S, Step>(are, aim, bre, bim, \
+                                                        ore, oim, n);       \
+    }                                                                       \
+                                                                            \
+    template <size_t N, size_t S, size_t Step, typename T>                  \
+    VEC_SIMD_TARGET(target)                                                 \
+    void simd_cnorm2_sq_##isa(const T* re, const T* im, T* out, size_t n)   \
+    {                                                                       \
+        simd_cnorm2_sq_kernel<bytes / sizeof(T), N, S, Step>(re, im, out, n); \
+    }
+
+    VEC_SIMD_ENTRY_POINTS(sse2, "sse2", 16)
+    VEC_SIMD_ENTRY_POINTS(avx2, "avx2", 32)
+    VEC_SIMD_ENTRY_POINTS(avx512, "avx512f", 64)
+#undef VEC_SIMD_ENTRY_POINTS
+
+#endif
+
+
+    // dispatching kernels on raw arrays of n vectors of stride S
+
+    // out[k] = a[k] * b[k]
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_dot(const T* a, const T* b, T* out, size_t n)
+    {
+        static_assert(S >= N, "stride must not be smaller than dimension");
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_dot_avx512<N,S>(a, b, out, n);
+        case simd_isa::avx2: return simd_dot_avx2<N,S>(a, b, out, n);
+        case simd_isa::sse2: return simd_dot_sse2<N,S>(a, b, out, n);
+        default: break;
+        }
+#endif
+        simd_dot_scalar<N,S>(a, b, out, 0, n);
+    }
+
+    // out[k] = a[k].norm2_sq()
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_norm2_sq(const T* a, T* out, size_t n)
+    {
+        simd_dot<N,S>(a, a, out, n);
+    }
+
+    // out[k] = cross(a[k], b[k]); padding lanes of out are left untouched
+    template <size_t S = 3, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_cross(const T* a, const T* b, T* out, size_t n)
+    {
+        static_assert(S >= 3, "stride must not be smaller than dimension");
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_cross_avx512<S>(a, b, out, n);
+        case simd_isa::avx2: return simd_cross_avx2<S>(a, b, out, n);
+        case simd_isa::sse2: return simd_cross_sse2<S>(a, b, out, n);
+        default: break;
+        }
+#endif
+        simd_cross_scalar<S>(a, b, out, 0, n);
+    }
+
+    // element-wise operations on len scalars, i.e. n * S for n vectors
+
+    // y += alpha * x
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_axpy(T alpha, const T* x, T* y, size_t len)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_axpy_avx512(alpha, x, y, len);
+        case simd_isa::avx2: return simd_axpy_avx2(alpha, x, y, len);
+        case simd_isa::sse2: return simd_axpy_sse2(alpha, x, y, len);
+        default: break;
+        }
+#endif
+        simd_axpy_scalar(alpha, x, y, 0, len);
+    }
+
+    // out = a + b
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_add(const T* a, const T* b, T* out, size_t len)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_add_avx512(a, b, out, len);
+        case simd_isa::avx2: return simd_add_avx2(a, b, out, len);
+        case simd_isa::sse2: return simd_add_sse2(a, b, out, len);
+        default: break;
+        }
+#endif
+        simd_add_scalar(a, b, out, 0, len);
+    }
+
+    // out = a - b
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_sub(const T* a, const T* b, T* out, size_t len)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_sub_avx512(a, b, out, len);
+        case simd_isa::avx2: return simd_sub_avx2(a, b, out, len);
+        case simd_isa::sse2: return simd_sub_sse2(a, b, out, len);
+        default: break;
+        }
+#endif
+        simd_sub_scalar(a, b, out, 0, len);
+    }
+
+    // out = alpha * x
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_scale(T alpha, const T* x, T* out, size_t len)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_scale_avx512(alpha, x, out, len);
+        case simd_isa::avx2: return simd_scale_avx2(alpha, x, out, len);
+        case simd_isa::sse2: return simd_scale_sse2(alpha, x, out, len);
+        default: break;
+        }
+#endif
+        simd_scale_scalar(alpha, x, out, 0, len);
+    }
+
+
+    // Hermitian dot products of complex vectors
+
+    // split layout: out[k] = a[k] * b[k] with real and imaginary parts of
+    // the operands and the result in separate arrays
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_dot_split(const T* are, const T* aim, const T* bre, const T* bim,
+                   T* ore, T* oim, size_t n)
+    {
+        static_assert(S >= N, "stride must not be smaller than dimension");
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_cdot_avx512<N,S,1>(are, aim, bre, bim, ore, oim, n);
+        case simd_isa::avx2: return simd_cdot_avx2<N,S,1>(are, aim, bre, bim, ore, oim, n);
+        case simd_isa::sse2: return simd_cdot_sse2<N,S,1>(are, aim, bre, bim, ore, oim, n);
+        default: break;
+        }
+#endif
+        simd_cdot_scalar<N,S,1>(are, aim, bre, bim, ore, oim, 0, n);
+    }
+
+    // interleaved std::complex data, deinterleaved in registers
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_dot(const std::complex<T>* a, const std::complex<T>* b,
+             std::complex<T>* out, size_t n)
+    {
+        static_assert(S >= N, "stride must not be smaller than dimension");
+        const T* ar = reinterpret_cast<const T*>(a);
+        const T* br = reinterpret_cast<const T*>(b);
+        T* o = reinterpret_cast<T*>(out);
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_cdot_avx512<N,S,2>(ar, ar + 1, br, br + 1, o, o + 1, n);
+        case simd_isa::avx2: return simd_cdot_avx2<N,S,2>(ar, ar + 1, br, br + 1, o, o + 1, n);
+        case simd_isa::sse2: return simd_cdot_sse2<N,S,2>(ar, ar + 1, br, br + 1, o, o + 1, n);
+        default: break;
+        }
+#endif
+        simd_cdot_scalar<N,S,2>(ar, ar + 1, br, br + 1, o, o + 1, 0, n);
+    }
+
+    // squared norms of complex vectors in split layout
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_norm2_sq_split(const T* re, const T* im, T* out, size_t n)
+    {
+        static_assert(S >= N, "stride must not be smaller than dimension");
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_cnorm2_sq_avx512<N,S,1>(re, im, out, n);
+        case simd_isa::avx2: return simd_cnorm2_sq_avx2<N,S,1>(re, im, out, n);
+        case simd_isa::sse2: return simd_cnorm2_sq_sse2<N,S,1>(re, im, out, n);
+        default: break;
+        }
+#endif
+        simd_cnorm2_sq_scalar<N,S,1>(re, im, out, 0, n);
+    }
+
+    // squared norms of interleaved std::complex data
+    template <size_t N, size_t S = N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_norm2_sq(const std::complex<T>* a, T* out, size_t n)
+    {
+        static_assert(S >= N, "stride must not be smaller than dimension");
+        const T* ar = reinterpret_cast<const T*>(a);
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return simd_cnorm2_sq_avx512<N,S,2>(ar, ar + 1, out, n);
+        case simd_isa::avx2: return simd_cnorm2_sq_avx2<N,S,2>(ar, ar + 1, out, n);
+        case simd_isa::sse2: return simd_cnorm2_sq_sse2<N,S,2>(ar, ar + 1, out, n);
+        default: break;
+        }
+#endif
+        simd_cnorm2_sq_scalar<N,S,2>(ar, ar + 1, out, 0, n);
+    }
+
+
+    // batch operations on arrays of vec<N,T>, vectorized for real and
+    // complex floating point T and falling back to the single-vector
+    // operators otherwise
+    template <typename T>
+    struct simd_supported : std::is_floating_point<T> {};
+
+    template <typename T>
+    struct simd_supported<std::complex<T>> : std::is_floating_point<T> {};
+
+    template <size_t N, typename T>
+    const T* simd_data(const std::vector<vec<N,T>>& x)
+    {
+        static_assert(sizeof(vec<N,T>) == N * sizeof(T),
+                      "vec<N,T> is expected to be tightly packed");
+        return x.empty() ? nullptr : &x[0][0];
+    }
+
+    template <size_t N, typename T>
+    T* simd_data(std::vector<vec<N,T>>& x)
+    {
+        static_assert(sizeof(vec<N,T>) == N * sizeof(T),
+                      "vec<N,T> is expected to be tightly packed");
+        return x.empty() ? nullptr : &x[0][0];
+    }
+
+    // the operands of the batch functions must have the same size
+    inline void simd_check_size(size_t n, size_t m)
+    {
+        if (n != m)
+            throw std::invalid_argument("batch operands differ in size");
+    }
+
+    template <size_t N, typename T>
+    typename std::enable_if<simd_supported<T>::value, std::vector<T>>::type
+    dot(const std::vector<vec<N,T>>& lhs, const std::vector<vec<N,T>>& rhs)
+    {
+        simd_check_size(lhs.size(), rhs.size());
+        std::vector<T> res(lhs.size());
+        simd_dot<N>(simd_data(lhs), simd_data(rhs), res.data(), res.size());
+        return res;
+    }
+
+    template <size_t N, typename A, typename B,
+              typename C = decltype(A()*B())>
+    typename std::enable_if<!std::is_same<A,B>::value ||
+                            !simd_supported<A>::value,
+                            std::vector<C>>::type
+    dot(const std::vector<vec<N,A>>& lhs, const std::vector<vec<N,B>>& rhs)
+    {
+        simd_check_size(lhs.size(), rhs.size());
+        std::vector<C> res(lhs.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = lhs[k] * rhs[k];
+        return res;
+    }
+
+    template <size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq())>
+    typename std::enable_if<simd_supported<T>::value, std::vector<R>>::type
+    norm2_sq(const std::vector<vec<N,T>>& x)
+    {
+        std::vector<R> res(x.size());
+        simd_norm2_sq<N>(simd_data(x), res.data(), res.size());
+        return res;
+    }
+
+    template <size_t N, typename T,
+              typename R = decltype(vec<N,T>().norm2_sq())>
+    typename std::enable_if<!simd_supported<T>::value, std::vector<R>>::type
+    norm2_sq(const std::vector<vec<N,T>>& x)
+    {
+        std::vector<R> res(x.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = x[k].norm2_sq();
+        return res;
+    }
+
+    // batch p-norm; the 2-norm takes the roots of the SIMD squared norms
+    template <size_t N, typename T, typename R = typename norm_type<T>::type>
+    std::vector<R> norm(const std::vector<vec<N,T>>& x, double p = 2)
+    {
+        std::vector<R> res(x.size());
+        if (p == 2 && simd_supported<T>::value) {
+            auto sq = norm2_sq(x);
+            for (size_t k = 0; k < res.size(); ++k)
+                res[k] = std::sqrt(R(sq[k]));
+        } else {
+            for (size_t k = 0; k < res.size(); ++k)
+                res[k] = x[k].norm(p);
+        }
+        return res;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value,
+                            std::vector<vec<3,T>>>::type
+    cross(const std::vector<vec<3,T>>& lhs, const std::vector<vec<3,T>>& rhs)
+    {
+        simd_check_size(lhs.size(), rhs.size());
+        std::vector<vec<3,T>> res(lhs.size());
+        simd_cross(simd_data(lhs), simd_data(rhs), simd_data(res), res.size());
+        return res;
+    }
+
+    template <typename A, typename B, typename C = decltype(A()*B())>
+    typename std::enable_if<!std::is_same<A,B>::value ||
+                            !std::is_floating_point<A>::value,
+                            std::vector<vec<3,C>>>::type
+    cross(const std::vector<vec<3,A>>& lhs, const std::vector<vec<3,B>>& rhs)
+    {
+        simd_check_size(lhs.size(), rhs.size());
+        std::vector<vec<3,C>> res(lhs.size());
+        for (size_t k = 0; k < res.size(); ++k)
+            res[k] = cross(lhs[k], rhs[k]);
+        return res;
+    }
+
+    // y += alpha * x without FMAs, unlike the fused axpy of vec_array.hpp
+    template <size_t N, typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    simd_axpy(T alpha, const std::vector<vec<N,T>>& x,
+              std::vector<vec<N,T>>& y)
+    {
+        simd_check_size(x.size(), y.size());
+        simd_axpy(alpha, simd_data(x), simd_data(y), N * x.size());
+    }
+}
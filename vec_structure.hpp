@@ -0,0 +1,497 @@
+/*  vec -- small physical vectors, complex or real
+ *  Copyright (C) 2016  Jonas Greitemann <j.greitemann@lmu.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "vec.hpp"
+#include "vec_box.hpp"
+#include "vec_parallel.hpp"
+#include "vec_simd.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VEC_STRUCTURE_INLINE inline __attribute__((always_inline))
+#else
+#define VEC_STRUCTURE_INLINE inline
+#endif
+#ifdef __clang__
+#define VEC_STRUCTURE_NO_CONTRACT _Pragma("clang fp contract(off)")
+#else
+#define VEC_STRUCTURE_NO_CONTRACT
+#endif
+
+namespace Vec {
+    // Static structure factor S(q) = |rho(q)|^2 / n of n particles at r_j,
+    // with the density modes rho(q) = sum_j exp(i q.r_j).
+    //
+    // At arbitrary wave vectors, each pair of q and r_j costs a sine and a
+    // cosine. In a periodic box, however, only the wave vectors commensurate
+    // with the box, q = 2 pi (h_0 / L_0, ..., h_{N-1} / L_{N-1}) with integer
+    // Miller indices h, are meaningful. There, exp(i q.r_j) is the product of
+    // the powers e_{j,i}^{h_i} of the phases e_{j,i} = exp(2 pi i r_{j,i} /
+    // L_i), so lattice_density_modes only evaluates N phases per particle and
+    // obtains their powers by repeated multiplication. A pair then costs a
+    // complex multiply-add, plus N - 2 multiplications whenever h differs
+    // from its predecessor in other than the last component; the indices are
+    // best ordered with the last component varying fastest, as returned by
+    // lattice_indices. The rounding errors of the powers grow linearly with
+    // |h|.
+    //
+    // The powers for a block of structure_block particles are tabulated in
+    // split real/imaginary arrays, and the sums over the particles of the
+    // block are vectorized over structure_lanes partial sums per mode with
+    // the instruction set selected in vec_simd.hpp. As the number of partial
+    // sums is the same for every instruction set, so are the results, bit
+    // for bit. The modes are distributed over the threads of a thread_pool;
+    // every mode is summed by a single thread in a fixed order, so that the
+    // results do not depend on the number of threads either.
+    const size_t structure_lanes = 8;
+    const size_t structure_block = 64;
+
+    // minimum number of pairs of modes and particles per chunk of modes
+    const size_t structure_grain_size = 1 << 16;
+
+    // W lanes, native to the instruction set; the structure_lanes partial
+    // sums are held in structure_lanes / W of them
+    template <typename T>
+    constexpr size_t structure_width(size_t bytes)
+    {
+        return bytes / sizeof(T) < structure_lanes ? bytes / sizeof(T)
+            : structure_lanes;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    template <typename T, size_t W>
+    struct structure_vector {
+	typedef T type __attribute__((vector_size(W * sizeof(T))));
+    };
+
+    template <typename T>
+    constexpr size_t structure_generic_width()
+    {
+        return structure_width<T>(16);
+    }
+#else
+    template <typename T, size_t W>
+    struct structure_vector {
+	typedef T type;
+    };
+
+    template <typename T>
+    constexpr size_t structure_generic_width()
+    {
+        return 1;
+    }
+#endif
+
+    template <typename T>
+    constexpr T structure_two_pi()
+    {
+        return T(6.283185307179586476925286766559);
+    }
+
+    // per-axis maximum of |h_i|
+    template <size_t N>
+    vec<N,int> lattice_index_range(const vec<N,int>* h, size_t m)
+    {
+        vec<N,int> hmax;
+        for (size_t i = 0; i < N; ++i)
+            hmax[i] = 0;
+        for (size_t k = 0; k < m; ++k)
+            for (size_t i = 0; i < N; ++i)
+                hmax[i] = std::max(hmax[i], std::abs(h[k][i]));
+        return hmax;
+    }
+
+    // Adds the contributions of the particles [0, n) to the modes [first,
+    // last) of h, given the phases re[i*n+j] + i im[i*n+j] of particle j
+    // along axis i. The partial sums are kept in sums_re/sums_im, with
+    // structure_lanes per mode, and only added up in the end.
+    template <size_t W, size_t N, typename T>
+    VEC_STRUCTURE_INLINE void structure_lattice_kernel(
+        const vec<N,int>* h, size_t first, size_t last, const T* re,
+        const T* im, size_t n, const vec<N,int>& hmax, std::complex<T>* rho)
+    {
+        VEC_STRUCTURE_NO_CONTRACT
+        typedef typename structure_vector<T,W>::type V;
+        const size_t L = structure_lanes, B = structure_block, G = L / W;
+        static_assert(L % W == 0 && B % L == 0, "lanes must divide blocks");
+        // tables of the powers -hmax_i..hmax_i along axis i, row by row
+        size_t offset[N + 1];
+        offset[0] = 0;
+        for (size_t i = 0; i < N; ++i)
+            offset[i+1] = offset[i] + (2 * size_t(hmax[i]) + 1) * B;
+        std::vector<T> pre(offset[N]), pim(offset[N]);
+        auto row = [&](size_t i, int k) {
+            return offset[i] + size_t(k + hmax[i]) * B;
+        };
+        std::vector<T> sums_re((last - first) * L), sums_im(sums_re.size());
+        T tre[B], tim[B];
+
+        for (size_t j0 = 0; j0 < n; j0 += B) {
+            const size_t len = std::min(B, n - j0);
+            for (size_t i = 0; i < N; ++i) {
+                T* r0 = pre.data() + row(i, 0);
+                T* i0 = pim.data() + row(i, 0);
+                std::fill(r0, r0 + B, T(1));
+                std::fill(i0, i0 + B, T(0));
+                if (hmax[i] == 0)
+                    continue;
+                // padding lanes get the phase 1, they are masked below
+                T* r1 = r0 + B;
+                T* i1 = i0 + B;
+                std::copy(re + i * n + j0, re + i * n + j0 + len, r1);
+                std::copy(im + i * n + j0, im + i * n + j0 + len, i1);
+                std::fill(r1 + len, r1 + B, T(1));
+                std::fill(i1 + len, i1 + B, T(0));
+                for (int k = 2; k <= hmax[i]; ++k) {
+                    const T* pr = r0 + (k - 1) * B;
+                    const T* pi = i0 + (k - 1) * B;
+                    T* kr = r0 + k * B;
+                    T* ki = i0 + k * B;
+                    for (size_t c = 0; c < B; c += W) {
+                        V ar, ai, br, bi;
+                        std::memcpy(&ar, pr + c, sizeof(V));
+                        std::memcpy(&ai, pi + c, sizeof(V));
+                        std::memcpy(&br, r1 + c, sizeof(V));
+                        std::memcpy(&bi, i1 + c, sizeof(V));
+                        V cr = ar * br - ai * bi;
+                        V ci = ar * bi + ai * br;
+                        std::memcpy(kr + c, &cr, sizeof(V));
+                        std::memcpy(ki + c, &ci, sizeof(V));
+                    }
+                }
+                // e^-k = conj(e^k) for unit phases
+                for (int k = 1; k <= hmax[i]; ++k) {
+                    std::copy(r0 + k * B, r0 + (k + 1) * B, r0 - k * B);
+                    const T* ki = i0 + k * B;
+                    T* mi = i0 - k * B;
+                    for (size_t p = 0; p < B; ++p)
+                        mi[p] = -ki[p];
+                }
+            }
+
+            for (size_t m = first; m < last; ++m) {
+                const vec<N,int>& k = h[m];
+                // product of all but the last factor, shared by consecutive
+                // modes with the same leading indices
+                bool fresh = m == first;
+                for (size_t i = 0; i + 1 < N && !fresh; ++i)
+                    fresh = k[i] != h[m-1][i];
+                if (fresh) {
+                    for (size_t p = 0; p < B; ++p) {
+                        tre[p] = T(p < len);
+                        tim[p] = T(0);
+                    }
+                    for (size_t i = 0; i + 1 < N; ++i) {
+                        const T* fr = pre.data() + row(i, k[i]);
+                        const T* fi = pim.data() + row(i, k[i]);
+                        for (size_t c = 0; c < B; c += W) {
+                            V ar, ai, br, bi;
+                            std::memcpy(&ar, tre + c, sizeof(V));
+                            std::memcpy(&ai, tim + c, sizeof(V));
+                            std::memcpy(&br, fr + c, sizeof(V));
+                            std::memcpy(&bi, fi + c, sizeof(V));
+                            V cr = ar * br - ai * bi;
+                            V ci = ar * bi + ai * br;
+                            std::memcpy(tre + c, &cr, sizeof(V));
+                            std::memcpy(tim + c, &ci, sizeof(V));
+                        }
+                    }
+                }
+                const T* fr = pre.data() + row(N - 1, k[N-1]);
+                const T* fi = pim.data() + row(N - 1, k[N-1]);
+                T* sr = sums_re.data() + (m - first) * L;
+                T* si = sums_im.data() + (m - first) * L;
+                V accr[G], acci[G];
+                for (size_t g = 0; g < G; ++g) {
+                    std::memcpy(&accr[g], sr + g * W, sizeof(V));
+                    std::memcpy(&acci[g], si + g * W, sizeof(V));
+                }
+                for (size_t c = 0; c < B; c += L)
+                    for (size_t g = 0; g < G; ++g) {
+                        V ar, ai, br, bi;
+                        std::memcpy(&ar, tre + c + g * W, sizeof(V));
+                        std::memcpy(&ai, tim + c + g * W, sizeof(V));
+                        std::memcpy(&br, fr + c + g * W, sizeof(V));
+                        std::memcpy(&bi, fi + c + g * W, sizeof(V));
+                        accr[g] += ar * br - ai * bi;
+                        acci[g] += ar * bi + ai * br;
+                    }
+                for (size_t g = 0; g < G; ++g) {
+                    std::memcpy(sr + g * W, &accr[g], sizeof(V));
+                    std::memcpy(si + g * W, &acci[g], sizeof(V));
+                }
+            }
+        }
+
+        for (size_t m = first; m < last; ++m) {
+            T r = T(), s = T();
+            for (size_t j = 0; j < L; ++j) {
+                r += sums_re[(m - first) * L + j];
+                s += sums_im[(m - first) * L + j];
+            }
+            rho[m] = std::complex<T>(r, s);
+        }
+    }
+
+    // compiled without FP contraction like the entry points below, so that
+    // the results are the same for every instruction set
+    template <size_t N, typename T>
+    VEC_SIMD_STRICT
+    void structure_lattice_generic(const vec<N,int>* h, size_t first,
+                                   size_t last, const T* re, const T* im,
+                                   size_t n, const vec<N,int>& hmax,
+                                   std::complex<T>* rho)
+    {
+        structure_lattice_kernel<structure_generic_width<T>(), N, T>(
+            h, first, last, re, im, n, hmax, rho);
+    }
+
+#ifdef VEC_SIMD_X86
+#define VEC_STRUCTURE_ENTRY_POINT(isa, target, bytes)                       \
+    template <size_t N, typename T>                                         \
+    VEC_SIMD_TARGET(target)                                                 \
+    void structure_lattice_##isa(const vec<N,int>* h, size_t first,         \
+                                 size_t last, const T* re, const T* im,     \
+                                 size_t n, const vec<N,int>& hmax,          \
+                                 std::complex<T>* rho)                      \
+    {                                                                       \
+        structure_lattice_kernel<structure_width<T>(bytes), N, T>(          \
+            h, first, last, re, im, n, hmax, rho);                          \
+    }
+
+    VEC_STRUCTURE_ENTRY_POINT(sse2, "sse2", 16)
+    VEC_STRUCTURE_ENTRY_POINT(avx2, "avx2", 32)
+    VEC_STRUCTURE_ENTRY_POINT(avx512, "avx512f", 64)
+#undef VEC_STRUCTURE_ENTRY_POINT
+#endif
+
+    template <size_t N, typename T>
+    void structure_lattice(const vec<N,int>* h, size_t first, size_t last,
+                           const T* re, const T* im, size_t n,
+                           const vec<N,int>& hmax, std::complex<T>* rho)
+    {
+#ifdef VEC_SIMD_X86
+        switch (simd_active()) {
+        case simd_isa::avx512: return structure_lattice_avx512<N,T>(h, first, last, re, im, n, hmax, rho);
+        case simd_isa::avx2: return structure_lattice_avx2<N,T>(h, first, last, re, im, n, hmax, rho);
+        case simd_isa::sse2: return structure_lattice_sse2<N,T>(h, first, last, re, im, n, hmax, rho);
+        default: break;
+        }
+#endif
+        structure_lattice_generic<N,T>(h, first, last, re, im, n, hmax, rho);
+    }
+
+    // q-vectors processed per chunk, such that a chunk covers at least
+    // structure_grain_size pairs
+    inline size_t structure_grain(size_t n)
+    {
+        return std::max<size_t>(1, structure_grain_size / std::max<size_t>(n, 1));
+    }
+
+
+    // rho(q) at arbitrary wave vectors q[0..m), written to rho[0..m)
+    template <size_t N, typename T>
+    void density_modes(const vec<N,T>* q, size_t m, const vec<N,T>* x,
+                       size_t n, std::complex<T>* rho,
+                       thread_pool& pool = thread_pool::global())
+    {
+        pool.parallel_for(m, [=](size_t first, size_t last) {
+            std::vector<T> sr(last - first), si(last - first);
+            // all modes of the chunk for a block of particles at a time
+            for (size_t j0 = 0; j0 < n; j0 += structure_block) {
+                const size_t j1 = std::min(n, j0 + structure_block);
+                for (size_t k = first; k < last; ++k) {
+                    T r = sr[k - first], s = si[k - first];
+                    for (size_t j = j0; j < j1; ++j) {
+                        const T phase = q[k] * x[j];
+                        r += std::cos(phase);
+                        s += std::sin(phase);
+                    }
+                    sr[k - first] = r;
+                    si[k - first] = s;
+                }
+            }
+            for (size_t k = first; k < last; ++k)
+                rho[k] = std::complex<T>(sr[k - first], si[k - first]);
+        }, structure_grain(n));
+    }
+
+    template <size_t N, typename T>
+    std::vector<std::complex<T>>
+    density_modes(const std::vector<vec<N,T>>& q,
+                  const std::vector<vec<N,T>>& x,
+                  thread_pool& pool = thread_pool::global())
+    {
+        std::vector<std::complex<T>> rho(q.size());
+        density_modes(q.data(), q.size(), x.data(), x.size(), rho.data(),
+                      pool);
+        return rho;
+    }
+
+    // a fixed batch of M wave vectors, e.g. a shell of equal |q|, yields a
+    // vector of modes: rho.norm2_sq() / (M * n) is S averaged over the batch,
+    // cdot(rho_a, rho_b) / M the cross correlation of two species
+    template <size_t M, size_t N, typename T>
+    vec<M,std::complex<T>>
+    density_modes(const std::array<vec<N,T>,M>& q,
+                  const std::vector<vec<N,T>>& x,
+                  thread_pool& pool = thread_pool::global())
+    {
+        std::array<std::complex<T>,M> rho;
+        density_modes(q.data(), M, x.data(), x.size(), rho.data(), pool);
+        vec<M,std::complex<T>> res;
+        for (size_t k = 0; k < M; ++k)
+            res[k] = rho[k];
+        return res;
+    }
+
+
+    // the wave vector 2 pi h / L of the Miller indices h
+    template <size_t N, typename T>
+    vec<N,T> lattice_wave_vector(const periodic_box<N,T>& box,
+                                 const vec<N,int>& h)
+    {
+        vec<N,T> q;
+        for (size_t i = 0; i < N; ++i)
+            q[i] = structure_two_pi<T>() * T(h[i]) / box.lengths()[i];
+        return q;
+    }
+
+    // Miller indices h != 0 with |h_i| <= hmax, keeping only one of h and -h
+    // (the one whose first nonzero component is positive) as rho(-q) is the
+    // complex conjugate of rho(q); the last component varies fastest
+    template <size_t N>
+    std::vector<vec<N,int>> lattice_indices(int hmax)
+    {
+        std::vector<vec<N,int>> res;
+        vec<N,int> h;
+        for (size_t i = 0; i < N; ++i)
+            h[i] = -hmax;
+        h[0] = 0;
+        for (;;) {
+            size_t i = 0;
+            while (i < N && h[i] == 0)
+                ++i;
+            if (i < N && h[i] > 0)
+                res.push_back(h);
+            // odometer, the first component only runs over 0..hmax
+            size_t d = N;
+            while (d > 0 && h[d-1] == hmax) {
+                h[d-1] = d > 1 ? -hmax : 0;
+                --d;
+            }
+            if (d == 0)
+                break;
+            ++h[d-1];
+        }
+        return res;
+    }
+
+    // rho(q) at the wave vectors q = 2 pi h / L of the Miller indices
+    // h[0..m), written to rho[0..m)
+    template <size_t N, typename T>
+    void lattice_density_modes(const periodic_box<N,T>& box,
+                               const vec<N,int>* h, size_t m,
+                               const vec<N,T>* x, size_t n,
+                               std::complex<T>* rho,
+                               thread_pool& pool = thread_pool::global())
+    {
+        // phases along each axis, split into real and imaginary parts
+        std::vector<T> re(N * n), im(N * n);
+        pool.parallel_for(n, [&](size_t first, size_t last) {
+            for (size_t i = 0; i < N; ++i) {
+                const T f = structure_two_pi<T>() / box.lengths()[i];
+                for (size_t j = first; j < last; ++j) {
+                    const T phase = f * x[j][i];
+                    re[i * n + j] = std::cos(phase);
+                    im[i * n + j] = std::sin(phase);
+                }
+            }
+        }, vec_map_grain_size);
+
+        const vec<N,int> hmax = lattice_index_range(h, m);
+        pool.parallel_for(m, [&](size_t first, size_t last) {
+            structure_lattice(h, first, last, re.data(), im.data(), n, hmax,
+                              rho);
+        }, structure_grain(n));
+    }
+
+    template <size_t N, typename T>
+    std::vector<std::complex<T>>
+    lattice_density_modes(const periodic_box<N,T>& box,
+                          const std::vector<vec<N,int>>& h,
+                          const std::vector<vec<N,T>>& x,
+                          thread_pool& pool = thread_pool::global())
+    {
+        std::vector<std::complex<T>> rho(h.size());
+        lattice_density_modes(box, h.data(), h.size(), x.data(), x.size(),
+                              rho.data(), pool);
+        return rho;
+    }
+
+    template <size_t M, size_t N, typename T>
+    vec<M,std::complex<T>>
+    lattice_density_modes(const periodic_box<N,T>& box,
+                          const std::array<vec<N,int>,M>& h,
+                          const std::vector<vec<N,T>>& x,
+                          thread_pool& pool = thread_pool::global())
+    {
+        std::array<std::complex<T>,M> rho;
+        lattice_density_modes(box, h.data(), M, x.data(), x.size(),
+                              rho.data(), pool);
+        vec<M,std::complex<T>> res;
+        for (size_t k = 0; k < M; ++k)
+            res[k] = rho[k];
+        return res;
+    }
+
+
+    // S(q) = |rho(q)|^2 / n at arbitrary wave vectors
+    template <size_t N, typename T>
+    std::vector<T> structure_factor(const std::vector<vec<N,T>>& q,
+                                    const std::vector<vec<N,T>>& x,
+                                    thread_pool& pool = thread_pool::global())
+    {
+        const std::vector<std::complex<T>> rho = density_modes(q, x, pool);
+        std::vector<T> s(rho.size());
+        for (size_t k = 0; k < rho.size(); ++k)
+            s[k] = std::norm(rho[k]) / T(x.size());
+        return s;
+    }
+
+    // S(q) at the wave vectors 2 pi h / L commensurate with the box
+    template <size_t N, typename T>
+    std::vector<T> structure_factor(const periodic_box<N,T>& box,
+                                    const std::vector<vec<N,int>>& h,
+                                    const std::vector<vec<N,T>>& x,
+                                    thread_pool& pool = thread_pool::global())
+    {
+        const std::vector<std::complex<T>> rho =
+            lattice_density_modes(box, h, x, pool);
+        std::vector<T> s(rho.size());
+        for (size_t k = 0; k < rho.size(); ++k)
+            s[k] = std::norm(rho[k]) / T(x.size());
+        return s;
+    }
+}